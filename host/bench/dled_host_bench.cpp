@@ -0,0 +1,204 @@
+/*
+ * The render benchmark of dled_bench_run, on Linux.
+ *
+ * The steps are the same code as on the board, timed at all DLED_BENCH_LENGTHS, and
+ * print the same JSON lines. The numbers tell how the steps compare with each other
+ * and with a previous build, not how fast they are on the ESP32.
+ *
+ * Then the cases only the host runs: every step next to the code it replaced (see
+ * reference/), at HOST_BENCH_LENGTHS.
+ */
+
+#include "dled_bench.h"
+
+#include <stdlib.h>
+#include "dled_strip.h"
+#include "dled_pixel.h"
+#include "esp32_rmt_dled.h"
+#include "dled_reference.h"
+
+#define HOST_BENCH_LENGTHS { 112, 1000, 5000, 20000 }
+
+/* What the compared steps work on */
+typedef struct {
+    uint32_t          length;
+    pixel_t           *pixels;
+    pixel_strip_t     strip;
+    rmt_pixel_strip_t rps;
+} host_bench_t;
+
+static void host_bench_encode_bits(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_reference_encode_buffer(&bench->rps);
+}
+
+static void host_bench_encode_table(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    rmt_dled_encode_buffer(&bench->rps);
+}
+
+/* The bytes of the output buffer to RMT items, one bit at a time and from encode_table */
+static void host_bench_byte_encoders(uint32_t length) {
+    host_bench_t bench;
+
+    dled_strip_init(&bench.strip);
+    rmt_dled_init(&bench.rps);
+    if (dled_strip_create(&bench.strip, DLED_WS281x, length, 255) != ESP_OK ||
+        dled_strip_fill_buffer(&bench.strip) != ESP_OK ||
+        rmt_dled_create_heap(&bench.rps, &bench.strip) != ESP_OK) {
+        dled_bench_skip("byte_encoder", "bits", length);
+        dled_bench_skip("byte_encoder", "table", length);
+    }
+    else {
+        dled_pixel_hue_step(bench.strip.pixels, length, 0, 43, 255, 255);
+        dled_strip_fill_buffer(&bench.strip);
+        dled_bench_time("byte_encoder", "bits", length, host_bench_encode_bits, &bench);
+        dled_bench_time("byte_encoder", "table", length, host_bench_encode_table, &bench);
+    }
+
+    rmt_dled_destroy(&bench.rps);
+    dled_strip_destroy(&bench.strip);
+}
+
+static void host_bench_fill_buffer(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_strip_fill_buffer(&bench->strip);
+}
+
+static void host_bench_fill_buffer_switch(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_reference_fill_buffer(&bench->strip);
+}
+
+static void host_bench_encode_pixels(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_strip_mark_all_dirty(&bench->strip);
+    rmt_dled_encode_pixels(&bench->rps);
+}
+
+static void host_bench_encode_pixels_switch(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_reference_encode_pixels(&bench->rps);
+}
+
+/* The loops specialized for a LED format, a switch on the LED type for every pixel, and the
+ * 16 bits pixels dithered to the same format */
+static void host_bench_format(uint32_t length, dstrip_type_t type, const char *format, const char *format_switch,
+                              const char *format_hd) {
+    host_bench_t bench;
+
+    dled_strip_init(&bench.strip);
+    rmt_dled_init(&bench.rps);
+    if (dled_strip_create(&bench.strip, type, length, 255) != ESP_OK ||
+        dled_strip_fill_buffer(&bench.strip) != ESP_OK ||
+        rmt_dled_create_heap(&bench.rps, &bench.strip) != ESP_OK) {
+        dled_bench_skip("fill_buffer", format, length);
+        dled_bench_skip("fill_buffer", format_switch, length);
+        dled_bench_skip("rmt_encode_pixels", format, length);
+        dled_bench_skip("rmt_encode_pixels", format_switch, length);
+        dled_bench_skip("fill_buffer", format_hd, length);
+        dled_bench_skip("rmt_encode_pixels", format_hd, length);
+    }
+    else {
+        dled_pixel_hue_step(bench.strip.pixels, length, 0, 43, 255, 255);
+        dled_bench_time("fill_buffer", format, length, host_bench_fill_buffer, &bench);
+        dled_bench_time("fill_buffer", format_switch, length, host_bench_fill_buffer_switch, &bench);
+        dled_bench_time("rmt_encode_pixels", format, length, host_bench_encode_pixels, &bench);
+        dled_bench_time("rmt_encode_pixels", format_switch, length, host_bench_encode_pixels_switch, &bench);
+
+        if (dled_strip_create_hd(&bench.strip) == ESP_OK) {
+            dled_pixel_hue_step16(bench.strip.pixels16, length, 0, 43, 65535, 65535);
+            dled_strip_set_hd(&bench.strip, true);
+            dled_bench_time("fill_buffer", format_hd, length, host_bench_fill_buffer, &bench);
+            dled_bench_time("rmt_encode_pixels", format_hd, length, host_bench_encode_pixels, &bench);
+        }
+        else {
+            dled_bench_skip("fill_buffer", format_hd, length);
+            dled_bench_skip("rmt_encode_pixels", format_hd, length);
+        }
+    }
+
+    rmt_dled_destroy(&bench.rps);
+    dled_strip_destroy(&bench.strip);
+}
+
+static void host_bench_rainbow_palette(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_pixel_rainbow_step(bench->pixels, bench->length, 64, frame);
+}
+
+static void host_bench_rainbow_by_index(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_reference_rainbow_step(bench->pixels, bench->length, 64, frame);
+}
+
+/* The rainbow from the cached palette and from dled_pixel_get_color_by_index for every pixel */
+static void host_bench_rainbow(uint32_t length) {
+    host_bench_t bench;
+
+    bench.length = length;
+    bench.pixels = (pixel_t*)calloc(length, sizeof(pixel_t));
+    if (bench.pixels == NULL) {
+        dled_bench_skip("rainbow_step", "palette", length);
+        dled_bench_skip("rainbow_step", "by_index", length);
+        return;
+    }
+    dled_bench_time("rainbow_step", "palette", length, host_bench_rainbow_palette, &bench);
+    dled_bench_time("rainbow_step", "by_index", length, host_bench_rainbow_by_index, &bench);
+
+    free(bench.pixels);
+}
+
+static void host_bench_fade_swar(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_pixel_fade(bench->pixels, bench->length, 200);
+}
+
+static void host_bench_fade_scale8(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_reference_fade(bench->pixels, bench->length, 200);
+}
+
+static void host_bench_fade_divide(void *arg, uint32_t frame) {
+    host_bench_t *bench = (host_bench_t*)arg;
+    dled_reference_fade_divide(bench->pixels, bench->length, 200);
+}
+
+/* The fade four components at a time, a pixel at a time and a divide of every channel */
+static void host_bench_fade(uint32_t length) {
+    host_bench_t bench;
+
+    bench.length = length;
+    bench.pixels = (pixel_t*)calloc(length, sizeof(pixel_t));
+    if (bench.pixels == NULL) {
+        dled_bench_skip("fade", "swar", length);
+        dled_bench_skip("fade", "scale8", length);
+        dled_bench_skip("fade", "divide", length);
+        return;
+    }
+    dled_pixel_hue_step(bench.pixels, length, 0, 43, 255, 255);
+    dled_bench_time("fade", "swar", length, host_bench_fade_swar, &bench);
+    dled_pixel_hue_step(bench.pixels, length, 0, 43, 255, 255);
+    dled_bench_time("fade", "scale8", length, host_bench_fade_scale8, &bench);
+    dled_pixel_hue_step(bench.pixels, length, 0, 43, 255, 255);
+    dled_bench_time("fade", "divide", length, host_bench_fade_divide, &bench);
+
+    free(bench.pixels);
+}
+
+int main(void) {
+    const uint32_t lengths[] = HOST_BENCH_LENGTHS;
+
+    dled_bench_run();
+
+    for (uint8_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        host_bench_byte_encoders(lengths[i]);
+        host_bench_rainbow(lengths[i]);
+        host_bench_fade(lengths[i]);
+        host_bench_format(lengths[i], DLED_WS281x, "grb", "grb_switch", "grb_hd");
+        host_bench_format(lengths[i], DLED_WS2811, "rgb", "rgb_switch", "rgb_hd");
+        host_bench_format(lengths[i], DLED_SK6812_RGBW, "grbw", "grbw_switch", "grbw_hd");
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Records a rainbow through the virtual output, on Linux.
+ *
+ *     dled_host_record recording.bin [length] [frames] [type]
+ *
+ * The frames are rendered and encoded by the code of the board, with their RMT items,
+ * for tools/dled_frames.py. `type` is the number of a dstrip_type_t, DLED_WS2812 by default.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "dled_strip.h"
+#include "dled_pixel.h"
+#include "dled_output.h"
+#include "dled_virtual.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s recording.bin [length] [frames] [type]\n", argv[0]);
+        return 2;
+    }
+    uint32_t length = argc > 2 ? strtoul(argv[2], NULL, 0) : 112;
+    uint32_t frames = argc > 3 ? strtoul(argv[3], NULL, 0) : 100;
+    dstrip_type_t type = argc > 4 ? (dstrip_type_t)strtoul(argv[4], NULL, 0) : DLED_WS2812;
+
+    FILE *file = fopen(argv[1], "wb");
+    if (file == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    pixel_strip_t strip;
+    dled_virtual_sink_t sink;
+    dled_output_t output;
+    esp_err_t err;
+
+    dled_strip_init(&strip);
+    dled_virtual_init(&sink);
+    err = dled_strip_create(&strip, type, length, 64);
+    if (err == ESP_OK) { err = dled_virtual_create(&sink, &strip, file, true); }
+    if (err == ESP_OK) { err = dled_virtual_output(&sink, &output); }
+    for (uint32_t step = 0; err == ESP_OK && step < frames; step++) {
+        dled_pixel_rainbow_step(strip.pixels, strip.length, strip.max_cc_val, step);
+        dled_strip_mark_all_dirty(&strip);
+        err = dled_output_send(&output);
+    }
+    dled_virtual_destroy(&sink);
+    dled_strip_destroy(&strip);
+    fclose(file);
+
+    if (err != ESP_OK) {
+        fprintf(stderr, "Recording failed: 0x%x\n", err);
+        return 1;
+    }
+    printf("%u frames of %u LEDs in %s\n", (unsigned)frames, (unsigned)length, argv[1]);
+    return 0;
+}
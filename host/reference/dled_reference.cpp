@@ -0,0 +1,107 @@
+#include "dled_reference.h"
+
+#include <string.h>
+
+void dled_reference_byte_to_rmtitem(const rmt_pixel_strip_t *rps, uint8_t data, rmt_item32_t *dst) {
+    uint8_t mask = 0x80;
+
+    while (mask != 0){
+        *dst++ = ((data & mask) != 0) ? rps->rmtHI : rps->rmtLO;
+        mask = mask >> 1;
+    }
+}
+
+void dled_reference_encode_buffer(rmt_pixel_strip_t *rps) {
+    uint32_t didx = 0;
+    for (uint32_t i = 0; i < rps->strip->buffer_length; i++) {
+        dled_reference_byte_to_rmtitem(rps, rps->strip->buffer[i], &rps->ugly_buffer[didx]);
+        didx += RMT_DLED_ITEMS_PER_BYTE;
+    }
+    rps->item_count = didx;
+
+    // change last bit to include reset time
+    didx--;
+    if (rps->ugly_buffer[didx].val == rps->rmtHI.val) {
+        rps->ugly_buffer[didx] = rps->rmtHR;
+    }
+    else {
+        rps->ugly_buffer[didx] = rps->rmtLR;
+    }
+}
+
+/* The bytes of a pixel in the order they are sent, before the output levels */
+static uint8_t dled_reference_wire(const pixel_strip_t *strip, const pixel_t *pixel, uint8_t *out) {
+    uint8_t w;
+
+    switch (strip->type) {
+        case DLED_WS2811:
+            out[0] = pixel->r; out[1] = pixel->g; out[2] = pixel->b;
+            return 3;
+        case DLED_SK6812_RGBW:
+            w = pixel->r < pixel->g ? pixel->r : pixel->g;
+            if (pixel->b < w) { w = pixel->b; }
+            out[0] = pixel->g - w; out[1] = pixel->r - w; out[2] = pixel->b - w; out[3] = w;
+            return 4;
+        default:
+            out[0] = pixel->g; out[1] = pixel->r; out[2] = pixel->b;
+            return 3;
+    }
+}
+
+void dled_reference_fill_buffer(pixel_strip_t *strip) {
+    bool mapped = dled_strip_is_mapped(strip);
+    uint32_t didx = 0;
+
+    for (uint32_t i = 0; i < strip->length; i++) {
+        const pixel_t *pixel = (const pixel_t*)dled_strip_pixel_at(strip, strip->pixels, sizeof(pixel_t), i, mapped);
+        uint8_t wire[4];
+        uint8_t count = dled_reference_wire(strip, pixel, wire);
+        for (uint8_t b = 0; b < count; b++) {
+            strip->buffer[didx++] = strip->levels[wire[b]];
+        }
+    }
+}
+
+void dled_reference_encode_pixels(rmt_pixel_strip_t *rps) {
+    const pixel_strip_t *strip = rps->strip;
+    bool mapped = dled_strip_is_mapped(strip);
+    rmt_item32_t *dst = rps->ugly_buffer;
+
+    for (uint32_t i = 0; i < strip->length; i++) {
+        const pixel_t *pixel = (const pixel_t*)dled_strip_pixel_at(strip, strip->pixels, sizeof(pixel_t), i, mapped);
+        uint8_t wire[4];
+        uint8_t count = dled_reference_wire(strip, pixel, wire);
+        for (uint8_t b = 0; b < count; b++) {
+            memcpy(dst, &rps->encode_table[strip->levels[wire[b]] * RMT_DLED_ITEMS_PER_BYTE],
+                   RMT_DLED_ITEMS_PER_BYTE * sizeof(rmt_item32_t));
+            dst += RMT_DLED_ITEMS_PER_BYTE;
+        }
+    }
+    rps->item_count = dst - rps->ugly_buffer;
+
+    // change last bit to include reset time
+    rmt_item32_t *last = dst - 1;
+    *last = (last->val == rps->rmtHI.val) ? rps->rmtHR : rps->rmtLR;
+}
+
+void dled_reference_rainbow_step(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint16_t step) {
+    for (uint32_t idx = 0; idx < length; idx++) {
+        pixels[idx] = dled_pixel_get_color_by_index(max_cc_val, idx + step);
+    }
+}
+
+void dled_reference_fade(pixel_t *pixels, uint32_t length, uint8_t scale) {
+    for (uint32_t i = 0; i < length; i++) {
+        pixels[i].r = dled_scale8(pixels[i].r, scale);
+        pixels[i].g = dled_scale8(pixels[i].g, scale);
+        pixels[i].b = dled_scale8(pixels[i].b, scale);
+    }
+}
+
+void dled_reference_fade_divide(pixel_t *pixels, uint32_t length, uint8_t scale) {
+    for (uint32_t i = 0; i < length; i++) {
+        pixels[i].r = pixels[i].r * scale / 255;
+        pixels[i].g = pixels[i].g * scale / 255;
+        pixels[i].b = pixels[i].b * scale / 255;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef HOST_DLED_REFERENCE_H_
+#define HOST_DLED_REFERENCE_H_
+
+/*
+ * The code of main/ as it was before it was made faster, kept for the host build only.
+ *
+ * The tests check that the fast code gives the same results, the benchmark times both.
+ * Every function is as close as possible to the one it stands for, only the types of
+ * the lengths are 32 bits so they run at every length of the benchmark.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "dled_pixel.h"
+#include "dled_strip.h"
+#include "esp32_rmt_dled.h"
+
+/**
+ * @brief Encode a byte one bit at a time, the encoder before `encode_table`.
+ *
+ * @param[in]  rps  The structure with the items of 0 and 1.
+ * @param[in]  data The byte.
+ * @param[out] dst  Where the RMT_DLED_ITEMS_PER_BYTE items are written.
+ */
+void dled_reference_byte_to_rmtitem(const rmt_pixel_strip_t *rps, uint8_t data, rmt_item32_t *dst);
+
+/**
+ * @brief Encode the strip's output buffer into the ugly buffer, one bit at a time
+ *
+ * The encoding of rmt_dled_send before `encode_table`, with the reset on the last item.
+ * Sets `item_count`, nothing else of `rps` changes.
+ */
+void dled_reference_encode_buffer(rmt_pixel_strip_t *rps);
+
+/**
+ * @brief Fill the output buffer with the pixels, choosing the color order for every pixel
+ *
+ * The runtime dispatch the encoders specialized by dled_format_select replaced: a
+ * switch on the LED type for every pixel. Same bytes as dled_strip_fill_buffer, without
+ * the high precision pixels. The buffer must be allocated.
+ */
+void dled_reference_fill_buffer(pixel_strip_t *strip);
+
+/**
+ * @brief Encode all the pixels into the ugly buffer, choosing the color order for every pixel
+ *
+ * Same items as rmt_dled_encode_pixels with every pixel changed, from `encode_table`.
+ * Sets `item_count`, nothing else of `rps` changes.
+ */
+void dled_reference_encode_pixels(rmt_pixel_strip_t *rps);
+
+/**
+ * @brief The rainbow before the cached palette, a dled_pixel_get_color_by_index for every pixel.
+ */
+void dled_reference_rainbow_step(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint16_t step);
+
+/**
+ * @brief The fade before dled_pixel_fade, a dled_scale8 for every color component of every pixel.
+ */
+void dled_reference_fade(pixel_t *pixels, uint32_t length, uint8_t scale);
+
+/**
+ * @brief The fade as a divide of every channel, `v * scale / 255`.
+ */
+void dled_reference_fade_divide(pixel_t *pixels, uint32_t length, uint8_t scale);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_ATTR_H_
+#define HOST_ESP_ATTR_H_
+
+/* Everything is in the same memory on the host */
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+/* What the modules use of FreeRTOS. The host programs run in one thread, so the
+* critical sections have nothing to keep out. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define configTICK_RATE_HZ 100
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY      (TickType_t)0xffffffffUL
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  pdFALSE
+#define pdPASS  pdTRUE
+
+#define BIT0 0x00000001
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+static inline void vPortCPUInitializeMutex(portMUX_TYPE *mux) {
+    mux->owner = 0;
+    mux->count = 0;
+}
+
+#define portENTER_CRITICAL(mux) do { (mux)->count++; } while (0)
+#define portEXIT_CRITICAL(mux)  do { (mux)->count--; } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_FREERTOS_TASK_H_
+#define HOST_FREERTOS_TASK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+/* Nothing else runs, there is nobody to wait for */
+static inline void vTaskDelay(TickType_t ticks) {
+    (void)ticks;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
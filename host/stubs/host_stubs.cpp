@@ -0,0 +1,321 @@
+/*
+ * ESP-IDF and FreeRTOS for the host programs, see host_stubs.h. The RMT driver is in rmt_host.cpp.
+ */
+
+#include "host_stubs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "nvs.h"
+#include "rom/crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+/* What the heap of an ESP32 has free once the network is up */
+#define HOST_HEAP_FREE_SIZE (160 * 1024)
+
+extern "C" {
+
+/* esp_err */
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                     return "ESP_OK";
+        case ESP_FAIL:                   return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:             return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:        return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:      return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:       return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:          return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:      return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:            return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC:        return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NVS_NOT_FOUND:      return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    }
+    return "UNKNOWN ERROR";
+}
+
+/* esp_log */
+
+static esp_log_level_t host_log_level = ESP_LOG_INFO;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    if (strcmp(tag, "*") == 0) { host_log_level = level; }
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > host_log_level) { return; }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", letters[level], tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+/* esp_timer */
+
+int64_t esp_timer_get_time(void) {
+    static int64_t start_us = -1;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    if (start_us < 0) { start_us = now_us; }
+
+    return now_us - start_us;
+}
+
+/* esp_heap_caps */
+
+static std::set<void*> host_heap_blocks;
+static size_t host_heap_largest = SIZE_MAX;
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    if (size != 0 && n > host_heap_largest / size) { return NULL; }
+
+    void *ptr = calloc(n, size);
+    if (ptr != NULL) { host_heap_blocks.insert(ptr); }
+    return ptr;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    return heap_caps_calloc(1, size, caps);
+}
+
+void heap_caps_free(void *ptr) {
+    if (ptr == NULL) { return; }
+    if (host_heap_blocks.erase(ptr) == 0) {
+        fprintf(stderr, "heap_caps_free: %p is not a block of the heap\n", ptr);
+        abort();
+    }
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    return HOST_HEAP_FREE_SIZE;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    (void)caps;
+    return HOST_HEAP_FREE_SIZE;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    (void)caps;
+    return host_heap_largest < HOST_HEAP_FREE_SIZE ? host_heap_largest : HOST_HEAP_FREE_SIZE;
+}
+
+size_t heap_caps_host_blocks(void) {
+    return host_heap_blocks.size();
+}
+
+void heap_caps_host_limit(size_t largest) {
+    host_heap_largest = largest;
+}
+
+/* rom/crc */
+
+uint32_t crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    crc = ~crc;
+    while (len-- > 0) {
+        crc ^= *buf++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* nvs, one map of every namespace */
+
+static std::vector<std::string> host_nvs_namespaces;
+static std::map<std::string, std::vector<uint8_t> > host_nvs_values;
+static uint32_t host_nvs_commits = 0;
+
+static bool host_nvs_key(nvs_handle handle, const char *key, std::string *name) {
+    if (handle == 0 || handle > host_nvs_namespaces.size() || key == NULL) { return false; }
+    *name = host_nvs_namespaces[handle - 1] + "/" + key;
+    return true;
+}
+
+static esp_err_t host_nvs_set(nvs_handle handle, const char *key, const void *value, size_t length) {
+    std::string name;
+    if (!host_nvs_key(handle, key, &name)) { return ESP_ERR_NVS_INVALID_HANDLE; }
+
+    const uint8_t *bytes = (const uint8_t*)value;
+    host_nvs_values[name].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+static esp_err_t host_nvs_get(nvs_handle handle, const char *key, void *out_value, size_t *length) {
+    std::string name;
+    if (!host_nvs_key(handle, key, &name)) { return ESP_ERR_NVS_INVALID_HANDLE; }
+
+    std::map<std::string, std::vector<uint8_t> >::const_iterator found = host_nvs_values.find(name);
+    if (found == host_nvs_values.end()) { return ESP_ERR_NVS_NOT_FOUND; }
+    if (out_value == NULL) {
+        *length = found->second.size();
+        return ESP_OK;
+    }
+    if (*length < found->second.size()) { return ESP_ERR_NVS_INVALID_LENGTH; }
+    memcpy(out_value, found->second.data(), found->second.size());
+    *length = found->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle) {
+    (void)open_mode;
+    if (name == NULL || out_handle == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    for (size_t i = 0; i < host_nvs_namespaces.size(); i++) {
+        if (host_nvs_namespaces[i] == name) {
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    host_nvs_namespaces.push_back(name);
+    *out_handle = host_nvs_namespaces.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle handle, const char *key, uint8_t value) {
+    return host_nvs_set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle handle, const char *key, uint8_t *out_value) {
+    size_t length = sizeof(uint8_t);
+    return host_nvs_get(handle, key, out_value, &length);
+}
+
+esp_err_t nvs_set_str(nvs_handle handle, const char *key, const char *value) {
+    return host_nvs_set(handle, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle handle, const char *key, char *out_value, size_t *length) {
+    return host_nvs_get(handle, key, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length) {
+    return host_nvs_set(handle, key, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length) {
+    return host_nvs_get(handle, key, out_value, length);
+}
+
+esp_err_t nvs_commit(nvs_handle handle) {
+    if (handle == 0 || handle > host_nvs_namespaces.size()) { return ESP_ERR_NVS_INVALID_HANDLE; }
+    host_nvs_commits++;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle handle) {
+    (void)handle;
+}
+
+void nvs_host_reset(void) {
+    host_nvs_values.clear();
+    host_nvs_commits = 0;
+}
+
+uint32_t nvs_host_commits(void) {
+    return host_nvs_commits;
+}
+
+/* freertos/queue */
+
+struct host_queue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t     *items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    QueueHandle_t queue = (QueueHandle_t)calloc(1, sizeof(struct host_queue));
+    if (queue == NULL) { return NULL; }
+
+    queue->items = (uint8_t*)calloc(length, item_size);
+    if (queue->items == NULL) {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue == NULL) { return; }
+    free(queue->items);
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    if (queue->count == queue->length) { return pdFALSE; }
+
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    if (queue->count == 0) { return pdFALSE; }
+
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->count;
+}
+
+/* freertos/semphr */
+
+struct host_semaphore {
+    bool taken;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return (SemaphoreHandle_t)calloc(1, sizeof(struct host_semaphore));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    if (semaphore->taken) { return pdFALSE; }
+    semaphore->taken = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (!semaphore->taken) { return pdFALSE; }
+    semaphore->taken = false;
+    return pdTRUE;
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef HOST_STUBS_H_
+#define HOST_STUBS_H_
+
+/*
+ * What the host programs can see and change of the ESP-IDF stubs.
+ *
+ * The stubs are just enough of ESP-IDF for the LED modules of main/ to build and run
+ * on Linux: the logs, the timer, the heap, NVS in memory, a FreeRTOS queue and an RMT
+ * driver which keeps the items it is given instead of sending them.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "driver/rmt.h"
+
+/**
+ * @brief Forget the channels, their records and the end of transmission callback.
+ */
+void rmt_host_reset(void);
+
+/**
+ * @brief Tell if a transmission of the channel is running
+ *
+ * A transmission runs from rmt_write_items or rmt_write_sample to the next
+ * rmt_wait_tx_done of the channel, or to the next transmission which waits for it.
+ */
+bool rmt_host_busy(rmt_channel_t channel);
+
+/**
+ * @brief Get the buffer given to rmt_write_items for the running transmission
+ *
+ * @return The buffer, NULL if nothing runs or the items are translated.
+ */
+const rmt_item32_t *rmt_host_on_wire(rmt_channel_t channel);
+
+/**
+ * @brief Get the items of the last transmission of the channel which ended
+ *
+ * For rmt_write_items, the items as they were when the transmission started.
+ * For rmt_write_sample, the items the translator wrote in the channel memory.
+ *
+ * @param[in]  channel The channel.
+ * @param[out] items   The items, valid until the next transmission of the channel.
+ *
+ * @return The number of items
+ */
+size_t rmt_host_items(rmt_channel_t channel, const rmt_item32_t **items);
+
+/**
+ * @brief Number of transmissions of the channel which ended.
+ */
+uint32_t rmt_host_transmissions(rmt_channel_t channel);
+
+/**
+ * @brief Number of calls of the translator of the channel, the first fill and every refill.
+ */
+uint32_t rmt_host_translations(rmt_channel_t channel);
+
+/**
+ * @brief Number of mistakes of the users of the channel
+ *
+ * Counts the buffers of rmt_write_items changed while they were sent, the translators
+ * which wrote more items than asked or translated more bytes than given, or stopped
+ * before the end.
+ */
+uint32_t rmt_host_errors(rmt_channel_t channel);
+
+/**
+ * @brief Number of heap_caps blocks not freed.
+ */
+size_t heap_caps_host_blocks(void);
+
+/**
+ * @brief Make the heap fail the blocks larger than `largest` bytes, SIZE_MAX for none
+ *
+ * heap_caps_get_largest_free_block then returns `largest`.
+ */
+void heap_caps_host_limit(size_t largest);
+
+/**
+ * @brief Forget everything NVS holds.
+ */
+void nvs_host_reset(void);
+
+/**
+ * @brief Number of nvs_commit since the last nvs_host_reset.
+ */
+uint32_t nvs_host_commits(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * The RMT driver of ESP-IDF v3 without the peripheral, see host_stubs.h.
+ *
+ * A transmission ends when it is waited for, so a program sees exactly what a slow
+ * strip would let it do while a frame is on the wire. The items of rmt_write_items are
+ * copied when the transmission starts and compared with the buffer when it ends, a
+ * buffer changed in between is an error. rmt_write_sample fills the channel memory
+ * like the driver: one whole memory block first, then half a block at a time as the
+ * channel empties. The refills of all the channels sending samples take turns.
+ */
+
+#include "host_stubs.h"
+
+#include <string.h>
+#include <vector>
+
+#include "esp_log.h"
+
+static const char *LOG_TAG  = "rmt_host";
+
+typedef struct {
+    bool                      installed;
+    uint8_t                   mem_block_num;
+    sample_to_rmt_t           translator;
+    bool                      busy;
+    const rmt_item32_t        *buffer;        /* buffer of rmt_write_items being sent */
+    const uint8_t             *sample_cur;    /* next byte of rmt_write_sample to translate */
+    size_t                    sample_remain;  /* bytes of rmt_write_sample left to translate */
+    std::vector<rmt_item32_t> sending;        /* items of the running transmission */
+    std::vector<rmt_item32_t> sent;           /* items of the last transmission which ended */
+    uint32_t                  transmissions;
+    uint32_t                  translations;
+    uint32_t                  errors;
+} host_rmt_channel_t;
+
+static host_rmt_channel_t    host_rmt_channels[RMT_CHANNEL_MAX];
+static rmt_tx_end_callback_t host_rmt_tx_end = { NULL, NULL };
+
+static bool host_rmt_valid(rmt_channel_t channel) {
+    return (unsigned)channel < RMT_CHANNEL_MAX;
+}
+
+/* Translates the next bytes of the sample into the channel memory, like the interrupt handler */
+static void host_rmt_translate(rmt_channel_t channel, size_t wanted_num) {
+    host_rmt_channel_t *ch = &host_rmt_channels[channel];
+    rmt_item32_t memory[8 * RMT_MEM_ITEM_NUM];
+    size_t translated_size = 0;
+    size_t item_num = 0;
+
+    ch->translator(ch->sample_cur, memory, ch->sample_remain, wanted_num, &translated_size, &item_num);
+    ch->translations++;
+    if (item_num > wanted_num || translated_size > ch->sample_remain) {
+        ESP_LOGE(LOG_TAG, "Channel %d: %u items for %u bytes, %u items and %u bytes allowed", channel,
+                 (unsigned)item_num, (unsigned)translated_size, (unsigned)wanted_num, (unsigned)ch->sample_remain);
+        ch->errors++;
+        ch->sample_remain = 0;
+        return;
+    }
+    if (translated_size == 0) {
+        ESP_LOGE(LOG_TAG, "Channel %d: the translator stopped %u bytes before the end", channel, (unsigned)ch->sample_remain);
+        ch->errors++;
+        ch->sample_remain = 0;
+        return;
+    }
+
+    ch->sending.insert(ch->sending.end(), memory, memory + item_num);
+    ch->sample_cur += translated_size;
+    ch->sample_remain -= translated_size;
+}
+
+static void host_rmt_end(rmt_channel_t channel) {
+    host_rmt_channel_t *ch = &host_rmt_channels[channel];
+    if (!ch->busy) { return; }
+
+    /* every channel sending samples refills half a block in turn */
+    while (ch->sample_remain > 0) {
+        for (uint8_t other = 0; other < RMT_CHANNEL_MAX; other++) {
+            host_rmt_channel_t *och = &host_rmt_channels[other];
+            if (och->busy && och->sample_remain > 0) {
+                host_rmt_translate((rmt_channel_t)other, och->mem_block_num * RMT_MEM_ITEM_NUM / 2);
+            }
+        }
+    }
+
+    if (ch->buffer != NULL &&
+        memcmp(ch->buffer, ch->sending.data(), ch->sending.size() * sizeof(rmt_item32_t)) != 0) {
+        ESP_LOGE(LOG_TAG, "Channel %d: the items changed while they were sent", channel);
+        ch->errors++;
+    }
+
+    ch->sent.swap(ch->sending);
+    ch->sending.clear();
+    ch->buffer = NULL;
+    ch->busy = false;
+    ch->transmissions++;
+    if (host_rmt_tx_end.function != NULL) {
+        host_rmt_tx_end.function(channel, host_rmt_tx_end.arg);
+    }
+}
+
+extern "C" {
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param) {
+    if (rmt_param == NULL || !host_rmt_valid(rmt_param->channel) || rmt_param->mem_block_num == 0 ||
+        rmt_param->channel + rmt_param->mem_block_num > RMT_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_rmt_channels[rmt_param->channel].mem_block_num = rmt_param->mem_block_num;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+    (void)rx_buf_size; (void)intr_alloc_flags;
+    if (!host_rmt_valid(channel)) { return ESP_ERR_INVALID_ARG; }
+
+    host_rmt_channel_t *ch = &host_rmt_channels[channel];
+    if (ch->installed) { return ESP_FAIL; } // the driver says it is already installed
+    if (ch->mem_block_num == 0) { ch->mem_block_num = 1; }
+    ch->installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t channel) {
+    return host_rmt_valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_tx_stop(rmt_channel_t channel) {
+    return host_rmt_valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_set_rx_intr_en(rmt_channel_t channel, bool en) {
+    (void)en;
+    return host_rmt_valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_set_err_intr_en(rmt_channel_t channel, bool en) {
+    (void)en;
+    return host_rmt_valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_set_tx_intr_en(rmt_channel_t channel, bool en) {
+    (void)en;
+    return host_rmt_valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_set_tx_thr_intr_en(rmt_channel_t channel, bool en, uint16_t evt_thresh) {
+    (void)en; (void)evt_thresh;
+    return host_rmt_valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_set_mem_pd(rmt_channel_t channel, bool pd_en) {
+    (void)pd_en;
+    return host_rmt_valid(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rmt_translator_init(rmt_channel_t channel, sample_to_rmt_t fn) {
+    if (!host_rmt_valid(channel) || fn == NULL) { return ESP_ERR_INVALID_ARG; }
+    if (!host_rmt_channels[channel].installed) { return ESP_FAIL; }
+
+    host_rmt_channels[channel].translator = fn;
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *rmt_item, int item_num, bool wait_tx_done) {
+    if (!host_rmt_valid(channel) || rmt_item == NULL || item_num <= 0) { return ESP_ERR_INVALID_ARG; }
+    host_rmt_channel_t *ch = &host_rmt_channels[channel];
+    if (!ch->installed) { return ESP_FAIL; }
+
+    host_rmt_end(channel); // the driver waits for the previous transmission
+    ch->busy = true;
+    ch->buffer = rmt_item;
+    ch->sending.assign(rmt_item, rmt_item + item_num);
+    if (wait_tx_done) { host_rmt_end(channel); }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_sample(rmt_channel_t channel, const uint8_t *src, size_t src_size, bool wait_tx_done) {
+    if (!host_rmt_valid(channel) || src == NULL || src_size == 0) { return ESP_ERR_INVALID_ARG; }
+    host_rmt_channel_t *ch = &host_rmt_channels[channel];
+    if (!ch->installed || ch->translator == NULL) { return ESP_FAIL; }
+
+    host_rmt_end(channel);
+    ch->busy = true;
+    ch->buffer = NULL;
+    ch->sending.clear();
+    ch->sample_cur = src;
+    ch->sample_remain = src_size;
+    host_rmt_translate(channel, ch->mem_block_num * RMT_MEM_ITEM_NUM);
+    if (wait_tx_done) { host_rmt_end(channel); }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t wait_time) {
+    (void)wait_time;
+    if (!host_rmt_valid(channel)) { return ESP_ERR_INVALID_ARG; }
+    if (!host_rmt_channels[channel].installed) { return ESP_FAIL; }
+
+    host_rmt_end(channel);
+    return ESP_OK;
+}
+
+rmt_tx_end_callback_t rmt_register_tx_end_callback(rmt_tx_end_fn_t function, void *arg) {
+    rmt_tx_end_callback_t previous = host_rmt_tx_end;
+    host_rmt_tx_end.function = function;
+    host_rmt_tx_end.arg = arg;
+    return previous;
+}
+
+void rmt_host_reset(void) {
+    for (uint8_t channel = 0; channel < RMT_CHANNEL_MAX; channel++) {
+        host_rmt_channel_t *ch = &host_rmt_channels[channel];
+        ch->installed = false;
+        ch->mem_block_num = 0;
+        ch->translator = NULL;
+        ch->busy = false;
+        ch->buffer = NULL;
+        ch->sample_cur = NULL;
+        ch->sample_remain = 0;
+        ch->sending.clear();
+        ch->sent.clear();
+        ch->transmissions = 0;
+        ch->translations = 0;
+        ch->errors = 0;
+    }
+    host_rmt_tx_end.function = NULL;
+    host_rmt_tx_end.arg = NULL;
+}
+
+bool rmt_host_busy(rmt_channel_t channel) {
+    return host_rmt_valid(channel) && host_rmt_channels[channel].busy;
+}
+
+const rmt_item32_t *rmt_host_on_wire(rmt_channel_t channel) {
+    return host_rmt_valid(channel) ? host_rmt_channels[channel].buffer : NULL;
+}
+
+size_t rmt_host_items(rmt_channel_t channel, const rmt_item32_t **items) {
+    if (!host_rmt_valid(channel)) { return 0; }
+    *items = host_rmt_channels[channel].sent.data();
+    return host_rmt_channels[channel].sent.size();
+}
+
+uint32_t rmt_host_transmissions(rmt_channel_t channel) {
+    return host_rmt_valid(channel) ? host_rmt_channels[channel].transmissions : 0;
+}
+
+uint32_t rmt_host_translations(rmt_channel_t channel) {
+    return host_rmt_valid(channel) ? host_rmt_channels[channel].translations : 0;
+}
+
+uint32_t rmt_host_errors(rmt_channel_t channel) {
+    return host_rmt_valid(channel) ? host_rmt_channels[channel].errors : 0;
+}
+
+}
@@ -0,0 +1,17 @@
+#ifndef HOST_ROM_CRC_H_
+#define HOST_ROM_CRC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* The CRC32 of the ROM, little endian, polynomial 0x04c11db7 */
+uint32_t crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_SOC_RMT_STRUCT_H_
+#define HOST_SOC_RMT_STRUCT_H_
+
+#include <stdint.h>
+
+/* An item of the RMT memory, two levels and their durations */
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 :15;
+            uint32_t level0 :1;
+            uint32_t duration1 :15;
+            uint32_t level1 :1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+#endif
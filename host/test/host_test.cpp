@@ -0,0 +1,85 @@
+/*
+ * Runs the tests of HOST_TEST.
+ *
+ *     dled_host_test [-v] [test ...]
+ *
+ * The logs of the modules are off, -v turns them on. Returns 1 if a test failed.
+ */
+
+#include "host_test.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "esp_log.h"
+#include "host_stubs.h"
+
+#define HOST_TEST_MAX 128
+
+typedef struct {
+    const char     *name;
+    host_test_fn_t fn;
+} host_test_t;
+
+static host_test_t host_tests[HOST_TEST_MAX];
+static int host_test_count;
+static int host_test_failures;
+
+int host_test_register(const char *name, host_test_fn_t fn) {
+    if (host_test_count == HOST_TEST_MAX) {
+        fprintf(stderr, "More than %d tests, %s is not run\n", HOST_TEST_MAX, name);
+        return -1;
+    }
+    host_tests[host_test_count].name = name;
+    host_tests[host_test_count].fn = fn;
+
+    return host_test_count++;
+}
+
+void host_test_fail(const char *file, int line, const char *format, ...) {
+    va_list args;
+
+    printf("    %s:%d: ", file, line);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+    host_test_failures++;
+}
+
+static bool host_test_selected(int argc, char **argv, int first, const char *name) {
+    if (first == argc) { return true; }
+    for (int i = first; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) { return true; }
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    int first = 1;
+    int run = 0, failed = 0;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+        esp_log_level_set("*", ESP_LOG_INFO);
+        first++;
+    }
+
+    for (int t = 0; t < host_test_count; t++) {
+        if (!host_test_selected(argc, argv, first, host_tests[t].name)) { continue; }
+
+        /* every test starts with the RMT driver not installed and NVS empty */
+        rmt_host_reset();
+        nvs_host_reset();
+        heap_caps_host_limit(SIZE_MAX);
+        host_test_failures = 0;
+        host_tests[t].fn();
+        printf("%s %s\n", host_test_failures == 0 ? "ok  " : "FAIL", host_tests[t].name);
+        fflush(stdout);
+        run++;
+        if (host_test_failures != 0) { failed++; }
+    }
+
+    printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+/*
+ * The tests of the host build, one file per module of main/ they cover.
+ *
+ * A test is a function declared with HOST_TEST, every check which fails is printed
+ * and fails the test, which goes on to its end. dled_host_test runs the tests in the
+ * order they are linked, or only the ones named on its command line.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void (*host_test_fn_t)(void);
+
+/**
+ * @brief Add a test to the ones dled_host_test runs, see HOST_TEST.
+ */
+int host_test_register(const char *name, host_test_fn_t fn);
+
+/**
+ * @brief Fail the running test, printing where and why.
+ */
+void host_test_fail(const char *file, int line, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#define HOST_TEST(name) \
+    static void name(void); \
+    static int name##_registered __attribute__((unused)) = host_test_register(#name, name); \
+    static void name(void)
+
+#define HOST_CHECK(expr) do { \
+        if (!(expr)) { host_test_fail(__FILE__, __LINE__, "%s", #expr); } \
+    } while (0)
+
+/* Integers only, both values are printed */
+#define HOST_CHECK_EQ(a, b) do { \
+        long long a_ = (long long)(a), b_ = (long long)(b); \
+        if (a_ != b_) { host_test_fail(__FILE__, __LINE__, "%s == %s, %lld != %lld", #a, #b, a_, b_); } \
+    } while (0)
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * dled_math: the fixed point helpers against the math they stand for.
+ */
+
+#include "host_test.h"
+
+#include <math.h>
+#include "dled_math.h"
+
+/* value * scale / 255 less than 1 away, exact for the scales 0 and 255 */
+HOST_TEST(dled_scale8_is_accurate) {
+    for (uint32_t value = 0; value < 256; value++) {
+        for (uint32_t scale = 0; scale < 256; scale++) {
+            double exact = value * scale / 255.0;
+            uint8_t scaled = dled_scale8(value, scale);
+            if (fabs(scaled - exact) >= 1.0) {
+                host_test_fail(__FILE__, __LINE__, "dled_scale8(%u, %u) = %u, %f", (unsigned)value, (unsigned)scale, scaled, exact);
+            }
+        }
+        HOST_CHECK_EQ(dled_scale8(value, 0), 0);
+        HOST_CHECK_EQ(dled_scale8(value, 255), value);
+    }
+}
+
+/* value * scale / 65535 less than 1 away, for every value and every 257th scale */
+HOST_TEST(dled_scale16_is_accurate) {
+    for (uint32_t value = 0; value < 65536; value++) {
+        for (uint32_t scale = 0; scale < 65536; scale += 257) {
+            double exact = value * (double)scale / 65535.0;
+            uint16_t scaled = dled_scale16(value, scale);
+            if (fabs(scaled - exact) >= 1.0) {
+                host_test_fail(__FILE__, __LINE__, "dled_scale16(%u, %u) = %u, %f", (unsigned)value, (unsigned)scale, scaled, exact);
+                return;
+            }
+        }
+        HOST_CHECK_EQ(dled_scale16(value, 65535), value);
+    }
+}
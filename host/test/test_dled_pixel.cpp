@@ -0,0 +1,182 @@
+/*
+ * dled_pixel: the effects helpers against the plain code they replaced.
+ */
+
+#include "host_test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dled_pixel.h"
+#include "dled_reference.h"
+#include "host_stubs.h"
+
+static bool test_same_pixel(pixel_t a, pixel_t b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+/* The cached palette is dled_pixel_get_color_by_index for every brightness and every index */
+HOST_TEST(dled_pixel_rainbow_color_is_exact) {
+    for (uint32_t max_cc_val = 0; max_cc_val < 256; max_cc_val++) {
+        uint32_t wrong = 0;
+        for (uint32_t index = 0; index < 65536; index++) {
+            if (!test_same_pixel(dled_pixel_rainbow_color(max_cc_val, index),
+                                 dled_pixel_get_color_by_index(max_cc_val, index))) {
+                wrong++;
+            }
+        }
+        if (wrong != 0) {
+            host_test_fail(__FILE__, __LINE__, "max_cc_val %u: %u colors differ", (unsigned)max_cc_val, (unsigned)wrong);
+        }
+    }
+}
+
+/* The walk of the palette wraps like the uint16_t index, past 65536 pixels too */
+HOST_TEST(dled_pixel_rainbow_step_is_exact) {
+    const uint32_t length = 70000;
+    const uint16_t steps[] = { 0, 1, 1529, 65000, 65535 };
+    pixel_t *fast = (pixel_t*)malloc(length * sizeof(pixel_t));
+    pixel_t *slow = (pixel_t*)malloc(length * sizeof(pixel_t));
+
+    for (uint32_t max_cc_val = 0; max_cc_val < 256; max_cc_val += (max_cc_val < 8) ? 1 : 7) {
+        for (uint8_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+            dled_pixel_rainbow_step(fast, length, max_cc_val, steps[s]);
+            dled_reference_rainbow_step(slow, length, max_cc_val, steps[s]);
+            if (memcmp(fast, slow, length * sizeof(pixel_t)) != 0) {
+                host_test_fail(__FILE__, __LINE__, "max_cc_val %u, step %u", (unsigned)max_cc_val, steps[s]);
+            }
+        }
+    }
+
+    free(fast);
+    free(slow);
+}
+
+/* The faded bytes of `buffer` are dled_scale8 of `before`, the others are left alone */
+static void test_check_fade(const uint8_t *buffer, const uint8_t *before, uint32_t size,
+                            uint32_t start, uint32_t count, uint8_t scale) {
+    for (uint32_t i = 0; i < size; i++) {
+        bool faded = i >= start && i < start + count;
+        uint8_t expected = faded ? dled_scale8(before[i], scale) : before[i];
+        if (buffer[i] != expected) {
+            host_test_fail(__FILE__, __LINE__, "scale %u, run %u + %u: byte %u is %u, not %u",
+                           scale, (unsigned)start, (unsigned)count, (unsigned)i, buffer[i], expected);
+            return;
+        }
+    }
+}
+
+/* The words of dled_pixel_fade give dled_scale8 of every component, whatever the alignment */
+HOST_TEST(dled_pixel_fade_is_exact) {
+    const uint32_t lengths[] = { 0, 1, 2, 3, 4, 5, 7, 33, 1000 };
+    const uint32_t size = 1000 * sizeof(pixel_t) + 16;
+    uint8_t *buffer = (uint8_t*)malloc(size);
+    uint8_t *before = (uint8_t*)malloc(size);
+
+    srand(14);
+    for (uint32_t i = 0; i < size; i++) { before[i] = rand(); }
+    /* every value against every scale */
+    for (uint32_t i = 0; i < 256; i++) { before[i + 8] = i; }
+
+    for (uint32_t scale = 0; scale < 256; scale++) {
+        for (uint8_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            for (uint32_t offset = 0; offset < 4; offset++) {
+                uint32_t start = 8 + offset;
+                uint32_t count = lengths[l] * sizeof(pixel_t);
+                memcpy(buffer, before, size);
+                dled_pixel_fade((pixel_t*)(buffer + start), lengths[l], scale);
+                test_check_fade(buffer, before, size, start, count, scale);
+            }
+        }
+    }
+
+    free(buffer);
+    free(before);
+}
+
+/* Each component less than 1 away from the per channel v * s / 255 it replaced */
+HOST_TEST(dled_pixel_fade_is_accurate) {
+    pixel_t pixels[256];
+
+    for (uint32_t scale = 0; scale < 256; scale++) {
+        for (uint32_t i = 0; i < 256; i++) { dled_pixel_set(&pixels[i], i, 255 - i, i ^ 0x5a); }
+        dled_pixel_fade(pixels, 256, scale);
+        for (uint32_t i = 0; i < 256; i++) {
+            const uint8_t values[3] = { (uint8_t)i, (uint8_t)(255 - i), (uint8_t)(i ^ 0x5a) };
+            const uint8_t faded[3] = { pixels[i].r, pixels[i].g, pixels[i].b };
+            for (uint8_t c = 0; c < 3; c++) {
+                double exact = values[c] * scale / 255.0;
+                if (fabs(faded[c] - exact) >= 1.0) {
+                    host_test_fail(__FILE__, __LINE__, "%u faded by %u is %u, %f", values[c], (unsigned)scale, faded[c], exact);
+                }
+            }
+        }
+    }
+}
+
+/* HSV in floating point: `sat` 0..1, `val` and the components in any range */
+static void test_hsv(uint16_t hue, double sat, double val, double *r, double *g, double *b) {
+    double h = hue * 6 / 65536.0;
+    int sector = (int)h;
+    double frac = h - sector;
+    double p = val * (1 - sat);
+    double q = val * (1 - sat * frac);
+    double t = val * (1 - sat * (1 - frac));
+
+    switch (sector) {
+    case 0:  *r = val; *g = t;   *b = p;   break;
+    case 1:  *r = q;   *g = val; *b = p;   break;
+    case 2:  *r = p;   *g = val; *b = t;   break;
+    case 3:  *r = p;   *g = q;   *b = val; break;
+    case 4:  *r = t;   *g = p;   *b = val; break;
+    default: *r = val; *g = p;   *b = q;   break;
+    }
+}
+
+static double test_hsv_error(double r, double g, double b, double exact_r, double exact_g, double exact_b) {
+    return fmax(fabs(r - exact_r), fmax(fabs(g - exact_g), fabs(b - exact_b)));
+}
+
+/* dled_pixel_hsv16 less than 2 away from floating point HSV, exact for red and for white */
+HOST_TEST(dled_pixel_hsv16_is_accurate) {
+    double worst = 0;
+
+    for (uint32_t hue = 0; hue < 65536; hue += 7) {
+        for (uint32_t sat = 0; sat < 65536; sat += 4369) {
+            for (uint32_t val = 0; val < 65536; val += 4369) {
+                pixel16_t pixel = dled_pixel_hsv16(hue, sat, val);
+                double r, g, b;
+                test_hsv(hue, sat / 65535.0, val, &r, &g, &b);
+                double error = test_hsv_error(pixel.r, pixel.g, pixel.b, r, g, b);
+                if (error > worst) { worst = error; }
+            }
+        }
+    }
+    if (worst >= 2.0) {
+        host_test_fail(__FILE__, __LINE__, "worst error %f", worst);
+    }
+
+    pixel16_t red = dled_pixel_hsv16(DLED_HUE_RED, 65535, 65535);
+    HOST_CHECK(red.r == 65535 && red.g == 0 && red.b == 0);
+    pixel16_t white = dled_pixel_hsv16(DLED_HUE_BLUE, 0, 40000);
+    HOST_CHECK(white.r == 40000 && white.g == 40000 && white.b == 40000);
+}
+
+/* dled_pixel_hsv less than 1 away from floating point HSV */
+HOST_TEST(dled_pixel_hsv_is_accurate) {
+    for (uint32_t hue = 0; hue < 65536; hue += 3) {
+        for (uint32_t sat = 0; sat < 256; sat += 5) {
+            for (uint32_t val = 0; val < 256; val += 5) {
+                pixel_t pixel = dled_pixel_hsv(hue, sat, val);
+                double r, g, b;
+                test_hsv(hue, sat / 255.0, val, &r, &g, &b);
+                double error = test_hsv_error(pixel.r, pixel.g, pixel.b, r, g, b);
+                if (error >= 1.0) {
+                    host_test_fail(__FILE__, __LINE__, "dled_pixel_hsv(%u, %u, %u) is %f away",
+                                   (unsigned)hue, (unsigned)sat, (unsigned)val, error);
+                    return;
+                }
+            }
+        }
+    }
+}
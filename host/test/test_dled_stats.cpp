@@ -0,0 +1,58 @@
+/*
+ * dled_stats: the windows of the render statistics and their readers.
+ */
+
+#include "host_test.h"
+
+#include <string.h>
+#include "dled_stats.h"
+#include "boot_arena.h"
+#include "host_stubs.h"
+
+static const char * const test_names[] = { "blank", "rainbow" };
+
+static void test_add_frames(dled_stats_t *stats, uint8_t effect, uint32_t count, uint32_t render_us) {
+    dled_stats_frame_t frame;
+
+    dled_stats_frame_init(&frame);
+    frame.stage_us[DLED_STATS_RENDER] = render_us;
+    for (uint32_t i = 0; i < count; i++) {
+        HOST_CHECK_EQ(dled_stats_add(stats, effect, &frame), ESP_OK);
+    }
+}
+
+/* Reading the telemetry window starts it again, the window since boot and /stats.json keep everything */
+HOST_TEST(dled_stats_windows_are_apart) {
+    dled_stats_t stats;
+    dled_stats_effect_t copy;
+    char json[DLED_STATS_JSON_SIZE];
+
+    HOST_CHECK_EQ(dled_stats_init(&stats, test_names, 2), ESP_OK);
+    test_add_frames(&stats, 1, 100, 40);
+
+    HOST_CHECK_EQ(dled_stats_read(&stats, DLED_STATS_PERIOD, 1, &copy), ESP_OK);
+    HOST_CHECK_EQ(copy.frames, 100);
+    HOST_CHECK_EQ(copy.stages[DLED_STATS_RENDER].count, 100);
+    HOST_CHECK_EQ(dled_stats_read(&stats, DLED_STATS_PERIOD, 1, &copy), ESP_OK);
+    HOST_CHECK_EQ(copy.frames, 0);
+
+    test_add_frames(&stats, 1, 20, 900);
+    HOST_CHECK_EQ(dled_stats_read(&stats, DLED_STATS_PERIOD, 1, &copy), ESP_OK);
+    HOST_CHECK_EQ(copy.frames, 20);
+    HOST_CHECK_EQ(copy.stages[DLED_STATS_RENDER].min_us, 900);
+
+    for (uint8_t read = 0; read < 2; read++) {
+        HOST_CHECK_EQ(dled_stats_read(&stats, DLED_STATS_SINCE_BOOT, 1, &copy), ESP_OK);
+        HOST_CHECK_EQ(copy.frames, 120);
+        HOST_CHECK_EQ(copy.stages[DLED_STATS_RENDER].min_us, 40);
+        HOST_CHECK_EQ(copy.stages[DLED_STATS_RENDER].max_us, 900);
+    }
+    HOST_CHECK(dled_stats_json(&stats, json, sizeof(json)) > 0);
+    HOST_CHECK(strstr(json, "\"frames\":120") != NULL);
+    HOST_CHECK(strstr(json, "blank") == NULL);
+
+    HOST_CHECK_EQ(dled_stats_read(&stats, DLED_STATS_WINDOWS, 1, &copy), ESP_ERR_INVALID_ARG);
+    HOST_CHECK_EQ(dled_stats_read(&stats, DLED_STATS_PERIOD, 2, &copy), ESP_ERR_INVALID_ARG);
+
+    boot_arena_free(stats.scratch);
+}
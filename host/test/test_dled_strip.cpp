@@ -0,0 +1,123 @@
+/*
+ * dled_strip: the output buffer of every LED format, with and without the transformations.
+ */
+
+#include "host_test.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "dled_strip.h"
+#include "dled_pixel.h"
+#include "dled_reference.h"
+#include "host_stubs.h"
+
+/* The specialized loops give the bytes of the switch on the LED type for every pixel */
+HOST_TEST(dled_strip_fills_every_format) {
+    const dstrip_type_t types[] = { DLED_WS2812, DLED_WS2811, DLED_SK6812, DLED_SK6812_RGBW };
+
+    for (uint8_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        pixel_strip_t strip;
+
+        dled_strip_init(&strip);
+        HOST_CHECK_EQ(dled_strip_create(&strip, types[t], 300, 180), ESP_OK);
+        dled_strip_set_gamma(&strip, true);
+        dled_pixel_hue_step(strip.pixels, strip.length, 500, 211, 230, 255);
+
+        for (uint8_t transform = 0; transform < 3; transform++) {
+            HOST_CHECK_EQ(dled_strip_set_transform(&strip, transform == 1, transform == 2, strip.length), ESP_OK);
+            dled_strip_set_offset(&strip, transform * 17);
+            HOST_CHECK_EQ(dled_strip_fill_buffer(&strip), ESP_OK);
+            std::vector<uint8_t> fast(strip.buffer, strip.buffer + strip.buffer_length);
+            dled_reference_fill_buffer(&strip);
+            if (memcmp(fast.data(), strip.buffer, strip.buffer_length) != 0) {
+                host_test_fail(__FILE__, __LINE__, "type %d, transform %d", types[t], transform);
+            }
+        }
+
+        dled_strip_destroy(&strip);
+    }
+}
+
+/* The level of a high precision component, for every brightness, with and without gamma:
+* `levels16` is the exact curve rounded, the interpolation between two entries stays within
+* 2 / 256 of an output level and 256 dithered frames average to it. */
+HOST_TEST(dled_strip_levels16_are_accurate) {
+    for (uint8_t gamma = 0; gamma < 2; gamma++) {
+        for (uint32_t max_cc_val = 1; max_cc_val < 256; max_cc_val++) {
+            pixel_strip_t strip;
+            double node = 0, interpolated = 0, dithered = 0;
+
+            dled_strip_init(&strip);
+            HOST_CHECK_EQ(dled_strip_create(&strip, DLED_WS2812, 1, max_cc_val), ESP_OK);
+            dled_strip_set_gamma(&strip, gamma);
+            HOST_CHECK_EQ(dled_strip_create_hd(&strip), ESP_OK);
+
+            for (uint32_t i = 0; i <= 256; i++) {
+                double exact = (gamma ? pow(i / 256.0, 2.2) : i / 256.0) * max_cc_val * 256;
+                node = fmax(node, fabs(strip.levels16[i] - exact));
+            }
+            for (uint32_t value = 0; value < 65536; value++) {
+                double exact = (gamma ? pow(value / 65536.0, 2.2) : value / 65536.0) * max_cc_val * 256;
+                uint32_t lo = strip.levels16[value >> 8];
+                uint32_t level = lo + (((strip.levels16[(value >> 8) + 1] - lo) * (value & 0xff)) >> 8);
+                interpolated = fmax(interpolated, fabs(level - exact));
+                if (value % 61 == 0) {
+                    uint8_t residual = 0;
+                    uint32_t sum = 0;
+                    for (uint32_t frame = 0; frame < 256; frame++) {
+                        sum += dled_strip_dither(strip.levels16, &residual, value);
+                    }
+                    dithered = fmax(dithered, fabs(sum - exact));
+                }
+            }
+            if (node > 0.51 || interpolated >= 2.0 || dithered >= 2.0) {
+                host_test_fail(__FILE__, __LINE__, "gamma %u, max_cc_val %u: off by %f, %f, %f in 1/256",
+                               gamma, (unsigned)max_cc_val, node, interpolated, dithered);
+            }
+
+            dled_strip_destroy(&strip);
+        }
+    }
+}
+
+/* 20000 RGBW pixels take 80000 bytes, past the uint16_t sizes of the strip before. The new
+* strip is off, every pixel and every dirty index reaches the end. */
+HOST_TEST(dled_strip_fills_20000_pixels) {
+    const uint32_t length = 20000;
+    pixel_strip_t strip;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_SK6812_RGBW, length, 255), ESP_OK);
+    HOST_CHECK_EQ(strip.length, length);
+    HOST_CHECK_EQ(strip.buffer_length, length * 4);
+
+    /* nothing else blanks the LEDs at boot */
+    uint32_t lit = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        if (strip.pixels[i].r != 0 || strip.pixels[i].g != 0 || strip.pixels[i].b != 0) { lit++; }
+    }
+    HOST_CHECK_EQ(lit, 0);
+    HOST_CHECK_EQ(dled_strip_fill_buffer(&strip), ESP_OK);
+    std::vector<uint8_t> off(strip.buffer_length, 0);
+    HOST_CHECK(memcmp(strip.buffer, off.data(), strip.buffer_length) == 0);
+
+    dled_strip_clear_dirty(&strip);
+    dled_strip_set_pixel(&strip, length - 1, 1, 2, 3);
+    HOST_CHECK_EQ(strip.dirty_first, length - 1);
+    HOST_CHECK_EQ(strip.dirty_end, length);
+
+    dled_pixel_hue_step(strip.pixels, length, 0, 3, 255, 255);
+    for (uint8_t transform = 0; transform < 3; transform++) {
+        HOST_CHECK_EQ(dled_strip_set_transform(&strip, transform == 1, transform == 2, length), ESP_OK);
+        dled_strip_set_offset(&strip, transform * 7001);
+        HOST_CHECK_EQ(dled_strip_fill_buffer(&strip), ESP_OK);
+        std::vector<uint8_t> fast(strip.buffer, strip.buffer + strip.buffer_length);
+        dled_reference_fill_buffer(&strip);
+        if (memcmp(fast.data(), strip.buffer, strip.buffer_length) != 0) {
+            host_test_fail(__FILE__, __LINE__, "transform %d", transform);
+        }
+    }
+
+    dled_strip_destroy(&strip);
+}
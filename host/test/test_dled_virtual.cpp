@@ -0,0 +1,138 @@
+/*
+ * dled_virtual: the recordings, and the sink created and destroyed again and again.
+ */
+
+#include "host_test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "dled_virtual.h"
+#include "host_stubs.h"
+
+#define TEST_LENGTH 30
+
+static uint32_t test_get32(const uint8_t *src) {
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static void test_set_pixels(pixel_strip_t *strip, uint8_t seed) {
+    for (uint32_t i = 0; i < strip->length; i++) {
+        dled_strip_set_pixel(strip, i, seed + i, seed + 2 * i, 255 - i);
+    }
+}
+
+/* The frames read back are the pixels in the order of the header */
+static void test_record(dstrip_type_t type, bool record_items) {
+    pixel_strip_t strip;
+    dled_virtual_sink_t sink;
+    dled_output_t output;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, type, TEST_LENGTH, 255), ESP_OK);
+    dled_virtual_init(&sink);
+    FILE *file = tmpfile();
+    HOST_CHECK(file != NULL);
+    HOST_CHECK_EQ(dled_virtual_create(&sink, &strip, file, record_items), ESP_OK);
+    HOST_CHECK_EQ(dled_virtual_output(&sink, &output), ESP_OK);
+    for (uint8_t f = 0; f < 3; f++) {
+        test_set_pixels(&strip, 40 * f);
+        HOST_CHECK_EQ(dled_output_send(&output), ESP_OK);
+    }
+    HOST_CHECK_EQ(sink.frame_count, 3);
+    dled_virtual_destroy(&sink);
+
+    uint8_t header[16];
+    rewind(file);
+    HOST_CHECK_EQ(fread(header, 1, sizeof(header), file), sizeof(header));
+    HOST_CHECK(memcmp(header, "DLED", 4) == 0);
+    HOST_CHECK_EQ(header[4], DLED_VIRTUAL_VERSION);
+    HOST_CHECK_EQ(header[5], record_items ? DLED_VIRTUAL_FLAG_ITEMS : 0);
+    HOST_CHECK_EQ(header[6], strip.bytes_per_led);
+    HOST_CHECK_EQ(test_get32(&header[12]), TEST_LENGTH);
+
+    uint8_t data[TEST_LENGTH * 4];
+    for (uint8_t f = 0; f < 3; f++) {
+        uint8_t time[8];
+        HOST_CHECK_EQ(fread(time, 1, sizeof(time), file), sizeof(time));
+        HOST_CHECK_EQ(fread(data, 1, strip.buffer_length, file), strip.buffer_length);
+        for (uint32_t i = 0; i < TEST_LENGTH; i++) {
+            uint8_t rgbw[4] = { (uint8_t)(40 * f + i), (uint8_t)(40 * f + 2 * i), (uint8_t)(255 - i), 0 };
+            if (strip.bytes_per_led == 4) {
+                /* the white LED takes the part common to the three colors */
+                uint8_t w = rgbw[0] < rgbw[1] ? rgbw[0] : rgbw[1];
+                if (rgbw[2] < w) { w = rgbw[2]; }
+                for (uint8_t c = 0; c < 3; c++) { rgbw[c] -= w; }
+                rgbw[3] = w;
+            }
+            for (uint8_t c = 0; c < strip.bytes_per_led; c++) {
+                HOST_CHECK_EQ(data[i * strip.bytes_per_led + c], rgbw[header[7 + c]]);
+            }
+        }
+        if (record_items) {
+            uint8_t count[4];
+            HOST_CHECK_EQ(fread(count, 1, sizeof(count), file), sizeof(count));
+            HOST_CHECK_EQ(test_get32(count), strip.buffer_length * RMT_DLED_ITEMS_PER_BYTE);
+            HOST_CHECK_EQ(fseek(file, test_get32(count) * 4, SEEK_CUR), 0);
+        }
+    }
+    HOST_CHECK_EQ(fgetc(file), EOF);
+
+    fclose(file);
+    dled_strip_destroy(&strip);
+}
+
+HOST_TEST(dled_virtual_records_pixels) {
+    test_record(DLED_WS2812, false);
+    test_record(DLED_WS2811, false);
+    test_record(DLED_SK6812_RGBW, false);
+}
+
+HOST_TEST(dled_virtual_records_items) {
+    test_record(DLED_WS2812, true);
+    test_record(DLED_SK6812_RGBW, true);
+}
+
+/* Recording is started and stopped at will, the encoder must not come from the boot arena */
+HOST_TEST(dled_virtual_gives_memory_back) {
+    pixel_strip_t strip;
+    dled_virtual_sink_t sink;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_WS2812, TEST_LENGTH, 255), ESP_OK);
+    dled_virtual_init(&sink);
+    FILE *file = tmpfile();
+    size_t blocks = heap_caps_host_blocks();
+
+    for (uint8_t i = 0; i < 5; i++) {
+        HOST_CHECK_EQ(dled_virtual_create(&sink, &strip, file, true), ESP_OK);
+        HOST_CHECK(sink.rps.heap);
+        HOST_CHECK(sink.rps.ugly_buffers[0] == sink.rps.ugly_buffers[1]);
+        HOST_CHECK_EQ(dled_virtual_record(&sink), ESP_OK);
+        HOST_CHECK_EQ(dled_virtual_destroy(&sink), ESP_OK);
+        HOST_CHECK_EQ(heap_caps_host_blocks(), blocks);
+    }
+
+    fclose(file);
+    dled_strip_destroy(&strip);
+}
+
+HOST_TEST(dled_virtual_header_failure_keeps_nothing) {
+    pixel_strip_t strip;
+    dled_virtual_sink_t sink;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_WS2812, TEST_LENGTH, 255), ESP_OK);
+    dled_virtual_init(&sink);
+    FILE *file = fopen("/dev/null", "rb"); // writing fails
+    HOST_CHECK(file != NULL);
+    size_t blocks = heap_caps_host_blocks();
+
+    HOST_CHECK_EQ(dled_virtual_create(&sink, &strip, file, true), ESP_FAIL);
+    HOST_CHECK_EQ(heap_caps_host_blocks(), blocks);
+    HOST_CHECK(sink.frame == NULL);
+    HOST_CHECK(sink.rps.encode_table == NULL);
+    HOST_CHECK(sink.strip == NULL);
+
+    fclose(file);
+    dled_strip_destroy(&strip);
+}
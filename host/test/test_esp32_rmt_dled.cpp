@@ -0,0 +1,345 @@
+/*
+ * esp32_rmt_dled: the encoders and the translators, against the RMT driver of the stubs.
+ */
+
+#include "host_test.h"
+
+#include <string.h>
+#include <vector>
+#include "esp32_rmt_dled.h"
+#include "dled_reference.h"
+#include "dled_pixel.h"
+#include "host_stubs.h"
+
+static void test_set_pixels(pixel_strip_t *strip, uint8_t seed) {
+    for (uint32_t i = 0; i < strip->length; i++) {
+        dled_strip_set_pixel(strip, i, seed + 3 * i, 200 - i, seed ^ i);
+    }
+}
+
+/* All the items of the frame, encoded by a fresh encoder. The strip is copied, its changes stay marked */
+static std::vector<rmt_item32_t> test_encode_all(const pixel_strip_t *strip) {
+    pixel_strip_t copy = *strip;
+    rmt_pixel_strip_t rps;
+    std::vector<rmt_item32_t> items;
+
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create_heap(&rps, &copy), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+    items.assign(rps.ugly_buffer, rps.ugly_buffer + rps.item_count);
+    rmt_dled_destroy(&rps);
+
+    return items;
+}
+
+/* The items of the last transmission of `channel` which ended are `expected` */
+static void test_check_items(rmt_channel_t channel, const std::vector<rmt_item32_t> &expected) {
+    const rmt_item32_t *items;
+
+    HOST_CHECK_EQ(rmt_host_items(channel, &items), expected.size());
+    HOST_CHECK(memcmp(items, expected.data(), expected.size() * sizeof(rmt_item32_t)) == 0);
+}
+
+/* An RGBW strip sends 4 bytes for every 3 bytes of pixels: the translator used to find its
+* strip from the address being sent, which ran into the pixels of the strip allocated next.
+* Here the pixels of two strips are next to each other and both stream at the same time,
+* their refills taking turns. */
+HOST_TEST(rmt_dled_streams_rgbw_on_two_channels) {
+    static pixel_t pixels[2 * 100];
+    pixel_strip_t strips[2];
+    pixel_t *own[2];
+    rmt_pixel_strip_t rps[2];
+
+    for (uint8_t s = 0; s < 2; s++) {
+        dled_strip_init(&strips[s]);
+        HOST_CHECK_EQ(dled_strip_create(&strips[s], DLED_SK6812_RGBW, 100, 255), ESP_OK);
+        own[s] = strips[s].pixels;
+        strips[s].pixels = &pixels[100 * s];
+        test_set_pixels(&strips[s], 7 + 100 * s);
+
+        rmt_dled_init(&rps[s]);
+        HOST_CHECK_EQ(rmt_dled_create_streaming(&rps[s], &strips[s]), ESP_OK);
+        HOST_CHECK_EQ(rmt_dled_config(&rps[s], (gpio_num_t)18, (rmt_channel_t)s), ESP_OK);
+    }
+    for (uint8_t s = 0; s < 2; s++) {
+        HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps[s]), ESP_OK);
+        HOST_CHECK_EQ(rmt_dled_start(&rps[s]), ESP_OK);
+    }
+    HOST_CHECK(rmt_host_busy(RMT_CHANNEL_0) && rmt_host_busy(RMT_CHANNEL_1));
+    for (uint8_t s = 0; s < 2; s++) {
+        HOST_CHECK_EQ(rmt_dled_wait(&rps[s], portMAX_DELAY), ESP_OK);
+    }
+
+    for (uint8_t s = 0; s < 2; s++) {
+        rmt_channel_t channel = (rmt_channel_t)s;
+        HOST_CHECK_EQ(rmt_host_errors(channel), 0);
+        HOST_CHECK_EQ(rmt_host_transmissions(channel), 1);
+        HOST_CHECK(rmt_host_translations(channel) > 1);
+        test_check_items(channel, test_encode_all(&strips[s]));
+        rmt_dled_destroy(&rps[s]);
+        strips[s].pixels = own[s];
+        dled_strip_destroy(&strips[s]);
+    }
+}
+
+/* The same with the high precision pixels, dithered by the translator */
+HOST_TEST(rmt_dled_streams_hd) {
+    pixel_strip_t strip;
+    rmt_pixel_strip_t rps;
+    const rmt_item32_t *items;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_SK6812_RGBW, 60, 255), ESP_OK);
+    HOST_CHECK_EQ(dled_strip_create_hd(&strip), ESP_OK);
+    HOST_CHECK_EQ(dled_strip_set_hd(&strip, true), ESP_OK);
+    for (uint32_t i = 0; i < strip.length; i++) {
+        strip.pixels16[i].r = 257 * i;
+        strip.pixels16[i].g = 65535 - 1000 * i;
+        strip.pixels16[i].b = 128 * i + 77;
+    }
+
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create_streaming(&rps, &strip), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_config(&rps, (gpio_num_t)18, RMT_CHANNEL_2), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_send_pixels(&rps), ESP_OK);
+    HOST_CHECK_EQ(rmt_host_errors(RMT_CHANNEL_2), 0);
+    size_t count = rmt_host_items(RMT_CHANNEL_2, &items);
+    HOST_CHECK_EQ(count, strip.length * 4 * RMT_DLED_ITEMS_PER_BYTE);
+
+    /* the encoder dithers from the residuals the translator left, start both from 0 */
+    memset(strip.residuals, 0, strip.length * strip.bytes_per_led);
+    test_check_items(RMT_CHANNEL_2, test_encode_all(&strip));
+
+    rmt_dled_destroy(&rps);
+    dled_strip_destroy(&strip);
+}
+
+/* Frame N+1 is encoded into the other buffer while N is on the wire, only the pixels
+* changed since that buffer was encoded are encoded again */
+HOST_TEST(rmt_dled_encodes_while_sending) {
+    pixel_strip_t strip;
+    rmt_pixel_strip_t rps;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_WS2812, 50, 255), ESP_OK);
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create(&rps, &strip), ESP_OK);
+    HOST_CHECK(rps.ugly_buffers[0] != rps.ugly_buffers[1]);
+    HOST_CHECK_EQ(rmt_dled_config(&rps, (gpio_num_t)18, RMT_CHANNEL_0), ESP_OK);
+
+    /* frame 0, everything into buffer 0 */
+    test_set_pixels(&strip, 1);
+    std::vector<rmt_item32_t> frame0 = test_encode_all(&strip);
+    HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+    HOST_CHECK(rps.ugly_buffer == rps.ugly_buffers[0]);
+    HOST_CHECK(rps.dirty_first[0] >= rps.dirty_end[0]);
+    HOST_CHECK_EQ(rps.dirty_first[1], 0);
+    HOST_CHECK_EQ(rps.dirty_end[1], 50);
+    HOST_CHECK_EQ(rmt_dled_start(&rps), ESP_OK);
+    HOST_CHECK(rmt_host_on_wire(RMT_CHANNEL_0) == rps.ugly_buffers[0]);
+
+    /* frame 1 changes pixels 10 to 14, buffer 1 has never been encoded */
+    for (uint32_t i = 10; i < 15; i++) {
+        dled_strip_set_pixel(&strip, i, 255, 0, i);
+    }
+    std::vector<rmt_item32_t> frame1 = test_encode_all(&strip);
+    HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+    HOST_CHECK(rmt_host_busy(RMT_CHANNEL_0));
+    HOST_CHECK(rmt_host_on_wire(RMT_CHANNEL_0) == rps.ugly_buffers[0]);
+    HOST_CHECK(rps.ugly_buffer == rps.ugly_buffers[1]);
+    HOST_CHECK_EQ(rps.dirty_first[0], 10);
+    HOST_CHECK_EQ(rps.dirty_end[0], 15);
+    HOST_CHECK(rps.dirty_first[1] >= rps.dirty_end[1]);
+    HOST_CHECK_EQ(rmt_dled_start(&rps), ESP_OK);
+    test_check_items(RMT_CHANNEL_0, frame0);
+    HOST_CHECK(rmt_host_on_wire(RMT_CHANNEL_0) == rps.ugly_buffers[1]);
+
+    /* frame 2 changes pixel 40, buffer 0 still misses pixels 10 to 14 */
+    dled_strip_set_pixel(&strip, 40, 0, 0, 255);
+    std::vector<rmt_item32_t> frame2 = test_encode_all(&strip);
+    HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+    HOST_CHECK(rmt_host_busy(RMT_CHANNEL_0));
+    HOST_CHECK(rps.ugly_buffer == rps.ugly_buffers[0]);
+    HOST_CHECK(rps.dirty_first[0] >= rps.dirty_end[0]);
+    HOST_CHECK_EQ(rps.dirty_first[1], 40);
+    HOST_CHECK_EQ(rps.dirty_end[1], 41);
+    HOST_CHECK_EQ(rmt_dled_start(&rps), ESP_OK);
+    test_check_items(RMT_CHANNEL_0, frame1);
+
+    /* frame 3 changes nothing, buffer 1 only gets pixel 40 */
+    HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+    HOST_CHECK(rps.dirty_first[1] >= rps.dirty_end[1]);
+    HOST_CHECK_EQ(rmt_dled_start(&rps), ESP_OK);
+    test_check_items(RMT_CHANNEL_0, frame2);
+    HOST_CHECK_EQ(rmt_dled_wait(&rps, portMAX_DELAY), ESP_OK);
+    test_check_items(RMT_CHANNEL_0, frame2);
+
+    /* no buffer was changed while it was sent */
+    HOST_CHECK_EQ(rmt_host_errors(RMT_CHANNEL_0), 0);
+    HOST_CHECK_EQ(rmt_host_transmissions(RMT_CHANNEL_0), 4);
+
+    rmt_dled_destroy(&rps);
+    dled_strip_destroy(&strip);
+}
+
+/* With a single buffer, encoding waits for the end of the transmission */
+HOST_TEST(rmt_dled_encodes_after_sending_with_one_buffer) {
+    pixel_strip_t strip;
+    rmt_pixel_strip_t rps;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_WS2812, 50, 255), ESP_OK);
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create_heap(&rps, &strip), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_config(&rps, (gpio_num_t)18, RMT_CHANNEL_0), ESP_OK);
+
+    std::vector<rmt_item32_t> frames[3];
+    for (uint8_t f = 0; f < 3; f++) {
+        dled_strip_set_pixel(&strip, 5 * f, 255, f, 0);
+        frames[f] = test_encode_all(&strip);
+        HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+        HOST_CHECK(!rmt_host_busy(RMT_CHANNEL_0));
+        if (f > 0) { test_check_items(RMT_CHANNEL_0, frames[f - 1]); }
+        HOST_CHECK_EQ(rmt_dled_start(&rps), ESP_OK);
+    }
+    HOST_CHECK_EQ(rmt_dled_wait(&rps, portMAX_DELAY), ESP_OK);
+    test_check_items(RMT_CHANNEL_0, frames[2]);
+    HOST_CHECK_EQ(rmt_host_errors(RMT_CHANNEL_0), 0);
+
+    rmt_dled_destroy(&rps);
+    dled_strip_destroy(&strip);
+}
+
+/* encode_table gives the items of the encoder one bit at a time, for every byte value */
+HOST_TEST(rmt_dled_table_encodes_every_byte) {
+    pixel_strip_t strip;
+    rmt_pixel_strip_t rps;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_WS2812, 86, 255), ESP_OK); // 258 bytes
+    HOST_CHECK_EQ(dled_strip_fill_buffer(&strip), ESP_OK);
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create_heap(&rps, &strip), ESP_OK);
+
+    for (uint32_t data = 0; data < 256; data++) {
+        rmt_item32_t bits[RMT_DLED_ITEMS_PER_BYTE];
+        dled_reference_byte_to_rmtitem(&rps, data, bits);
+        if (memcmp(bits, &rps.encode_table[data * RMT_DLED_ITEMS_PER_BYTE], sizeof(bits)) != 0) {
+            host_test_fail(__FILE__, __LINE__, "byte 0x%02x", (unsigned)data);
+        }
+    }
+
+    /* and through rmt_dled_encode_buffer, with the reset on the last item */
+    for (uint32_t i = 0; i < strip.buffer_length; i++) {
+        strip.buffer[i] = i;
+    }
+    for (uint8_t last = 0; last < 2; last++) {
+        strip.buffer[strip.buffer_length - 1] = last ? 0x01 : 0x00;
+        HOST_CHECK_EQ(rmt_dled_encode_buffer(&rps), ESP_OK);
+        std::vector<rmt_item32_t> table(rps.ugly_buffer, rps.ugly_buffer + rps.item_count);
+        dled_reference_encode_buffer(&rps);
+        HOST_CHECK_EQ(table.size(), rps.item_count);
+        HOST_CHECK(memcmp(table.data(), rps.ugly_buffer, table.size() * sizeof(rmt_item32_t)) == 0);
+        HOST_CHECK_EQ(table.back().val, last ? rps.rmtHR.val : rps.rmtLR.val);
+    }
+
+    rmt_dled_destroy(&rps);
+    dled_strip_destroy(&strip);
+}
+
+/* A whole strip of every format, the fused encoder against the output buffer encoded one bit at a time */
+HOST_TEST(rmt_dled_table_encodes_strips) {
+    const dstrip_type_t types[] = { DLED_WS2812, DLED_WS2811, DLED_SK6812_RGBW };
+
+    for (uint8_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        pixel_strip_t strip;
+        rmt_pixel_strip_t rps;
+
+        dled_strip_init(&strip);
+        HOST_CHECK_EQ(dled_strip_create(&strip, types[t], 1000, 255), ESP_OK);
+        dled_pixel_hue_step(strip.pixels, strip.length, 1000, 97, 200, 255);
+        rmt_dled_init(&rps);
+        HOST_CHECK_EQ(rmt_dled_create_heap(&rps, &strip), ESP_OK);
+
+        dled_strip_mark_all_dirty(&strip);
+        HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+        std::vector<rmt_item32_t> table(rps.ugly_buffer, rps.ugly_buffer + rps.item_count);
+        HOST_CHECK_EQ(dled_strip_fill_buffer(&strip), ESP_OK);
+        dled_reference_encode_buffer(&rps);
+        HOST_CHECK_EQ(table.size(), rps.item_count);
+        HOST_CHECK(memcmp(table.data(), rps.ugly_buffer, table.size() * sizeof(rmt_item32_t)) == 0);
+
+        rmt_dled_destroy(&rps);
+        dled_strip_destroy(&strip);
+    }
+}
+
+/* The specialized encoders give the items of the switch on the LED type for every pixel */
+HOST_TEST(rmt_dled_encodes_every_format) {
+    const dstrip_type_t types[] = { DLED_WS2812, DLED_WS2811, DLED_SK6812, DLED_SK6812_RGBW };
+
+    for (uint8_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        pixel_strip_t strip;
+        rmt_pixel_strip_t rps;
+
+        dled_strip_init(&strip);
+        HOST_CHECK_EQ(dled_strip_create(&strip, types[t], 300, 180), ESP_OK);
+        dled_pixel_hue_step(strip.pixels, strip.length, 500, 211, 230, 255);
+        rmt_dled_init(&rps);
+        HOST_CHECK_EQ(rmt_dled_create_heap(&rps, &strip), ESP_OK);
+
+        for (uint8_t transform = 0; transform < 3; transform++) {
+            HOST_CHECK_EQ(dled_strip_set_transform(&strip, transform == 1, transform == 2, strip.length), ESP_OK);
+            dled_strip_set_offset(&strip, transform * 17);
+            dled_strip_mark_all_dirty(&strip);
+            HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+            std::vector<rmt_item32_t> fast(rps.ugly_buffer, rps.ugly_buffer + rps.item_count);
+            dled_reference_encode_pixels(&rps);
+            HOST_CHECK_EQ(fast.size(), rps.item_count);
+            if (memcmp(fast.data(), rps.ugly_buffer, fast.size() * sizeof(rmt_item32_t)) != 0) {
+                host_test_fail(__FILE__, __LINE__, "type %d, transform %d", types[t], transform);
+            }
+        }
+
+        rmt_dled_destroy(&rps);
+        dled_strip_destroy(&strip);
+    }
+}
+
+/* 20000 RGBW pixels are 640000 items, encoded in advance and streamed, past the uint16_t
+* item counts of the output before */
+HOST_TEST(rmt_dled_sends_20000_pixels) {
+    const uint32_t length = 20000;
+    pixel_strip_t strip;
+    rmt_pixel_strip_t rps;
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_SK6812_RGBW, length, 255), ESP_OK);
+    dled_pixel_hue_step(strip.pixels, length, 0, 3, 255, 255);
+    std::vector<rmt_item32_t> frame = test_encode_all(&strip);
+    HOST_CHECK_EQ(frame.size(), length * 4 * RMT_DLED_ITEMS_PER_BYTE);
+
+    /* encoded in advance, against the switch for every pixel */
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create_heap(&rps, &strip), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_config(&rps, (gpio_num_t)18, RMT_CHANNEL_0), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_send_pixels(&rps), ESP_OK);
+    test_check_items(RMT_CHANNEL_0, frame);
+    dled_reference_encode_pixels(&rps);
+    HOST_CHECK_EQ(rps.item_count, frame.size());
+    HOST_CHECK(memcmp(rps.ugly_buffer, frame.data(), frame.size() * sizeof(rmt_item32_t)) == 0);
+    rmt_dled_destroy(&rps);
+
+    /* streamed, the pixels are translated in many refills */
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create_streaming(&rps, &strip), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_config(&rps, (gpio_num_t)18, RMT_CHANNEL_1), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_send_pixels(&rps), ESP_OK);
+    HOST_CHECK(rmt_host_translations(RMT_CHANNEL_1) > 1);
+    test_check_items(RMT_CHANNEL_1, frame);
+    rmt_dled_destroy(&rps);
+
+    HOST_CHECK_EQ(rmt_host_errors(RMT_CHANNEL_0), 0);
+    HOST_CHECK_EQ(rmt_host_errors(RMT_CHANNEL_1), 0);
+    dled_strip_destroy(&strip);
+}
@@ -0,0 +1,92 @@
+/*
+ * esp32_rmt_dled_manager: a logical strip split across RMT channels.
+ */
+
+#include "host_test.h"
+
+#include <string.h>
+#include "esp32_rmt_dled_manager.h"
+#include "dled_pixel.h"
+#include "host_stubs.h"
+
+/* The items of the segment sent on `channel` are the pixels of its part of the logical strip */
+static void test_check_segment(rmt_dled_segment_t *segment, rmt_channel_t channel, const pixel_strip_t *strip, uint32_t first) {
+    const rmt_item32_t *items;
+    size_t count = rmt_host_items(channel, &items);
+    uint32_t length = segment->view.length;
+
+    HOST_CHECK_EQ(count, length * strip->bytes_per_led * RMT_DLED_ITEMS_PER_BYTE);
+    if (count != length * strip->bytes_per_led * RMT_DLED_ITEMS_PER_BYTE) { return; }
+
+    pixel_strip_t alone;
+    rmt_pixel_strip_t rps;
+    dled_strip_init(&alone);
+    HOST_CHECK_EQ(dled_strip_create(&alone, strip->type, length, strip->max_cc_val), ESP_OK);
+    memcpy(alone.pixels, strip->pixels + first, length * sizeof(pixel_t));
+    rmt_dled_init(&rps);
+    HOST_CHECK_EQ(rmt_dled_create_heap(&rps, &alone), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_encode_pixels(&rps), ESP_OK);
+    HOST_CHECK_EQ(rps.item_count, count);
+    HOST_CHECK(memcmp(rps.ugly_buffer, items, count * sizeof(rmt_item32_t)) == 0);
+    rmt_dled_destroy(&rps);
+    dled_strip_destroy(&alone);
+}
+
+/* A strip of 20000 pixels on two segments, the first one too long for the memory left is
+* streamed. The first frame, with nothing drawn, turns every LED off. */
+HOST_TEST(rmt_dled_manager_sends_20000_pixels) {
+    const uint32_t length = 20000;
+    const uint32_t split = 12000;
+    pixel_strip_t strip;
+    rmt_dled_manager_t manager;
+    size_t blocks = heap_caps_host_blocks();
+
+    dled_strip_init(&strip);
+    HOST_CHECK_EQ(dled_strip_create(&strip, DLED_WS2812, length, 255), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_manager_init(&manager, &strip), ESP_OK);
+
+    /* 8000 RGB pixels are 768000 bytes of items, 12000 are 1152000 */
+    heap_caps_host_limit(1000000);
+    HOST_CHECK_EQ(rmt_dled_manager_add_segment(&manager, 0, split, (gpio_num_t)18, false), ESP_OK);
+    HOST_CHECK_EQ(rmt_dled_manager_add_segment(&manager, split, length - split, (gpio_num_t)19, false), ESP_OK);
+    heap_caps_host_limit(SIZE_MAX);
+    HOST_CHECK_EQ(manager.count, 2);
+    HOST_CHECK(manager.segments[0].rps.streaming);
+    HOST_CHECK(!manager.segments[1].rps.streaming);
+
+    /* off: every bit is a 0, the last one with the reset */
+    HOST_CHECK_EQ(rmt_dled_manager_send(&manager), ESP_OK);
+    for (uint8_t s = 0; s < 2; s++) {
+        const rmt_item32_t *items;
+        size_t count = rmt_host_items((rmt_channel_t)s, &items);
+        rmt_pixel_strip_t *rps = &manager.segments[s].rps;
+        HOST_CHECK_EQ(count, manager.segments[s].view.length * 3 * RMT_DLED_ITEMS_PER_BYTE);
+        uint32_t lit = 0;
+        for (size_t i = 0; i + 1 < count; i++) {
+            if (items[i].val != rps->rmtLO.val) { lit++; }
+        }
+        HOST_CHECK_EQ(lit, 0);
+        HOST_CHECK(count > 0 && items[count - 1].val == rps->rmtLR.val);
+    }
+
+    dled_pixel_hue_step(strip.pixels, length, 0, 3, 255, 255);
+    dled_strip_mark_all_dirty(&strip);
+    HOST_CHECK_EQ(rmt_dled_manager_send(&manager), ESP_OK);
+    test_check_segment(&manager.segments[0], RMT_CHANNEL_0, &strip, 0);
+    test_check_segment(&manager.segments[1], RMT_CHANNEL_1, &strip, split);
+
+    /* one changed pixel near the end is only sent by the second segment */
+    dled_strip_set_pixel(&strip, length - 1, 255, 255, 255);
+    HOST_CHECK_EQ(rmt_dled_manager_send(&manager), ESP_OK);
+    HOST_CHECK_EQ(rmt_host_transmissions(RMT_CHANNEL_0), 2);
+    HOST_CHECK_EQ(rmt_host_transmissions(RMT_CHANNEL_1), 3);
+    test_check_segment(&manager.segments[1], RMT_CHANNEL_1, &strip, split);
+
+    for (uint8_t s = 0; s < manager.count; s++) {
+        HOST_CHECK_EQ(rmt_host_errors((rmt_channel_t)s), 0);
+        rmt_dled_destroy(&manager.segments[s].rps);
+        dled_strip_destroy(&manager.segments[s].view);
+    }
+    dled_strip_destroy(&strip);
+    HOST_CHECK_EQ(heap_caps_host_blocks(), blocks);
+}
@@ -0,0 +1,102 @@
+/*
+ * light_commands: bursts of commands into a small queue, drained once per frame.
+ */
+
+#include "host_test.h"
+
+#include "light_commands.h"
+#include "host_stubs.h"
+
+#define TEST_QUEUE_LENGTH 16
+#define TEST_EFFECTS      10
+
+/* The kind and the value of the command `i` of a burst, every kind takes turns */
+static light_command_type_t test_type(uint32_t i) {
+    return (light_command_type_t)(i % LIGHT_COMMAND_RESTART);
+}
+
+static uint32_t test_value(uint32_t i) {
+    switch (test_type(i)) {
+    case LIGHT_COMMAND_COLOR:      return 0x010203 * (i % 80);
+    case LIGHT_COMMAND_SPEED:      return i % 256;
+    case LIGHT_COMMAND_BRIGHTNESS: return 1 + i % 255;
+    default:                       return i % TEST_EFFECTS;
+    }
+}
+
+/* The value of the last of the first `count` commands of a kind */
+static uint32_t test_latest(uint32_t count, light_command_type_t type) {
+    return test_value(count - 1 - (count - 1 - type) % LIGHT_COMMAND_RESTART);
+}
+
+/* The settings hold the value of the last command of every kind */
+static void test_check_latest(const light_settings_t *settings, uint32_t count) {
+    uint32_t color = test_latest(count, LIGHT_COMMAND_COLOR);
+    HOST_CHECK_EQ(settings->r, (color >> 16) & 0xff);
+    HOST_CHECK_EQ(settings->g, (color >> 8) & 0xff);
+    HOST_CHECK_EQ(settings->b, color & 0xff);
+    HOST_CHECK_EQ(settings->speed_delay, test_latest(count, LIGHT_COMMAND_SPEED));
+    HOST_CHECK_EQ(settings->brightness, test_latest(count, LIGHT_COMMAND_BRIGHTNESS));
+    HOST_CHECK_EQ(settings->effect, test_latest(count, LIGHT_COMMAND_EFFECT));
+}
+
+/* 500 commands without a drain: 16 fit in the queue, the others overflow and replace each
+* other. Every command is either applied or replaced by a later one of its kind. */
+HOST_TEST(light_commands_coalesce_a_burst) {
+    const uint32_t count = 500;
+    light_commands_t commands;
+    light_settings_t settings;
+    uint8_t taken;
+
+    HOST_CHECK_EQ(light_commands_init(&commands, TEST_QUEUE_LENGTH), ESP_OK);
+    HOST_CHECK_EQ(light_settings_init(&settings, 0, TEST_EFFECTS), ESP_OK);
+
+    for (uint32_t i = 0; i < count; i++) {
+        HOST_CHECK_EQ(light_commands_send(&commands, test_type(i), test_value(i)), ESP_OK);
+    }
+    HOST_CHECK_EQ(commands.sent, count);
+    HOST_CHECK_EQ(commands.overflowed, count - TEST_QUEUE_LENGTH);
+    HOST_CHECK_EQ(commands.overflow_mask, 0x0f);
+    HOST_CHECK_EQ(commands.coalesced, count - TEST_QUEUE_LENGTH - LIGHT_COMMAND_RESTART);
+
+    uint8_t changed = light_commands_drain(&commands, &settings, &taken);
+    HOST_CHECK_EQ(taken, 0x0f);
+    HOST_CHECK_EQ(changed, 0x0f);
+    HOST_CHECK_EQ(commands.coalesced + LIGHT_COMMAND_RESTART, count);
+    HOST_CHECK_EQ(commands.overflow_mask, 0);
+    HOST_CHECK_EQ(uxQueueMessagesWaiting(commands.queue), 0);
+    test_check_latest(&settings, count);
+
+    /* nothing is left behind for the next frame */
+    HOST_CHECK_EQ(light_commands_drain(&commands, &settings, &taken), 0);
+    HOST_CHECK_EQ(taken, 0);
+
+    vQueueDelete(commands.queue);
+}
+
+/* The same burst drained every 50 commands, like frames during a slider move */
+HOST_TEST(light_commands_drain_during_a_burst) {
+    const uint32_t count = 500;
+    light_commands_t commands;
+    light_settings_t settings;
+    uint32_t applied = 0;
+    uint8_t taken;
+
+    HOST_CHECK_EQ(light_commands_init(&commands, TEST_QUEUE_LENGTH), ESP_OK);
+    HOST_CHECK_EQ(light_settings_init(&settings, 0, TEST_EFFECTS), ESP_OK);
+
+    for (uint32_t i = 0; i < count; i++) {
+        HOST_CHECK_EQ(light_commands_send(&commands, test_type(i), test_value(i)), ESP_OK);
+        if ((i + 1) % 50 == 0) {
+            light_commands_drain(&commands, &settings, &taken);
+            HOST_CHECK_EQ(taken, 0x0f);
+            applied += LIGHT_COMMAND_RESTART;
+            test_check_latest(&settings, i + 1);
+        }
+    }
+    HOST_CHECK_EQ(commands.sent, count);
+    HOST_CHECK_EQ(commands.coalesced + applied, count);
+    HOST_CHECK_EQ(commands.overflowed, (count / 50) * (50 - TEST_QUEUE_LENGTH));
+
+    vQueueDelete(commands.queue);
+}
@@ -0,0 +1,237 @@
+/*
+ * light_store: the settings record in NVS, damaged, of other versions and from the keys before it.
+ */
+
+#include "host_test.h"
+
+#include <string.h>
+#include "light_store.h"
+#include "nvs.h"
+#include "rom/crc.h"
+#include "host_stubs.h"
+
+#define TEST_NAMESPACE "test"
+#define TEST_EFFECTS   7
+
+/* Bytes of the record before the ones covered by `crc` */
+#define TEST_HEADER_SIZE 8
+
+/* A record of `size` bytes with the given fields, the bytes past light_store_record_t are `extra` */
+static void test_make_record(uint8_t *data, uint8_t size, uint8_t version, uint8_t extra) {
+    light_store_record_t record;
+
+    memset(data, extra, size);
+    memset(&record, 0, sizeof(record));
+    record.version = version;
+    record.size = size;
+    record.r = 1;
+    record.g = 2;
+    record.b = 3;
+    record.speed_delay = 40;
+    record.brightness = 200;
+    record.effect = 5;
+    memcpy(data, &record, size < sizeof(record) ? size : sizeof(record));
+    record.crc = crc32_le(0, data + TEST_HEADER_SIZE, size - TEST_HEADER_SIZE);
+    memcpy(data + offsetof(light_store_record_t, crc), &record.crc, sizeof(record.crc));
+}
+
+static void test_set_blob(const void *data, size_t size) {
+    nvs_handle handle;
+    HOST_CHECK_EQ(nvs_open(TEST_NAMESPACE, NVS_READWRITE, &handle), ESP_OK);
+    HOST_CHECK_EQ(nvs_set_blob(handle, "settings", data, size), ESP_OK);
+    nvs_close(handle);
+}
+
+/* Loads the settings from their defaults, `saved` is what was loaded */
+static esp_err_t test_load(light_store_t *store, light_settings_t *settings) {
+    HOST_CHECK_EQ(light_settings_init(settings, 0, TEST_EFFECTS), ESP_OK);
+    HOST_CHECK_EQ(light_store_init(store, TEST_NAMESPACE), ESP_OK);
+    esp_err_t err = light_store_load(store, settings);
+    HOST_CHECK_EQ(store->saved.effect, settings->effect);
+    HOST_CHECK_EQ(store->saved.brightness, settings->brightness);
+    return err;
+}
+
+static void test_check_defaults(const light_settings_t *settings) {
+    HOST_CHECK_EQ(settings->r, (LIGHT_SETTINGS_DEFAULT_COLOR >> 16) & 0xff);
+    HOST_CHECK_EQ(settings->g, (LIGHT_SETTINGS_DEFAULT_COLOR >> 8) & 0xff);
+    HOST_CHECK_EQ(settings->b, LIGHT_SETTINGS_DEFAULT_COLOR & 0xff);
+    HOST_CHECK_EQ(settings->speed_delay, LIGHT_SETTINGS_DEFAULT_SPEED_DELAY);
+    HOST_CHECK_EQ(settings->brightness, LIGHT_SETTINGS_DEFAULT_BRIGHTNESS);
+    HOST_CHECK_EQ(settings->effect, 0);
+}
+
+/* The fields of test_make_record */
+static void test_check_record(const light_settings_t *settings) {
+    HOST_CHECK(settings->r == 1 && settings->g == 2 && settings->b == 3);
+    HOST_CHECK_EQ(settings->speed_delay, 40);
+    HOST_CHECK_EQ(settings->brightness, 200);
+    HOST_CHECK_EQ(settings->effect, 5);
+}
+
+/* Nothing saved yet: the defaults, no error and nothing written */
+HOST_TEST(light_store_loads_nothing) {
+    light_store_t store;
+    light_settings_t settings;
+
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    test_check_defaults(&settings);
+    HOST_CHECK_EQ(nvs_host_commits(), 0);
+}
+
+/* What light_store_flush writes, light_store_load reads */
+HOST_TEST(light_store_flushes_and_loads) {
+    light_store_t store;
+    light_settings_t settings;
+
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    light_settings_set_color(&settings, 1, 2, 3);
+    light_settings_set_speed_delay(&settings, 40);
+    light_settings_set_brightness(&settings, 200);
+    light_settings_set_effect(&settings, 5);
+    light_store_mark(&store, 0x0f);
+    HOST_CHECK_EQ(light_store_flush(&store, &settings), ESP_OK);
+    HOST_CHECK_EQ(nvs_host_commits(), 1);
+    HOST_CHECK_EQ(light_store_dirty(&store), 0);
+
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    test_check_record(&settings);
+}
+
+/* A record written by this firmware */
+HOST_TEST(light_store_loads_a_record) {
+    uint8_t data[sizeof(light_store_record_t)];
+    light_store_t store;
+    light_settings_t settings;
+
+    test_make_record(data, sizeof(data), LIGHT_STORE_RECORD_VERSION, 0);
+    test_set_blob(data, sizeof(data));
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    test_check_record(&settings);
+    HOST_CHECK_EQ(nvs_host_commits(), 0);
+}
+
+/* A changed byte, a changed CRC or a size which is not the one of the blob: the defaults */
+HOST_TEST(light_store_rejects_damaged_records) {
+    uint8_t data[sizeof(light_store_record_t)];
+    light_store_t store;
+    light_settings_t settings;
+
+    for (uint8_t damage = 0; damage < 5; damage++) {
+        size_t size = sizeof(data);
+        test_make_record(data, sizeof(data), LIGHT_STORE_RECORD_VERSION, 0);
+        switch (damage) {
+        case 0: data[offsetof(light_store_record_t, brightness)] ^= 0x01; break; // a field
+        case 1: data[offsetof(light_store_record_t, crc)] ^= 0x80; break;        // the CRC
+        case 2: data[offsetof(light_store_record_t, size)]++; break;             // too large
+        case 3: size--; break;                                                   // cut short
+        case 4: size = TEST_HEADER_SIZE; break;                                  // no field at all
+        }
+        test_set_blob(data, size);
+        HOST_CHECK_EQ(test_load(&store, &settings), ESP_ERR_INVALID_CRC);
+        test_check_defaults(&settings);
+    }
+    HOST_CHECK_EQ(nvs_host_commits(), 0);
+}
+
+/* A record of an older version, without brightness and effect: they keep their default */
+HOST_TEST(light_store_loads_a_shorter_record) {
+    uint8_t data[offsetof(light_store_record_t, brightness)];
+    light_store_t store;
+    light_settings_t settings;
+
+    test_make_record(data, sizeof(data), 0, 0);
+    test_set_blob(data, sizeof(data));
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    HOST_CHECK(settings.r == 1 && settings.g == 2 && settings.b == 3);
+    HOST_CHECK_EQ(settings.speed_delay, 40);
+    HOST_CHECK_EQ(settings.brightness, LIGHT_SETTINGS_DEFAULT_BRIGHTNESS);
+    HOST_CHECK_EQ(settings.effect, 0);
+}
+
+/* A record of a later version, with fields this firmware doesn't know: they are ignored */
+HOST_TEST(light_store_loads_a_longer_record) {
+    uint8_t data[sizeof(light_store_record_t) + 6];
+    light_store_t store;
+    light_settings_t settings;
+
+    test_make_record(data, sizeof(data), LIGHT_STORE_RECORD_VERSION + 1, 0xa5);
+    test_set_blob(data, sizeof(data));
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    test_check_record(&settings);
+
+    /* larger than any record this firmware reads */
+    uint8_t large[LIGHT_STORE_RECORD_MAX_SIZE + 1];
+    test_make_record(large, sizeof(large), LIGHT_STORE_RECORD_VERSION + 1, 0xa5);
+    test_set_blob(large, sizeof(large));
+    HOST_CHECK(test_load(&store, &settings) != ESP_OK);
+    test_check_defaults(&settings);
+}
+
+/* A field out of range in a valid record is dropped by its setter */
+HOST_TEST(light_store_drops_invalid_fields) {
+    uint8_t data[sizeof(light_store_record_t)];
+    light_store_t store;
+    light_settings_t settings;
+
+    test_make_record(data, sizeof(data), LIGHT_STORE_RECORD_VERSION, 0);
+    data[offsetof(light_store_record_t, effect)] = TEST_EFFECTS;
+    data[offsetof(light_store_record_t, brightness)] = 0;
+    uint32_t crc = crc32_le(0, data + TEST_HEADER_SIZE, sizeof(data) - TEST_HEADER_SIZE);
+    memcpy(data + offsetof(light_store_record_t, crc), &crc, sizeof(crc));
+    test_set_blob(data, sizeof(data));
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    HOST_CHECK_EQ(settings.speed_delay, 40);
+    HOST_CHECK_EQ(settings.brightness, LIGHT_SETTINGS_DEFAULT_BRIGHTNESS);
+    HOST_CHECK_EQ(settings.effect, 0);
+}
+
+/* The keys of the firmware before the record are read once and saved as a record, the keys stay */
+HOST_TEST(light_store_moves_the_keys_to_a_record) {
+    light_store_t store;
+    light_settings_t settings;
+    nvs_handle handle;
+
+    HOST_CHECK_EQ(nvs_open(TEST_NAMESPACE, NVS_READWRITE, &handle), ESP_OK);
+    HOST_CHECK_EQ(nvs_set_str(handle, "palette", "#010203"), ESP_OK);
+    HOST_CHECK_EQ(nvs_set_u8(handle, "speed", 40), ESP_OK);
+    HOST_CHECK_EQ(nvs_set_u8(handle, "brightness", 200), ESP_OK);
+    HOST_CHECK_EQ(nvs_set_u8(handle, "effect", 5), ESP_OK);
+    nvs_close(handle);
+
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    test_check_record(&settings);
+    HOST_CHECK_EQ(nvs_host_commits(), 1);
+
+    uint8_t data[LIGHT_STORE_RECORD_MAX_SIZE];
+    size_t size = sizeof(data);
+    uint8_t value;
+    HOST_CHECK_EQ(nvs_open(TEST_NAMESPACE, NVS_READWRITE, &handle), ESP_OK);
+    HOST_CHECK_EQ(nvs_get_blob(handle, "settings", data, &size), ESP_OK);
+    HOST_CHECK_EQ(nvs_get_u8(handle, "effect", &value), ESP_OK);
+    nvs_close(handle);
+    HOST_CHECK_EQ(size, sizeof(light_store_record_t));
+    HOST_CHECK_EQ(data[0], LIGHT_STORE_RECORD_VERSION);
+
+    /* then the record is read, nothing is written again */
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    test_check_record(&settings);
+    HOST_CHECK_EQ(nvs_host_commits(), 1);
+}
+
+/* Only some of the keys: the others keep their default */
+HOST_TEST(light_store_moves_some_keys) {
+    light_store_t store;
+    light_settings_t settings;
+    nvs_handle handle;
+
+    HOST_CHECK_EQ(nvs_open(TEST_NAMESPACE, NVS_READWRITE, &handle), ESP_OK);
+    HOST_CHECK_EQ(nvs_set_u8(handle, "brightness", 200), ESP_OK);
+    nvs_close(handle);
+
+    HOST_CHECK_EQ(test_load(&store, &settings), ESP_OK);
+    HOST_CHECK_EQ(settings.brightness, 200);
+    HOST_CHECK_EQ(settings.speed_delay, LIGHT_SETTINGS_DEFAULT_SPEED_DELAY);
+    HOST_CHECK_EQ(settings.effect, 0);
+    HOST_CHECK_EQ(nvs_host_commits(), 1);
+}
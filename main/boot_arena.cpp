@@ -0,0 +1,192 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "boot_arena.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *LOG_TAG  = "boot_arena";
+
+/* A region, blocks are taken one after the other from the start of `memory` */
+typedef struct {
+    uint8_t  *memory;   /* NULL if the region has no memory */
+    size_t   size;      /* Size of `memory` */
+    size_t   used;      /* Bytes given out */
+    uint32_t blocks;    /* Number of blocks given out */
+    uint32_t overflow;  /* Number of blocks the heap gave because the region was full */
+} boot_arena_t;
+
+static const char * const boot_arena_names[BOOT_ARENA_REGIONS] = { "internal", "dma" };
+static const uint32_t boot_arena_caps[BOOT_ARENA_REGIONS] = {
+    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    MALLOC_CAP_DMA | MALLOC_CAP_8BIT
+};
+
+static boot_arena_t boot_arenas[BOOT_ARENA_REGIONS];
+static bool         boot_arena_ready = false;
+static portMUX_TYPE boot_arena_lock;
+
+static size_t boot_arena_round(size_t size) {
+    return (size + BOOT_ARENA_ALIGN - 1) & ~(size_t)(BOOT_ARENA_ALIGN - 1);
+}
+
+esp_err_t boot_arena_init(size_t internal_size, size_t dma_size) {
+    if (boot_arena_ready) {
+        ESP_LOGE(LOG_TAG, "Arena is already initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const size_t sizes[BOOT_ARENA_REGIONS] = { internal_size, dma_size };
+    esp_err_t ret_val = ESP_OK;
+    for (uint8_t i = 0; i < BOOT_ARENA_REGIONS; i++) {
+        boot_arena_t *arena = &boot_arenas[i];
+        memset(arena, 0, sizeof(boot_arena_t));
+        if (sizes[i] == 0) { continue; }
+
+        size_t size = boot_arena_round(sizes[i]);
+        arena->memory = (uint8_t*)heap_caps_calloc(1, size, boot_arena_caps[i]);
+        if (arena->memory == NULL) {
+            ESP_LOGE(LOG_TAG, "Failed to allocate %u bytes for the %s region (largest free block %u bytes)",
+                     (unsigned)size, boot_arena_names[i], (unsigned)heap_caps_get_largest_free_block(boot_arena_caps[i]));
+            ret_val = ESP_ERR_NO_MEM;
+            continue;
+        }
+        arena->size = size;
+        ESP_LOGI(LOG_TAG, "Allocated %u bytes for the %s region", (unsigned)size, boot_arena_names[i]);
+    }
+
+    vPortCPUInitializeMutex(&boot_arena_lock);
+    boot_arena_ready = true;
+
+    return ret_val;
+}
+
+void *boot_arena_alloc(size_t size, boot_arena_region_t region) {
+    if (region >= BOOT_ARENA_REGIONS) {
+        ESP_LOGE(LOG_TAG, "Unknown region");
+        return NULL;
+    }
+    if (!boot_arena_ready) {
+        return heap_caps_calloc(1, size, boot_arena_caps[region]);
+    }
+
+    boot_arena_t *arena = &boot_arenas[region];
+    size_t rounded = boot_arena_round(size == 0 ? 1 : size); // every block starts inside the region
+    uint8_t *block = NULL;
+
+    portENTER_CRITICAL(&boot_arena_lock);
+    if (arena->memory != NULL && rounded <= arena->size - arena->used) {
+        block = arena->memory + arena->used;
+        arena->used += rounded;
+        arena->blocks++;
+    }
+    else {
+        arena->overflow++;
+    }
+    portEXIT_CRITICAL(&boot_arena_lock);
+
+    if (block == NULL) {
+        ESP_LOGW(LOG_TAG, "The %s region is full, %u bytes taken from the heap", boot_arena_names[region], (unsigned)size);
+        block = (uint8_t*)heap_caps_calloc(1, size, boot_arena_caps[region]);
+    }
+
+    return block;
+}
+
+void boot_arena_free(void *ptr) {
+    if (ptr == NULL) { return; }
+
+    uint8_t *block = (uint8_t*)ptr;
+    for (uint8_t i = 0; i < BOOT_ARENA_REGIONS; i++) {
+        const boot_arena_t *arena = &boot_arenas[i];
+        if (arena->memory != NULL && block >= arena->memory && block < arena->memory + arena->size) {
+            /* kept until the next reboot, freeing it again and again runs out of memory */
+            ESP_LOGW(LOG_TAG, "Block at offset %u of the %s region is kept until the next reboot",
+                     (unsigned)(block - arena->memory), boot_arena_names[i]);
+            return;
+        }
+    }
+    heap_caps_free(ptr);
+}
+
+/* Percentage of the free memory outside the largest free block */
+static unsigned boot_arena_fragmentation(size_t free_size, size_t largest) {
+    if (free_size == 0) { return 0; }
+    return 100 - (unsigned)((uint64_t)largest * 100 / free_size);
+}
+
+static void boot_arena_copy(boot_arena_t *copy) {
+    if (!boot_arena_ready) {
+        memset(copy, 0, BOOT_ARENA_REGIONS * sizeof(boot_arena_t));
+        return;
+    }
+    portENTER_CRITICAL(&boot_arena_lock);
+    memcpy(copy, boot_arenas, BOOT_ARENA_REGIONS * sizeof(boot_arena_t));
+    portEXIT_CRITICAL(&boot_arena_lock);
+}
+
+esp_err_t boot_arena_usage(boot_arena_region_t region, size_t *used, size_t *left) {
+    if (used == NULL || left == NULL || region >= BOOT_ARENA_REGIONS) { return ESP_ERR_INVALID_ARG; }
+
+    boot_arena_t arenas[BOOT_ARENA_REGIONS];
+    boot_arena_copy(arenas);
+    if (arenas[region].memory == NULL) { return ESP_ERR_INVALID_STATE; }
+
+    *used = arenas[region].used;
+    *left = arenas[region].size - arenas[region].used;
+    return ESP_OK;
+}
+
+void boot_arena_report(void) {
+    boot_arena_t arenas[BOOT_ARENA_REGIONS];
+    boot_arena_copy(arenas);
+
+    for (uint8_t i = 0; i < BOOT_ARENA_REGIONS; i++) {
+        if (arenas[i].size == 0 && arenas[i].overflow == 0) { continue; }
+        ESP_LOGI(LOG_TAG, "%s region: %u of %u bytes used by %u blocks, %u blocks from the heap",
+                 boot_arena_names[i], (unsigned)arenas[i].used, (unsigned)arenas[i].size,
+                 (unsigned)arenas[i].blocks, (unsigned)arenas[i].overflow);
+    }
+
+    size_t free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    ESP_LOGI(LOG_TAG, "Heap: %u bytes free, largest block %u bytes, lowest %u bytes, %u %% fragmented",
+             (unsigned)free_size, (unsigned)largest, (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             boot_arena_fragmentation(free_size, largest));
+}
+
+int boot_arena_json(char *buffer, size_t size) {
+    if (buffer == NULL) { return -1; }
+
+    boot_arena_t arenas[BOOT_ARENA_REGIONS];
+    boot_arena_copy(arenas);
+
+    size_t length = snprintf(buffer, size, "{\"arena\":[");
+    for (uint8_t i = 0; i < BOOT_ARENA_REGIONS && length < size; i++) {
+        length += snprintf(buffer + length, size - length,
+                           "%s{\"region\":\"%s\",\"size\":%u,\"used\":%u,\"blocks\":%u,\"overflow\":%u}",
+                           i == 0 ? "" : ",", boot_arena_names[i], (unsigned)arenas[i].size,
+                           (unsigned)arenas[i].used, (unsigned)arenas[i].blocks, (unsigned)arenas[i].overflow);
+    }
+    if (length < size) {
+        size_t free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        length += snprintf(buffer + length, size - length,
+                           "],\"heap\":{\"free\":%u,\"largest\":%u,\"min_free\":%u,\"fragmentation\":%u}}",
+                           (unsigned)free_size, (unsigned)largest,
+                           (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                           boot_arena_fragmentation(free_size, largest));
+    }
+
+    return length < size ? (int)length : -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
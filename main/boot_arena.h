@@ -0,0 +1,117 @@
+#ifndef MAIN_BOOT_ARENA_H_
+#define MAIN_BOOT_ARENA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Alignment of every block given by the arena, the same as the heap.
+ */
+#define BOOT_ARENA_ALIGN 4
+
+/**
+ * @brief Size of a buffer large enough for boot_arena_json.
+ */
+#define BOOT_ARENA_JSON_SIZE 320
+
+/**
+ * @brief The kinds of memory a block can be taken from
+ */
+typedef enum {
+    BOOT_ARENA_INTERNAL = 0, /*!< Internal RAM, can be read by interrupts while the flash cache is off */
+    BOOT_ARENA_DMA,          /*!< Internal RAM the DMA controllers can read */
+    BOOT_ARENA_REGIONS
+} boot_arena_region_t;
+
+/**
+ * @brief Take the memory of the arena from the heap.
+ *
+ * Takes the memory of every region at once, before the heap is cut in pieces. Every
+ * buffer kept until the next reboot (LED pixels and RMT items, network and statistics
+ * buffers) is then taken from the arena, so running for months doesn't fragment the heap.
+ *
+ * Before boot_arena_init, boot_arena_alloc takes its blocks from the heap.
+ *
+ * @param[in] internal_size Size of the BOOT_ARENA_INTERNAL region in bytes, may be 0.
+ * @param[in] dma_size      Size of the BOOT_ARENA_DMA region in bytes, may be 0.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_STATE if the arena is already initialized
+ *    - ESP_ERR_NO_MEM if a region could not be taken, the blocks of that region come from the heap
+ */
+esp_err_t boot_arena_init(size_t internal_size, size_t dma_size);
+
+/**
+ * @brief Take a block from the arena
+ *
+ * The block is set to 0 and aligned to BOOT_ARENA_ALIGN bytes. A region which is full
+ * (or has a size of 0) gives a block from the heap instead, with a warning: the arena
+ * should then be made larger.
+ *
+ * Thread safe.
+ *
+ * @param[in] size   Number of bytes.
+ * @param[in] region The kind of memory.
+ *
+ * @return The block, NULL if there is no memory left
+ */
+void *boot_arena_alloc(size_t size, boot_arena_region_t region);
+
+/**
+ * @brief Release a block of boot_arena_alloc
+ *
+ * Only blocks which came from the heap are freed. A block of the arena is not given
+ * back: its memory is lost until the next reboot and a warning is logged. A buffer of
+ * the arena should be created once at boot and kept, never destroyed and created again.
+ *
+ * @param[in] ptr The block, may be NULL.
+ */
+void boot_arena_free(void *ptr);
+
+/**
+ * @brief Get the use of a region of the arena
+ *
+ * @param[in]  region The kind of memory.
+ * @param[out] used   Bytes given out by the region.
+ * @param[out] left   Bytes the region can still give.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if a pointer is NULL or `region` is unknown
+ *    - ESP_ERR_INVALID_STATE if the region has no memory, its blocks come from the heap
+ */
+esp_err_t boot_arena_usage(boot_arena_region_t region, size_t *used, size_t *left);
+
+/**
+ * @brief Log the use of every region of the arena and the fragmentation of the heap.
+ */
+void boot_arena_report(void);
+
+/**
+ * @brief Write the use of the arena and the state of the heap as a JSON object
+ *
+ * @code
+ * {"arena":[{"region":"internal","size":49152,"used":40112,"blocks":21,"overflow":0},{...}],
+ *  "heap":{"free":98304,"largest":65536,"min_free":90112,"fragmentation":33}}
+ * @endcode
+ * Sizes are in bytes. `overflow` is the number of blocks the heap gave instead of the
+ * region. `fragmentation` is the percentage of the free heap outside its largest block.
+ *
+ * @param[out] buffer Where the text is written.
+ * @param[in]  size   Size of `buffer`, BOOT_ARENA_JSON_SIZE is enough.
+ *
+ * @return The length of the text, -1 if it does not fit in `buffer`
+ */
+int boot_arena_json(char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
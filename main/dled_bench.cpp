@@ -0,0 +1,211 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "dled_bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dled_pixel.h"
+#include "dled_strip.h"
+#include "esp32_rmt_dled.h"
+
+static const char *LOG_TAG  = "dled_bench";
+
+/* What the timed steps work on */
+typedef struct {
+    uint32_t          length;
+    pixel_t           *pixels;
+    pixel16_t         *pixels16;
+    pixel_strip_t     strip;
+    rmt_pixel_strip_t rps;
+} dled_bench_t;
+
+void dled_bench_skip(const char *name, const char *variant, uint32_t length) {
+    printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"length\":%u,\"skipped\":\"no memory\"}\n",
+           name, variant, (unsigned)length);
+}
+
+void dled_bench_time(const char *name, const char *variant, uint32_t length, dled_bench_step_t step, void *arg) {
+    uint32_t frames = 0;
+    int64_t elapsed;
+
+    step(arg, 0); // warm the caches and build the tables
+    int64_t start = esp_timer_get_time();
+    do {
+        step(arg, frames++);
+        elapsed = esp_timer_get_time() - start;
+    } while (elapsed < DLED_BENCH_CASE_US);
+
+    double ns_per_frame = elapsed * 1000.0 / frames;
+    printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"length\":%u,\"frames\":%u,\"ns_per_pixel\":%.2f,\"frames_per_s\":%.1f}\n",
+           name, variant, (unsigned)length, (unsigned)frames,
+           ns_per_frame / length, 1e9 / ns_per_frame);
+
+    vTaskDelay(1); // let the idle task feed the watchdog
+}
+
+static void dled_bench_case(const char *name, const char *variant, dled_bench_t *bench, dled_bench_step_t step) {
+    dled_bench_time(name, variant, bench->length, step, bench);
+}
+
+static void dled_bench_rainbow_step(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_pixel_rainbow_step(bench->pixels, bench->length, 255, frame);
+}
+
+static void dled_bench_hue_step(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_pixel_hue_step(bench->pixels, bench->length, frame * 64, 43, 255, 255);
+}
+
+static void dled_bench_hue_step16(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_pixel_hue_step16(bench->pixels16, bench->length, frame * 64, 43, 65535, 65535);
+}
+
+static void dled_bench_move_pixel(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_pixel_move_pixel(bench->pixels, bench->length, 255, frame);
+}
+
+static void dled_bench_fade(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_pixel_fade(bench->pixels, bench->length, 200);
+}
+
+static void dled_bench_fill_buffer(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_strip_fill_buffer(&bench->strip);
+}
+
+/* The transformations replaced the rotation of the pixels by the effects */
+static void dled_bench_fill_buffer_offset(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_strip_set_offset(&bench->strip, frame % bench->length);
+    dled_strip_fill_buffer(&bench->strip);
+}
+
+static void dled_bench_encode_pixels(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_strip_mark_all_dirty(&bench->strip);
+    rmt_dled_encode_pixels(&bench->rps);
+}
+
+static void dled_bench_encode_pixels_offset(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    dled_strip_set_offset(&bench->strip, frame % bench->length);
+    rmt_dled_encode_pixels(&bench->rps);
+}
+
+static void dled_bench_encode_buffer(void *arg, uint32_t frame) {
+    dled_bench_t *bench = (dled_bench_t*)arg;
+    rmt_dled_encode_buffer(&bench->rps);
+}
+
+/* The effects helpers, on plain pixels */
+static void dled_bench_pixels(dled_bench_t *bench) {
+    uint32_t length = bench->length;
+
+    bench->pixels = (pixel_t*)calloc(length, sizeof(pixel_t));
+    bench->pixels16 = (pixel16_t*)calloc(length, sizeof(pixel16_t));
+    if (bench->pixels == NULL || bench->pixels16 == NULL) {
+        dled_bench_skip("rainbow_step", "palette", length);
+        dled_bench_skip("hue_step", "hsv8", length);
+        dled_bench_skip("hue_step", "hsv16", length);
+        dled_bench_skip("move_pixel", "halve", length);
+        dled_bench_skip("fade", "swar", length);
+    }
+    else {
+        dled_bench_case("rainbow_step", "palette", bench, dled_bench_rainbow_step);
+        dled_bench_case("hue_step", "hsv8", bench, dled_bench_hue_step);
+        dled_bench_case("hue_step", "hsv16", bench, dled_bench_hue_step16);
+        dled_bench_case("move_pixel", "halve", bench, dled_bench_move_pixel);
+        dled_bench_case("fade", "swar", bench, dled_bench_fade);
+    }
+
+    free(bench->pixels);
+    free(bench->pixels16);
+    bench->pixels = NULL;
+    bench->pixels16 = NULL;
+}
+
+/* The output of a strip of LEDs of one format, the GRB one gets the extra cases */
+static void dled_bench_output(dled_bench_t *bench, dstrip_type_t type, const char *format) {
+    bool extra = (type == DLED_WS281x);
+    uint32_t length = bench->length;
+
+    dled_strip_init(&bench->strip);
+    rmt_dled_init(&bench->rps);
+
+    if (dled_strip_create(&bench->strip, type, length, 255) != ESP_OK ||
+        dled_strip_fill_buffer(&bench->strip) != ESP_OK) {
+        dled_bench_skip("fill_buffer", format, length);
+        dled_bench_skip("rmt_encode_pixels", format, length);
+        dled_strip_destroy(&bench->strip);
+        return;
+    }
+    dled_pixel_hue_step(bench->strip.pixels, length, 0, 43, 255, 255);
+
+    dled_bench_case("fill_buffer", format, bench, dled_bench_fill_buffer);
+    if (extra) {
+        dled_bench_case("fill_buffer", "grb_offset", bench, dled_bench_fill_buffer_offset);
+        dled_strip_set_offset(&bench->strip, 0);
+    }
+
+    if (rmt_dled_create(&bench->rps, &bench->strip) != ESP_OK) {
+        dled_bench_skip("rmt_encode_pixels", format, length);
+        if (extra) {
+            dled_bench_skip("rmt_encode_pixels", "grb_offset", length);
+            dled_bench_skip("rmt_encode_buffer", format, length);
+            dled_bench_skip("rmt_encode_pixels", "grb_hd", length);
+        }
+        dled_strip_destroy(&bench->strip);
+        return;
+    }
+    dled_bench_case("rmt_encode_pixels", format, bench, dled_bench_encode_pixels);
+    if (extra) {
+        dled_bench_case("rmt_encode_pixels", "grb_offset", bench, dled_bench_encode_pixels_offset);
+        dled_strip_set_offset(&bench->strip, 0);
+        dled_strip_fill_buffer(&bench->strip);
+        dled_bench_case("rmt_encode_buffer", format, bench, dled_bench_encode_buffer);
+
+        if (dled_strip_create_hd(&bench->strip) == ESP_OK) {
+            dled_pixel_hue_step16(bench->strip.pixels16, length, 0, 43, 65535, 65535);
+            dled_strip_set_hd(&bench->strip, true);
+            dled_bench_case("rmt_encode_pixels", "grb_hd", bench, dled_bench_encode_pixels);
+        }
+        else {
+            dled_bench_skip("rmt_encode_pixels", "grb_hd", length);
+        }
+    }
+
+    rmt_dled_destroy(&bench->rps);
+    dled_strip_destroy(&bench->strip);
+}
+
+void dled_bench_run(void) {
+    const uint32_t lengths[] = DLED_BENCH_LENGTHS;
+    dled_bench_t bench;
+
+    ESP_LOGI(LOG_TAG, "Render benchmark, %d ms per case", DLED_BENCH_CASE_US / 1000);
+
+    for (uint8_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        bench.length = lengths[i];
+        dled_bench_pixels(&bench);
+        dled_bench_output(&bench, DLED_WS281x, "grb");
+        dled_bench_output(&bench, DLED_WS2811, "rgb");
+        dled_bench_output(&bench, DLED_SK6812_RGBW, "grbw");
+    }
+
+    ESP_LOGI(LOG_TAG, "Render benchmark done");
+}
+
+#ifdef __cplusplus
+}
+#endif
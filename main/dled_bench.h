@@ -0,0 +1,69 @@
+#ifndef MAIN_DLED_BENCH_H_
+#define MAIN_DLED_BENCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Strip lengths every case of the benchmark is timed at.
+ */
+#define DLED_BENCH_LENGTHS { 112, 300, 1000, 3000, 10000, 20000 }
+
+/**
+ * @brief Time spent on every case at every length, in microseconds.
+ */
+#define DLED_BENCH_CASE_US 100000
+
+/**
+ * @brief Time the steps of the render pipeline and print the results
+ *
+ * Times the effects helpers of dled_pixel, dled_strip_fill_buffer and the RMT encoders
+ * (for every LED format, with and without transformations), at all DLED_BENCH_LENGTHS.
+ * Nothing is sent, the RMT peripheral is not used.
+ *
+ * Prints one JSON object per line on stdout, so the results can be picked from the log:
+ * @code
+ * {"bench":"fill_buffer","variant":"grb","length":112,"frames":41230,"ns_per_pixel":21.65,"frames_per_s":412300.0}
+ * {"bench":"rmt_encode_pixels","variant":"grbw","length":10000,"skipped":"no memory"}
+ * @endcode
+ * `frames_per_s` is the ceiling set by that step alone. Lengths needing more memory than
+ * is free are skipped.
+ *
+ * Takes a few seconds, call it before the LEDs are set up so their memory is free.
+ * host/ builds it for Linux (`make -C host bench`), with the cases which compare the
+ * steps with the code they replaced. CONFIG_LED_BENCHMARK runs it at boot on the board.
+ */
+void dled_bench_run(void);
+
+/**
+ * @brief A step of the render pipeline timed by dled_bench_time.
+ *
+ * @param[in,out] arg   What the step works on.
+ * @param[in]     frame Number of the frame, counting from 0.
+ */
+typedef void (*dled_bench_step_t)(void *arg, uint32_t frame);
+
+/**
+ * @brief Run a step for DLED_BENCH_CASE_US and print its result as a line of dled_bench_run
+ *
+ * @param[in] name    What is timed, the "bench" of the result.
+ * @param[in] variant How it is done, the "variant" of the result.
+ * @param[in] length  Number of pixels the step works on.
+ * @param[in] step    The step.
+ * @param[in] arg     Passed to `step`.
+ */
+void dled_bench_time(const char *name, const char *variant, uint32_t length, dled_bench_step_t step, void *arg);
+
+/**
+ * @brief Print the line of a case which could not run for lack of memory.
+ */
+void dled_bench_skip(const char *name, const char *variant, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef MAIN_DLED_FORMAT_H_
+#define MAIN_DLED_FORMAT_H_
+
+/*
+ * Color order and number of bytes of the LED types, for the encoders.
+ *
+ * C++ only: every encoder loop is a template instantiated for every format so the
+ * order of the bytes is known at compile time and nothing is decided per pixel.
+ * The format is chosen once per call with dled_format_select.
+ */
+
+#include <stdint.h>
+
+#include "dled_strip.h"
+
+#ifdef __cplusplus
+extern "C++" {
+
+/**
+ * @brief LEDs with 3 color components, sent in the given positions.
+ *
+ * @tparam R, G, B Position on the wire of the red, green and blue components.
+ */
+template <uint8_t R, uint8_t G, uint8_t B>
+struct dled_format_3 {
+    static const uint8_t bytes_per_led = 3;
+
+    static void order(uint8_t *order) {
+        order[R] = 0; order[G] = 1; order[B] = 2;
+    }
+
+    template <typename T>
+    static inline __attribute__((always_inline)) void wire(T r, T g, T b, T *out) {
+        out[R] = r; out[G] = g; out[B] = b;
+    }
+};
+
+/**
+ * @brief LEDs with a white LED next to the red, green and blue ones.
+ *
+ * The white LED takes the part common to the three colors.
+ *
+ * @tparam R, G, B, W Position on the wire of the red, green, blue and white components.
+ */
+template <uint8_t R, uint8_t G, uint8_t B, uint8_t W>
+struct dled_format_4 {
+    static const uint8_t bytes_per_led = 4;
+
+    static void order(uint8_t *order) {
+        order[R] = 0; order[G] = 1; order[B] = 2; order[W] = 3;
+    }
+
+    template <typename T>
+    static inline __attribute__((always_inline)) void wire(T r, T g, T b, T *out) {
+        T w = r < g ? r : g;
+        if (b < w) { w = b; }
+        out[R] = r - w; out[G] = g - w; out[B] = b - w; out[W] = w;
+    }
+};
+
+typedef dled_format_3<1, 0, 2>    dled_format_grb;   /*!< WS2812, WS2812B, WS2813, WS2815, SK6812 */
+typedef dled_format_3<0, 1, 2>    dled_format_rgb;   /*!< WS2811 */
+typedef dled_format_4<1, 0, 2, 3> dled_format_grbw;  /*!< SK6812 RGBW */
+
+/**
+ * @brief Pick the format of a LED type.
+ *
+ * @tparam Select A structure with a `type` typedef and a `with<Format>()` static
+ *                template function returning it, usually the encoder for `Format`.
+ *
+ * @param[in] strip_type The type of LEDs.
+ *
+ * @return `Select::with<Format>()` for the format of `strip_type`.
+ */
+template <class Select>
+typename Select::type dled_format_select(dstrip_type_t strip_type) {
+    switch (strip_type) {
+        case DLED_WS2811:
+            return Select::template with<dled_format_rgb>();
+        case DLED_SK6812_RGBW:
+            return Select::template with<dled_format_grbw>();
+        default:
+            return Select::template with<dled_format_grb>();
+    }
+}
+
+/**
+ * @brief Get the bytes sent for the pixel shown at a position of the strip.
+ *
+ * Applies the transformations, the color order and the output levels.
+ *
+ * @param[in]  strip  The strip.
+ * @param[in]  index  The position on the strip.
+ * @param[in]  mapped The result of dled_strip_is_mapped.
+ * @param[out] out    `Format::bytes_per_led` bytes, in the order they are sent.
+ */
+template <class Format>
+static inline __attribute__((always_inline)) void dled_format_encode(const pixel_strip_t *strip, uint32_t index, bool mapped, uint8_t *out) {
+    const pixel_t *pixel = (const pixel_t*)dled_strip_pixel_at(strip, strip->pixels, sizeof(pixel_t), index, mapped);
+    uint8_t wire[Format::bytes_per_led];
+
+    Format::wire(pixel->r, pixel->g, pixel->b, wire);
+    for (uint8_t i = 0; i < Format::bytes_per_led; i++) {
+        out[i] = strip->levels[wire[i]];
+    }
+}
+
+/**
+ * @brief Get the bytes sent for the high precision pixel shown at a position of the strip.
+ *
+ * Like dled_format_encode, the values are dithered to 8 bits. Call once per frame
+ * for every position, the dithering errors are kept for the next frame.
+ */
+template <class Format>
+static inline __attribute__((always_inline)) void dled_format_encode16(const pixel_strip_t *strip, uint32_t index, bool mapped, uint8_t *out) {
+    const pixel16_t *pixel = (const pixel16_t*)dled_strip_pixel_at(strip, strip->pixels16, sizeof(pixel16_t), index, mapped);
+    uint8_t *residual = strip->residuals + index * Format::bytes_per_led;
+    uint16_t wire[Format::bytes_per_led];
+
+    Format::wire(pixel->r, pixel->g, pixel->b, wire);
+    for (uint8_t i = 0; i < Format::bytes_per_led; i++) {
+        out[i] = dled_strip_dither(strip->levels16, residual + i, wire[i]);
+    }
+}
+
+/**
+ * @brief Get the color component sent in every byte of a LED, for code that can not be specialized.
+ *
+ * `dled_format_select<dled_format_order>(strip_type)(order)` sets `order[i]` to the
+ * component sent in byte `i`: 0 red, 1 green, 2 blue, 3 white.
+ */
+struct dled_format_order {
+    typedef void (*type)(uint8_t *order);
+
+    template <class Format>
+    static type with() { return &Format::order; }
+};
+
+}
+#endif
+
+#endif
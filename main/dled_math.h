@@ -0,0 +1,42 @@
+#ifndef MAIN_DLED_MATH_H_
+#define MAIN_DLED_MATH_H_
+
+/*
+ * Fixed point helpers for the effects.
+ *
+ * Everything is inlined and made of multiplies and shifts, there is no
+ * divide: the ESP32 does not have a fast one and these are used for every pixel.
+ * A fraction is a `uint8_t` where 255 is 1, or a `uint16_t` where 65535 is 1.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Scale a 8 bits value by a 8 bits fraction.
+ *
+ * A scale of 255 keeps the value, 0 gives 0 and 128 halves it.
+ */
+static inline __attribute__((always_inline)) uint8_t dled_scale8(uint8_t value, uint8_t scale)
+{
+    return ((uint16_t)value * ((uint16_t)scale + 1)) >> 8;
+}
+
+/**
+ * @brief Scale a 16 bits value by a 16 bits fraction.
+ *
+ * A scale of 65535 keeps the value, 0 gives 0 and 32768 halves it.
+ */
+static inline __attribute__((always_inline)) uint16_t dled_scale16(uint16_t value, uint16_t scale)
+{
+    return ((uint32_t)value * ((uint32_t)scale + 1)) >> 16;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "dled_output.h"
+
+#include <stddef.h>
+#include "esp_log.h"
+
+static const char *LOG_TAG  = "dled_output";
+
+esp_err_t dled_output_check(dled_output_t *output) {
+    if (output == NULL) {
+        ESP_LOGE(LOG_TAG, "Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (output->send_async == NULL || output->wait == NULL) {
+        ESP_LOGE(LOG_TAG, "Output has no backend");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t dled_output_send_async(dled_output_t *output) {
+    esp_err_t ret_val = dled_output_check(output);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    return output->send_async(output->backend);
+}
+
+esp_err_t dled_output_wait(dled_output_t *output, TickType_t wait_time) {
+    esp_err_t ret_val = dled_output_check(output);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    return output->wait(output->backend, wait_time);
+}
+
+esp_err_t dled_output_send(dled_output_t *output) {
+    esp_err_t ret_val = dled_output_send_async(output);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    return dled_output_wait(output, portMAX_DELAY);
+}
+
+esp_err_t dled_output_timing(dled_output_t *output, dled_output_timing_t *timing) {
+    esp_err_t ret_val = dled_output_check(output);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    if (timing == NULL) {
+        ESP_LOGE(LOG_TAG, "Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (output->timing == NULL) { return ESP_ERR_NOT_SUPPORTED; }
+
+    return output->timing(output->backend, timing);
+}
+
+#ifdef __cplusplus
+}
+#endif
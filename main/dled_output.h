@@ -0,0 +1,93 @@
+#ifndef MAIN_DLED_OUTPUT_H_
+#define MAIN_DLED_OUTPUT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Where the time of the last frames went, in microseconds
+ */
+typedef struct {
+	uint32_t fill_us;     /*!< Preparing the LED data of the last frame */
+	uint32_t encode_us;   /*!< Encoding the last frame to what the backend sends */
+	uint32_t transmit_us; /*!< Last completed transmission, 0 if none ended since the last dled_output_timing */
+} dled_output_timing_t;
+
+/**
+ * @brief Where the frames of a strip go
+ *
+ * The render code sends frames through this structure and does not know what is behind it:
+ * the RMT peripheral (rmt_dled_manager_output) or a recording (dled_virtual_output).
+ */
+typedef struct {
+	const char *name;  /*!< Name of the backend, for the logs */
+	void       *backend; /*!< The structure of the backend, passed to the functions below */
+
+	esp_err_t (*send_async)(void *backend); /*!< Sends the changes of the strip, may return before they are out */
+	esp_err_t (*wait)(void *backend, TickType_t wait_time); /*!< Waits until the last frame is out */
+	esp_err_t (*timing)(void *backend, dled_output_timing_t *timing); /*!< Gets the timing of the last frames, may be NULL */
+} dled_output_t;
+
+/**
+ * @brief Send the changes of the strip without waiting for the end
+ *
+ * @param[in,out] output The output.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `output` argument is NULL or it is not set up
+ *    - the error codes of the backend, if error
+ */
+esp_err_t dled_output_send_async(dled_output_t *output);
+
+/**
+ * @brief Wait until the last frame is out
+ *
+ * @param[in,out] output    The output.
+ * @param[in]     wait_time Maximum time to wait, in ticks.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `output` argument is NULL or it is not set up
+ *    - the error codes of the backend, if error
+ */
+esp_err_t dled_output_wait(dled_output_t *output, TickType_t wait_time);
+
+/**
+ * @brief Send the changes of the strip and wait until they are out
+ *
+ * @param[in,out] output The output.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - the error codes of dled_output_send_async and dled_output_wait, if error
+ */
+esp_err_t dled_output_send(dled_output_t *output);
+
+/**
+ * @brief Get where the time of the last frames went
+ *
+ * The fill and encode times are those of the last frame sent. The transmission of a frame
+ * usually ends while the next one is rendered, so `transmit_us` is that of the last frame
+ * seen out since the previous call, 0 if none.
+ *
+ * @param[in,out] output The output.
+ * @param[out]    timing The times.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL or the output is not set up
+ *    - ESP_ERR_NOT_SUPPORTED if the backend does not measure its times
+ */
+esp_err_t dled_output_timing(dled_output_t *output, dled_output_timing_t *timing);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,6 +3,9 @@ extern "C" {
 #endif
 
 #include "dled_pixel.h"
+#include "boot_arena.h"
+
+#include <stdlib.h>
 
 void dled_pixel_set(pixel_t* pixel, uint8_t r, uint8_t g, uint8_t b)
 {
@@ -53,20 +56,141 @@ pixel_t dled_pixel_get_color_by_index(uint8_t max_cc_val, uint16_t index)
     return pixel;
 }
 
-void dled_pixel_rainbow_step(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step)
+/* The palette of dled_pixel_get_color_by_index for the last `max_cc_val` asked for,
+* built again only when it changes. The memory is taken once, for the biggest palette. */
+#define RAINBOW_PALETTE_CAPACITY (6 * 255)
+static pixel_t  *rainbow_palette = NULL;
+static uint16_t rainbow_palette_size = 0;
+static uint8_t  rainbow_palette_max_cc_val = 0;
+
+/* Returns the number of colors of the palette, 0 if there is none */
+static uint16_t dled_pixel_rainbow_palette(uint8_t max_cc_val)
+{
+    uint16_t size = 6 * max_cc_val;
+
+    if (size == 0) return 0;
+    if (rainbow_palette_size != 0 && rainbow_palette_max_cc_val == max_cc_val) return size;
+
+    if (rainbow_palette == NULL) {
+        rainbow_palette = (pixel_t*)boot_arena_alloc(RAINBOW_PALETTE_CAPACITY * sizeof(pixel_t), BOOT_ARENA_INTERNAL);
+        if (rainbow_palette == NULL) return 0;
+    }
+    for (uint16_t i = 0; i < size; i++) {
+        rainbow_palette[i] = dled_pixel_get_color_by_index(max_cc_val, i);
+    }
+    rainbow_palette_size = size;
+    rainbow_palette_max_cc_val = max_cc_val;
+
+    return size;
+}
+
+pixel_t dled_pixel_rainbow_color(uint8_t max_cc_val, uint16_t index)
+{
+    uint16_t size = dled_pixel_rainbow_palette(max_cc_val);
+
+    if (size == 0) return dled_pixel_get_color_by_index(max_cc_val, index);
+
+    return rainbow_palette[index % size];
+}
+
+void dled_pixel_rainbow_step(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint16_t step)
 {
     if (pixels == NULL) return;
     if (length == 0)    return;
 
-    for (uint16_t idx = 0; idx < length; idx++) {
-        pixels[idx] = dled_pixel_get_color_by_index(max_cc_val, idx + step);
+    uint16_t size = dled_pixel_rainbow_palette(max_cc_val);
+    if (size == 0) {
+        for (uint32_t idx = 0; idx < length; idx++) {
+            pixels[idx] = dled_pixel_get_color_by_index(max_cc_val, idx + step);
+        }
+        return;
+    }
+
+    /* Walk the palette. `index` wraps like the uint16_t index of dled_pixel_get_color_by_index,
+    * where the palette starts again even if it was not finished. */
+    uint16_t index = step;
+    uint16_t pos = index % size;
+    for (uint32_t idx = 0; idx < length; idx++) {
+        pixels[idx] = rainbow_palette[pos];
+        if (++index == 0) {
+            pos = 0;
+        }
+        else if (++pos == size) {
+            pos = 0;
+        }
+    }
+}
+
+pixel_t dled_pixel_hsv(uint16_t hue, uint8_t sat, uint8_t val)
+{
+    pixel16_t pixel16 = dled_pixel_hsv16(hue, sat * 257, val * 257);
+    pixel_t pixel;
+
+    pixel.r = pixel16.r >> 8;
+    pixel.g = pixel16.g >> 8;
+    pixel.b = pixel16.b >> 8;
+
+    return pixel;
+}
+
+void dled_pixel_hue_step(pixel_t *pixels, uint32_t length, uint16_t hue, uint16_t hue_step, uint8_t sat, uint8_t val)
+{
+    if (pixels == NULL) return;
+
+    for (uint32_t i = 0; i < length; i++, hue += hue_step) {
+        pixels[i] = dled_pixel_hsv(hue, sat, val);
+    }
+}
+
+void dled_pixel_hue_step16(pixel16_t *pixels16, uint32_t length, uint16_t hue, uint16_t hue_step, uint16_t sat, uint16_t val)
+{
+    if (pixels16 == NULL) return;
+
+    for (uint32_t i = 0; i < length; i++, hue += hue_step) {
+        pixels16[i] = dled_pixel_hsv16(hue, sat, val);
+    }
+}
+
+/* Scales the four bytes of `word`. The even and the odd bytes are each spread over two
+* 16 bits lanes which can take `byte * (scale + 1)` without spilling into the next one. */
+static inline __attribute__((always_inline)) uint32_t dled_pixel_scale_word(uint32_t word, uint16_t factor)
+{
+    uint32_t even = (((word & 0x00FF00FF) * factor) >> 8) & 0x00FF00FF;
+    uint32_t odd  = (((word >> 8) & 0x00FF00FF) * factor) & 0xFF00FF00;
+    return even | odd;
+}
+
+void dled_pixel_fade(pixel_t *pixels, uint32_t length, uint8_t scale)
+{
+    if (pixels == NULL) return;
+    if (scale == 255)   return;
+
+    /* pixel_t has no padding, the components are faded as a run of bytes */
+    uint8_t *data = (uint8_t*)pixels;
+    uint32_t size = (uint32_t)length * sizeof(pixel_t);
+    uint16_t factor = (uint16_t)scale + 1;
+
+    /* the ESP32 can not read unaligned words */
+    while (size > 0 && ((uintptr_t)data & 3) != 0) {
+        *data = dled_scale8(*data, scale);
+        data++;
+        size--;
+    }
+    typedef uint32_t __attribute__((may_alias)) word_t;
+    word_t *words = (word_t*)data;
+    for (uint32_t i = 0; i < size / 4; i++) {
+        words[i] = dled_pixel_scale_word(words[i], factor);
+    }
+    data += size & ~3u;
+    for (uint32_t i = 0; i < (size & 3); i++) {
+        data[i] = dled_scale8(data[i], scale);
     }
 }
 
-void dled_pixel_move_pixel(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step) {
+void dled_pixel_move_pixel(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint32_t step) {
     pixel_t pixel;
     uint8_t seq;
-    uint16_t idx;
+    uint32_t idx;
     uint8_t maxVal;
 
     if (pixels == NULL) return;
@@ -86,47 +210,32 @@ void dled_pixel_move_pixel(pixel_t *pixels, uint16_t length, uint8_t max_cc_val,
     case 5: dled_pixel_set(&pixel, maxVal / 2, 0, maxVal / 2); idx = length - idx - 1; break;
     }
 
-    for (uint16_t i = 0; i < length; i++) {
-        if (i == idx) {
-            pixels[i] = pixel;
-        }
-        else {
-            pixels[i].r /= 2;
-            pixels[i].g /= 2;
-            pixels[i].b /= 2;
-        }
-    }
+    dled_pixel_fade(pixels, length, 127);
+    pixels[idx] = pixel;
 }
 
-void dled_pixel_chase_pixels(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step, uint16_t num) {
+void dled_pixel_chase_pixels(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint32_t step, uint32_t num) {
     pixel_t pixel = pixels[step];
-    uint16_t idx;
+    uint32_t idx;
 
     if (pixels == NULL) return;
     if (length == 0)    return;
 
     idx = step % length;
 
-    for (uint16_t i = 0; i < length; i++) {
-        if (i == idx) {
-            if (step < num) {
-                pixels[i] = pixel;
-            } else {
-                for (uint16_t n = 0; n < num; n++) {
-                    pixels[i-n] = pixel;
-                }
-            }
-        } else { // Gradually make the LED dimmer and dimmer with each step (falling behind)
-            if (step >= num) {
-                pixels[i].r /= 2;
-                pixels[i].g /= 2;
-                pixels[i].b /= 2;
-            }
-        }
+    if (step < num) {
+        pixels[idx] = pixel;
+        return;
+    }
+
+    // Gradually make the LEDs dimmer and dimmer with each step (falling behind)
+    dled_pixel_fade(pixels, length, 127);
+    for (uint32_t n = 0; n < num; n++) {
+        pixels[idx-n] = pixel;
     }
 }
 
-// void dled_pixel_chase_pixel_test(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step, uint16_t num) {
+// void dled_pixel_chase_pixel_test(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint16_t step, uint16_t num) {
 //     pixel_t pixel = pixels[step];
 //
 //     if (pixels == NULL) return;
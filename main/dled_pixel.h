@@ -8,6 +8,8 @@ extern "C" {
 #include <stddef.h>
 #include <stdint.h>
 
+#include "dled_math.h"
+
 /**
  * @brief Structure to be used as a pixel.
  *
@@ -18,6 +20,63 @@ typedef struct {
     uint8_t b; /*!< Blue color component */
 } pixel_t;
 
+/**
+ * @brief Structure to be used as a high precision pixel.
+ *
+ * 65535 is the full value of a color component, the same as 255 for pixel_t.
+ */
+typedef struct {
+    uint16_t r; /*!< Red color component */
+    uint16_t g; /*!< Green color component */
+    uint16_t b; /*!< Blue color component */
+} pixel16_t;
+
+/**
+ * @brief Hue of dled_pixel_hsv16 for the start of every color sector.
+ *
+ * The hue goes round the color wheel once over the whole uint16_t range, it wraps
+ * from red back to red.
+ */
+#define DLED_HUE_RED     0
+#define DLED_HUE_YELLOW  10923
+#define DLED_HUE_GREEN   21845
+#define DLED_HUE_CYAN    32768
+#define DLED_HUE_BLUE    43691
+#define DLED_HUE_MAGENTA 54613
+
+/**
+ * @brief Get a high precision pixel from HSV, integer only.
+ *
+ * Inlined so it can be used for every pixel of a frame.
+ *
+ * @param[in] hue The color, see DLED_HUE_RED.
+ * @param[in] sat The saturation, 0 for white to 65535 for full color.
+ * @param[in] val The value, 0 for off to 65535 for full brightness.
+ * @return The pixel.
+ */
+static inline __attribute__((always_inline)) pixel16_t dled_pixel_hsv16(uint16_t hue, uint16_t sat, uint16_t val)
+{
+    /* 6 sectors, `frac` is the position in the sector in 1/65536 */
+    uint32_t hue6 = (uint32_t)hue * 6;
+    uint8_t sector = hue6 >> 16;
+    uint16_t frac = hue6 & 0xFFFF;
+    uint16_t p = val - dled_scale16(val, sat);
+    uint16_t q = val - dled_scale16(val, dled_scale16(sat, frac));
+    uint16_t t = val - dled_scale16(val, dled_scale16(sat, 65535 - frac));
+    pixel16_t pixel;
+
+    switch (sector) {
+    case 0:  pixel.r = val; pixel.g = t;   pixel.b = p;   break;
+    case 1:  pixel.r = q;   pixel.g = val; pixel.b = p;   break;
+    case 2:  pixel.r = p;   pixel.g = val; pixel.b = t;   break;
+    case 3:  pixel.r = p;   pixel.g = q;   pixel.b = val; break;
+    case 4:  pixel.r = t;   pixel.g = p;   pixel.b = val; break;
+    default: pixel.r = val; pixel.g = p;   pixel.b = q;   break;
+    }
+
+    return pixel;
+}
+
 /**
  * @brief Set the pixel_t from RGB.
  * @param[in,out] pixel   Pointer to the pixel_t object to be changed.
@@ -31,6 +90,40 @@ void dled_pixel_set(pixel_t* pixel, uint8_t r, uint8_t g, uint8_t b);
  */
 void dled_pixel_off(pixel_t* pixel);
 
+/**
+ * @brief Get a pixel from HSV.
+ *
+ * The 8 bits version of dled_pixel_hsv16, the hue keeps its 16 bits so slow hue
+ * changes are not limited to the 1530 colors of 8 bits.
+ *
+ * @param[in] hue The color, see DLED_HUE_RED.
+ * @param[in] sat The saturation, 0 for white to 255 for full color.
+ * @param[in] val The value, 0 for off to 255 for full brightness.
+ * @return The pixel.
+ */
+pixel_t dled_pixel_hsv(uint16_t hue, uint8_t sat, uint8_t val);
+
+/**
+ * @brief Set a sequence of hues
+ *
+ * Pixel `i` gets the hue `hue + i * hue_step`, wrapping round the color wheel.
+ *
+ * @param[in,out] pixels   The pixels to be set.
+ * @param[in]     length   Number of pixels.
+ * @param[in]     hue      Hue of the first pixel.
+ * @param[in]     hue_step Hue difference between two pixels.
+ * @param[in]     sat      The saturation of every pixel.
+ * @param[in]     val      The value of every pixel.
+ */
+void dled_pixel_hue_step(pixel_t *pixels, uint32_t length, uint16_t hue, uint16_t hue_step, uint8_t sat, uint8_t val);
+
+/**
+ * @brief Set a sequence of hues on high precision pixels
+ *
+ * Like dled_pixel_hue_step, with 16 bits saturation and value.
+ */
+void dled_pixel_hue_step16(pixel16_t *pixels16, uint32_t length, uint16_t hue, uint16_t hue_step, uint16_t sat, uint16_t val);
+
 /**
  * @brief Get a color from a simple rainbow palette.
  *
@@ -46,10 +139,25 @@ void dled_pixel_off(pixel_t* pixel);
  */
 pixel_t dled_pixel_get_color_by_index(uint8_t max_cc_val, uint16_t index);
 
+/**
+ * @brief Get a color from the simple rainbow palette, using a cached palette.
+ *
+ * Same result as dled_pixel_get_color_by_index. The palette is built the first time and
+ * again only when `max_cc_val` changes, then every color is a table read.
+ * Not thread safe, the palette is shared with dled_pixel_rainbow_step.
+ *
+ * @param[in] max_cc_val The maximum value allowed for a color component.
+ * @param[in] index      Index of the requested color from palette.
+ * @return The pixel.
+ */
+pixel_t dled_pixel_rainbow_color(uint8_t max_cc_val, uint16_t index);
+
 /**
  * @brief Set a rainbow style sequence
  *
- * Creates a rainbow slice. Internally this function calls dled_pixel_get_color_by_index.
+ * Creates a rainbow slice, the colors of dled_pixel_get_color_by_index for the indexes
+ * `step` to `step + length - 1`. The colors are read from the cached palette of
+ * dled_pixel_rainbow_color. If it can not be allocated they are computed one by one.
  *
  * @param[in,out] pixels     The pixels to be set.
  * @param[in]     length     Number of pixels.
@@ -68,7 +176,19 @@ pixel_t dled_pixel_get_color_by_index(uint8_t max_cc_val, uint16_t index);
  * }
  * @endcode
  */
-void dled_pixel_rainbow_step(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step);
+void dled_pixel_rainbow_step(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint16_t step);
+
+/**
+ * @brief Fade pixels towards black
+ *
+ * Scales every color component like dled_scale8, with the same results. Four color
+ * components are scaled by every 32 bits operation, so long trails stay cheap.
+ *
+ * @param[in,out] pixels The pixels to be faded.
+ * @param[in]     length Number of pixels.
+ * @param[in]     scale  What is kept of every component, 255 keeps all and 128 halves them.
+ */
+void dled_pixel_fade(pixel_t *pixels, uint32_t length, uint8_t scale);
 
 /**
  * @brief Moves a pixel back and forth
@@ -92,7 +212,7 @@ void dled_pixel_rainbow_step(pixel_t *pixels, uint16_t length, uint8_t max_cc_va
  * }
  * @endcode
  */
-void dled_pixel_move_pixel(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step);
+void dled_pixel_move_pixel(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint32_t step);
 
 /**
  * @brief Moves a number of pixels back and forth
@@ -117,9 +237,9 @@ void dled_pixel_move_pixel(pixel_t *pixels, uint16_t length, uint8_t max_cc_val,
  * }
  * @endcode
  */
-void dled_pixel_chase_pixels(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step, uint16_t num);
+void dled_pixel_chase_pixels(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint32_t step, uint32_t num);
 
-void dled_pixel_chase_pixel_test(pixel_t *pixels, uint16_t length, uint8_t max_cc_val, uint16_t step, uint16_t num);
+void dled_pixel_chase_pixel_test(pixel_t *pixels, uint32_t length, uint8_t max_cc_val, uint32_t step, uint32_t num);
 
 #ifdef __cplusplus
 }
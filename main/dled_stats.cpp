@@ -0,0 +1,181 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "dled_stats.h"
+#include "boot_arena.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *LOG_TAG  = "dled_stats";
+
+static const char * const dled_stats_stage_names[DLED_STATS_STAGES] = {
+    "render", "fill", "encode", "transmit"
+};
+
+static void dled_stats_clear(dled_stats_effect_t *effect) {
+    memset(effect, 0, sizeof(dled_stats_effect_t));
+    effect->since_us = esp_timer_get_time();
+}
+
+esp_err_t dled_stats_init(dled_stats_t *stats, const char * const *names, uint8_t count) {
+    if (stats == NULL || names == NULL || count > DLED_STATS_MAX_EFFECTS) {
+        ESP_LOGE(LOG_TAG, "init: Argument is NULL or too many effects");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t i = 0; i < DLED_STATS_MAX_EFFECTS; i++) {
+        stats->names[i] = i < count ? names[i] : NULL;
+        for (uint8_t w = 0; w < DLED_STATS_WINDOWS; w++) {
+            dled_stats_clear(&stats->effects[w][i]);
+        }
+    }
+    stats->count = count;
+    vPortCPUInitializeMutex(&stats->lock);
+
+    /* too large for the stack of the HTTP server */
+    stats->scratch = (dled_stats_effect_t*)boot_arena_alloc(sizeof(dled_stats_effect_t), BOOT_ARENA_INTERNAL);
+    if (stats->scratch == NULL) {
+        ESP_LOGE(LOG_TAG, "Failed to allocate memory for the statistics");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+static uint8_t dled_stats_bucket(uint32_t us) {
+    if (us < 4) { return us; }
+
+    uint8_t power = 31 - __builtin_clz(us);
+    uint8_t bucket = 2 * power + ((us >> (power - 1)) & 1);
+    return bucket < DLED_STATS_BUCKETS ? bucket : DLED_STATS_BUCKETS - 1;
+}
+
+/* Largest time of the bucket */
+static uint32_t dled_stats_bucket_end(uint8_t bucket) {
+    if (bucket < 4) { return bucket; }
+
+    uint8_t power = bucket / 2;
+    return ((2 + (bucket & 1)) << (power - 1)) + (1 << (power - 1)) - 1;
+}
+
+static void dled_stats_histogram_add(dled_stats_histogram_t *histogram, uint32_t us) {
+    if (histogram->count == 0 || us < histogram->min_us) { histogram->min_us = us; }
+    if (us > histogram->max_us) { histogram->max_us = us; }
+    histogram->count++;
+    histogram->buckets[dled_stats_bucket(us)]++;
+}
+
+esp_err_t dled_stats_add(dled_stats_t *stats, uint8_t effect, const dled_stats_frame_t *frame) {
+    if (stats == NULL || frame == NULL || effect >= stats->count) {
+        ESP_LOGE(LOG_TAG, "add: Argument is NULL or unknown effect");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats->lock);
+    for (uint8_t w = 0; w < DLED_STATS_WINDOWS; w++) {
+        dled_stats_effect_t *dst = &stats->effects[w][effect];
+        dst->frames++;
+        if (frame->dropped) { dst->dropped++; }
+        for (uint8_t i = 0; i < DLED_STATS_STAGES; i++) {
+            if (frame->stage_us[i] != DLED_STATS_NONE) {
+                dled_stats_histogram_add(&dst->stages[i], frame->stage_us[i]);
+            }
+        }
+    }
+    portEXIT_CRITICAL(&stats->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t dled_stats_read(dled_stats_t *stats, dled_stats_window_t window, uint8_t effect, dled_stats_effect_t *copy) {
+    if (stats == NULL || copy == NULL || window >= DLED_STATS_WINDOWS || effect >= stats->count) {
+        ESP_LOGE(LOG_TAG, "read: Argument is NULL, unknown window or effect");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats->lock);
+    memcpy(copy, &stats->effects[window][effect], sizeof(dled_stats_effect_t));
+    if (window == DLED_STATS_PERIOD) {
+        dled_stats_clear(&stats->effects[window][effect]);
+    }
+    portEXIT_CRITICAL(&stats->lock);
+
+    return ESP_OK;
+}
+
+uint32_t dled_stats_percentile(const dled_stats_histogram_t *histogram, uint8_t percent) {
+    if (histogram == NULL || histogram->count == 0) { return 0; }
+
+    uint32_t rank = ((uint64_t)histogram->count * percent + 99) / 100;
+    if (rank == 0) { rank = 1; }
+    uint32_t seen = 0;
+    uint8_t bucket = 0;
+    for (; bucket < DLED_STATS_BUCKETS - 1; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= rank) { break; }
+    }
+
+    uint32_t us = dled_stats_bucket_end(bucket);
+    if (us > histogram->max_us) { us = histogram->max_us; }
+    if (us < histogram->min_us) { us = histogram->min_us; }
+    return us;
+}
+
+int dled_stats_effect_json(const char *name, const dled_stats_effect_t *stats, char *buffer, size_t size) {
+    if (name == NULL || stats == NULL || buffer == NULL) { return -1; }
+
+    size_t length = snprintf(buffer, size, "{\"effect\":\"%s\",\"window_ms\":%u,\"frames\":%u,\"dropped\":%u",
+                             name, (unsigned)((esp_timer_get_time() - stats->since_us) / 1000),
+                             (unsigned)stats->frames, (unsigned)stats->dropped);
+    for (uint8_t i = 0; i < DLED_STATS_STAGES && length < size; i++) {
+        const dled_stats_histogram_t *histogram = &stats->stages[i];
+        length += snprintf(buffer + length, size - length,
+                           ",\"%s\":{\"count\":%u,\"min\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u}",
+                           dled_stats_stage_names[i], (unsigned)histogram->count,
+                           (unsigned)histogram->min_us,
+                           (unsigned)dled_stats_percentile(histogram, 50),
+                           (unsigned)dled_stats_percentile(histogram, 99),
+                           (unsigned)histogram->max_us);
+    }
+    if (length < size) {
+        length += snprintf(buffer + length, size - length, "}");
+    }
+
+    return length < size ? (int)length : -1;
+}
+
+int dled_stats_json(dled_stats_t *stats, char *buffer, size_t size) {
+    if (stats == NULL || stats->scratch == NULL || buffer == NULL) { return -1; }
+
+    dled_stats_effect_t *copy = stats->scratch;
+
+    size_t length = snprintf(buffer, size, "{\"effects\":[");
+    bool first = true;
+    for (uint8_t i = 0; i < stats->count && length < size; i++) {
+        dled_stats_read(stats, DLED_STATS_SINCE_BOOT, i, copy);
+        if (copy->frames == 0) { continue; }
+
+        if (!first) { length += snprintf(buffer + length, size - length, ","); }
+        first = false;
+        if (length >= size) { break; }
+        int written = dled_stats_effect_json(stats->names[i], copy, buffer + length, size - length);
+        if (written < 0) {
+            length = size;
+            break;
+        }
+        length += written;
+    }
+    if (length < size) {
+        length += snprintf(buffer + length, size - length, "]}");
+    }
+
+    return length < size ? (int)length : -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,206 @@
+#ifndef MAIN_DLED_STATS_H_
+#define MAIN_DLED_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Maximum number of effects with their own statistics.
+ */
+#define DLED_STATS_MAX_EFFECTS 8
+
+/**
+ * @brief Number of buckets of a histogram.
+ *
+ * Below 4 us every microsecond has its bucket, then every power of two is split in two
+ * buckets, so the last bucket starts at 786 ms. Percentiles are upper bounds, at most
+ * 50 % above the real time.
+ */
+#define DLED_STATS_BUCKETS 40
+
+/**
+ * @brief Value of a stage that did not run for a frame.
+ */
+#define DLED_STATS_NONE UINT32_MAX
+
+/**
+ * @brief Size of a buffer large enough for dled_stats_json with all the effects.
+ */
+#define DLED_STATS_JSON_SIZE (64 + DLED_STATS_MAX_EFFECTS * 480)
+
+/**
+ * @brief Size of a buffer large enough for dled_stats_effect_json.
+ */
+#define DLED_STATS_EFFECT_JSON_SIZE 480
+
+/**
+ * @brief The steps of a frame
+ */
+typedef enum {
+    DLED_STATS_RENDER = 0, /*!< The effect changing the pixels */
+    DLED_STATS_FILL,       /*!< The output preparing the LED data */
+    DLED_STATS_ENCODE,     /*!< The output encoding the LED data */
+    DLED_STATS_TRANSMIT,   /*!< The LED data on the wire */
+    DLED_STATS_STAGES
+} dled_stats_stage_t;
+
+/**
+ * @brief Distribution of the times of one stage, in microseconds
+ */
+typedef struct {
+    uint32_t count;  /*!< Number of times recorded */
+    uint32_t min_us; /*!< Shortest time */
+    uint32_t max_us; /*!< Longest time */
+    uint32_t buckets[DLED_STATS_BUCKETS]; /*!< Number of times in every bucket */
+} dled_stats_histogram_t;
+
+/**
+ * @brief Statistics of one effect
+ */
+typedef struct {
+    int64_t  since_us; /*!< Start of the statistics, esp_timer_get_time */
+    uint32_t frames;   /*!< Number of frames rendered */
+    uint32_t dropped;  /*!< Frames not sent or sent after their deadline */
+    dled_stats_histogram_t stages[DLED_STATS_STAGES]; /*!< Times of every stage */
+} dled_stats_effect_t;
+
+/**
+ * @brief The windows of the statistics, every frame is recorded in all of them
+ */
+typedef enum {
+    DLED_STATS_SINCE_BOOT = 0, /*!< Never started again, for /stats.json */
+    DLED_STATS_PERIOD,         /*!< Started again by every read, for the telemetry */
+    DLED_STATS_WINDOWS
+} dled_stats_window_t;
+
+/**
+ * @brief Statistics of the frames of every effect
+ *
+ * Fixed size, only `scratch` is allocated. One task records the frames, other tasks can
+ * read the statistics at the same time, each from its own window.
+ */
+typedef struct {
+    const char          *names[DLED_STATS_MAX_EFFECTS]; /*!< Name of every effect */
+    uint8_t             count;                          /*!< Number of effects */
+    dled_stats_effect_t effects[DLED_STATS_WINDOWS][DLED_STATS_MAX_EFFECTS]; /*!< Statistics of every effect in every window */
+    portMUX_TYPE        lock;                           /*!< Held while `effects` are changed or copied */
+    dled_stats_effect_t *scratch;                       /*!< Copy of an effect for dled_stats_json */
+} dled_stats_t;
+
+/**
+ * @brief Times of one frame
+ */
+typedef struct {
+    uint32_t stage_us[DLED_STATS_STAGES]; /*!< Time of every stage, DLED_STATS_NONE if it did not run */
+    bool     dropped;                     /*!< true if the frame was not sent or missed its deadline */
+} dled_stats_frame_t;
+
+/**
+ * @brief Initialize a dled_stats_t structure.
+ *
+ * @param[in,out] stats The structure to be initialized.
+ * @param[in]     names Name of every effect, must stay valid. Effect `n` is `names[n]`.
+ * @param[in]     count Number of effects, at most DLED_STATS_MAX_EFFECTS.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL or `count` is too large
+ *    - ESP_ERR_NO_MEM if failed to allocate memory for `scratch`
+ */
+esp_err_t dled_stats_init(dled_stats_t *stats, const char * const *names, uint8_t count);
+
+/**
+ * @brief Set all the stages of a frame to DLED_STATS_NONE
+ */
+static inline void dled_stats_frame_init(dled_stats_frame_t *frame) {
+    for (uint8_t i = 0; i < DLED_STATS_STAGES; i++) {
+        frame->stage_us[i] = DLED_STATS_NONE;
+    }
+    frame->dropped = false;
+}
+
+/**
+ * @brief Record the times of a frame
+ *
+ * @param[in,out] stats  The statistics.
+ * @param[in]     effect The effect which rendered the frame.
+ * @param[in]     frame  The times of the frame.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL or `effect` is unknown
+ */
+esp_err_t dled_stats_add(dled_stats_t *stats, uint8_t effect, const dled_stats_frame_t *frame);
+
+/**
+ * @brief Copy the statistics of an effect
+ *
+ * The statistics of DLED_STATS_PERIOD start again once copied.
+ *
+ * @param[in,out] stats  The statistics.
+ * @param[in]     window The window read.
+ * @param[in]     effect The effect.
+ * @param[out]    copy   Where the statistics are copied.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL, `window` or `effect` is unknown
+ */
+esp_err_t dled_stats_read(dled_stats_t *stats, dled_stats_window_t window, uint8_t effect, dled_stats_effect_t *copy);
+
+/**
+ * @brief Time below which `percent` % of the times of a histogram are
+ *
+ * Gives the upper bound of the bucket, kept between the shortest and the longest time.
+ *
+ * @return The time in microseconds, 0 if the histogram is empty
+ */
+uint32_t dled_stats_percentile(const dled_stats_histogram_t *histogram, uint8_t percent);
+
+/**
+ * @brief Write the statistics of an effect as a JSON object
+ *
+ * @code
+ * {"effect":"rainbow","window_ms":60000,"frames":6000,"dropped":0,
+ *  "render":{"count":6000,"min":41,"p50":47,"p99":95,"max":312},"fill":{...},"encode":{...},"transmit":{...}}
+ * @endcode
+ * Times are in microseconds.
+ *
+ * @param[in]  name   Name of the effect.
+ * @param[in]  stats  The statistics of the effect, from dled_stats_read.
+ * @param[out] buffer Where the text is written.
+ * @param[in]  size   Size of `buffer`, DLED_STATS_EFFECT_JSON_SIZE is enough.
+ *
+ * @return The length of the text, -1 if it does not fit in `buffer`
+ */
+int dled_stats_effect_json(const char *name, const dled_stats_effect_t *stats, char *buffer, size_t size);
+
+/**
+ * @brief Write the statistics since boot of the effects which rendered frames as a JSON object
+ *
+ * Uses `stats->scratch`, so only one task may call it. Doesn't start any window again.
+ *
+ * @code
+ * {"effects":[{"effect":"rainbow",...},{"effect":"twinkle",...}]}
+ * @endcode
+ *
+ * @param[in,out] stats  The statistics.
+ * @param[out]    buffer Where the text is written.
+ * @param[in]     size   Size of `buffer`, DLED_STATS_JSON_SIZE is enough.
+ *
+ * @return The length of the text, -1 if it does not fit in `buffer`
+ */
+int dled_stats_json(dled_stats_t *stats, char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
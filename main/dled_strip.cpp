@@ -3,11 +3,19 @@ extern "C" {
 #endif
 
 #include "dled_strip.h"
+#include "dled_format.h"
+#include "boot_arena.h"
 
+#include <math.h>
+#include <string.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 
 static const char *LOG_TAG  = "dled_strip";
 
+/* Gamma of the correction applied by dled_strip_set_gamma */
+#define DLED_STRIP_GAMMA 2.2f
+
 esp_err_t dled_strip_init(pixel_strip_t *strip)
 {
     if (strip == NULL) { return ESP_ERR_INVALID_ARG; }
@@ -19,6 +27,21 @@ esp_err_t dled_strip_init(pixel_strip_t *strip)
     strip->buffer_length = 0;
     strip->bytes_per_led = 0;
     strip->max_cc_val = 0;
+    strip->gamma = false;
+    memset(strip->levels, 0, sizeof(strip->levels));
+    strip->pixels16 = NULL;
+    strip->residuals = NULL;
+    strip->levels16 = NULL;
+    strip->hd = false;
+    strip->parent = NULL;
+    strip->parent_first = 0;
+    strip->source_length = 0;
+    strip->offset = 0;
+    strip->reverse = false;
+    strip->mirror = false;
+    strip->map_length = 0;
+    strip->dirty_first = 0;
+    strip->dirty_end = 0;
     strip->T0H = 0; strip->T0L = 0;
     strip->T1H = 0; strip->T1L = 0;
     strip->TRS = 0;
@@ -47,14 +70,19 @@ void dled_strip_set_timings(pixel_strip_t *strip)
             strip->T0H = 400; strip->T0L = 850; strip->T1H = 800; strip->T1L = 450; strip->TRS = 50000;
             break;
         case DLED_WS281x:
+        case DLED_WS2811: /* the WS2811 12mm pixels work well with these */
             strip->T0H = 400; strip->T0L = 850; strip->T1H = 850; strip->T1L = 400; strip->TRS = 50000;
             break;
+        case DLED_SK6812:
+        case DLED_SK6812_RGBW:
+            strip->T0H = 300; strip->T0L = 900; strip->T1H = 600; strip->T1L = 600; strip->TRS = 80000;
+            break;
     }
 }
 
-esp_err_t dled_strip_create(pixel_strip_t *strip, dstrip_type_t strip_type, uint16_t length, uint8_t max_cc_val_in)
+esp_err_t dled_strip_create(pixel_strip_t *strip, dstrip_type_t strip_type, uint32_t length, uint8_t max_cc_val_in)
 {
-    uint16_t req_length;
+    uint32_t req_length;
 
     if (strip == NULL) {
         ESP_LOGE(LOG_TAG, "Argument is NULL");
@@ -76,8 +104,13 @@ esp_err_t dled_strip_create(pixel_strip_t *strip, dstrip_type_t strip_type, uint
         case DLED_WS2813:
         case DLED_WS2815:
         case DLED_WS281x:
+        case DLED_WS2811:
+        case DLED_SK6812:
             strip->bytes_per_led = 3;
             break;
+        case DLED_SK6812_RGBW:
+            strip->bytes_per_led = 4;
+            break;
         default:
             ESP_LOGE(LOG_TAG, "Unknown strip type");
             strip->type = DLED_NULL;
@@ -90,41 +123,127 @@ esp_err_t dled_strip_create(pixel_strip_t *strip, dstrip_type_t strip_type, uint
     }
 
     req_length = length * sizeof(pixel_t);
-    strip->pixels = (pixel_t*)malloc(req_length);
+    strip->pixels = (pixel_t*)boot_arena_alloc(req_length, BOOT_ARENA_INTERNAL);
     if (strip->pixels == NULL) {
         strip->buffer = NULL;
-        ESP_LOGE(LOG_TAG, "Failed to allocate memory for pixels");
+        dled_strip_log_no_mem(LOG_TAG, "pixels", req_length, true);
         return ESP_ERR_NO_MEM;
     }
     else {
         ESP_LOGI(LOG_TAG, "Allocated %d bytes for pixels", req_length);
     }
 
-    req_length = length * strip->bytes_per_led * sizeof(uint8_t);
-    strip->buffer = (uint8_t*)malloc(req_length);
-    if (strip->buffer == NULL) {
-        free(strip->pixels);
-        strip->pixels = NULL;
-        ESP_LOGE(LOG_TAG, "Failed to allocate memory for buffer");
-        return ESP_ERR_NO_MEM;
-    }
-    else {
-        ESP_LOGI(LOG_TAG, "Allocated %d bytes for output buffer", req_length);
-    }
+    /* `buffer` is only needed by dled_strip_fill_buffer, it is allocated on first use */
+    strip->buffer = NULL;
 
     strip->length = length;
     strip->buffer_length = length * strip->bytes_per_led;
+    strip->source_length = length;
+    strip->map_length = length;
 
-    strip->max_cc_val = max_cc_val_in;
+    strip->gamma = false;
+    dled_strip_set_brightness(strip, max_cc_val_in);
 
     dled_strip_set_timings(strip);
 
-    for (uint16_t i = 0; i < strip->length; i++)
+    for (uint32_t i = 0; i < strip->length; i++)
         dled_pixel_off(&strip->pixels[i]);
+    dled_strip_mark_all_dirty(strip);
+
+    return ESP_OK;
+}
+
+esp_err_t dled_strip_create_view(pixel_strip_t *view, pixel_strip_t *parent, uint32_t first, uint32_t length)
+{
+    if (view == NULL || parent == NULL || parent->pixels == NULL) {
+        ESP_LOGE(LOG_TAG, "Argument is NULL or parent is not created");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (length == 0 || first >= parent->length || length > parent->length - first) {
+        ESP_LOGE(LOG_TAG, "View of %d pixels at %d does not fit in %d pixels", length, first, parent->length);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    view->parent = parent;
+    view->parent_first = first;
+
+    view->type = parent->type;
+    view->bytes_per_led = parent->bytes_per_led;
+    view->pixels = parent->pixels + first;
+    view->length = length;
+    view->buffer = NULL;
+    view->buffer_length = length * view->bytes_per_led;
+
+    dled_strip_set_timings(view);
+
+    view->map_length = parent->length;
+    view->source_length = parent->length;
+    view->offset = 0;
+    view->reverse = false;
+    view->mirror = false;
+
+    /* output levels, high precision pixels and changes are taken from the parent */
+    view->max_cc_val = parent->max_cc_val;
+    view->gamma = parent->gamma;
+    memcpy(view->levels, parent->levels, sizeof(view->levels));
+    view->pixels16 = NULL;
+    view->residuals = NULL;
+    view->levels16 = NULL;
+    view->hd = false;
+    dled_strip_mark_all_dirty(view);
+    dled_strip_sync_view(view);
 
     return ESP_OK;
 }
 
+bool dled_strip_sync_view(pixel_strip_t *view)
+{
+    if (view == NULL || view->parent == NULL) return false;
+
+    pixel_strip_t *parent = view->parent;
+
+    if (view->max_cc_val != parent->max_cc_val || view->gamma != parent->gamma) {
+        view->max_cc_val = parent->max_cc_val;
+        view->gamma = parent->gamma;
+        memcpy(view->levels, parent->levels, sizeof(view->levels));
+        dled_strip_mark_all_dirty(view);
+    }
+    /* the parent's high precision pixels may be created after the view */
+    if (view->pixels16 == NULL && parent->pixels16 != NULL) {
+        view->pixels16 = parent->pixels16 + view->parent_first;
+        view->residuals = parent->residuals + view->parent_first * view->bytes_per_led;
+        view->levels16 = parent->levels16;
+    }
+    if (view->hd != parent->hd) {
+        view->hd = parent->hd;
+        dled_strip_mark_all_dirty(view);
+    }
+    if (view->source_length != parent->source_length || view->offset != parent->offset ||
+        view->reverse != parent->reverse || view->mirror != parent->mirror) {
+        view->source_length = parent->source_length;
+        view->offset = parent->offset;
+        view->reverse = parent->reverse;
+        view->mirror = parent->mirror;
+        dled_strip_mark_all_dirty(view);
+    }
+
+    /* with transformations a changed pixel may be shown anywhere */
+    if (parent->dirty_first < parent->dirty_end && dled_strip_is_mapped(view)) {
+        dled_strip_mark_all_dirty(view);
+    }
+    else if (parent->dirty_first < parent->dirty_end) {
+        uint32_t first = view->parent_first;
+        uint32_t end = first + view->length;
+        if (parent->dirty_first > first) first = parent->dirty_first;
+        if (parent->dirty_end < end) end = parent->dirty_end;
+        if (first < end) {
+            dled_strip_mark_dirty(view, first - view->parent_first, end - first);
+        }
+    }
+
+    return view->hd || view->dirty_first < view->dirty_end;
+}
+
 esp_err_t dled_strip_destroy(pixel_strip_t *strip)
 {
     if (strip == NULL) {
@@ -132,8 +251,13 @@ esp_err_t dled_strip_destroy(pixel_strip_t *strip)
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (strip->pixels != NULL) { free(strip->pixels); }
-    if (strip->buffer != NULL) { free(strip->buffer); }
+    boot_arena_free(strip->buffer);
+    if (strip->parent == NULL) {
+        boot_arena_free(strip->pixels);
+        boot_arena_free(strip->pixels16);
+        boot_arena_free(strip->residuals);
+        boot_arena_free(strip->levels16);
+    }
 
     dled_strip_init(strip);
 
@@ -142,29 +266,229 @@ esp_err_t dled_strip_destroy(pixel_strip_t *strip)
     return ESP_OK;
 }
 
+/* Fills `buffer`, specialized for every LED format */
+extern "C++" struct dled_strip_fill {
+    typedef void (*type)(pixel_strip_t *strip);
+
+    template <class Format>
+    static type with() { return &fill<Format>; }
+
+    template <class Format>
+    static void fill(pixel_strip_t *strip) {
+        bool mapped = dled_strip_is_mapped(strip);
+        uint8_t *dst = strip->buffer;
+
+        if (strip->hd) {
+            for (uint32_t i = 0; i < strip->length; i++, dst += Format::bytes_per_led) {
+                dled_format_encode16<Format>(strip, i, mapped, dst);
+            }
+            return;
+        }
+        for (uint32_t i = 0; i < strip->length; i++, dst += Format::bytes_per_led) {
+            dled_format_encode<Format>(strip, i, mapped, dst);
+        }
+    }
+};
+
 esp_err_t dled_strip_fill_buffer(pixel_strip_t *strip) {
     if (strip == NULL) {
         ESP_LOGE(LOG_TAG, "Argument is NULL");
         return ESP_ERR_INVALID_ARG;
     }
 
+    if (strip->buffer == NULL) {
+        strip->buffer = (uint8_t*)boot_arena_alloc(strip->buffer_length * sizeof(uint8_t), BOOT_ARENA_INTERNAL);
+        if (strip->buffer == NULL) {
+            dled_strip_log_no_mem(LOG_TAG, "output buffer", strip->buffer_length, true);
+            return ESP_ERR_NO_MEM;
+        }
+        else {
+            ESP_LOGI(LOG_TAG, "Allocated %d bytes for output buffer", strip->buffer_length);
+        }
+    }
+
     /* To not waste CPU cycles I do not check if:
-    *    strip->buffer != NULL
     *    strip->pixels != NULL
     *    the sizes are OK
     * because here these "should" be right. */
 
-    /* WS2812, WS2812B and WS2813 are GRB */
-    uint16_t didx = 0;
-    for (uint16_t i = 0; i < strip->length; i++) {
-        strip->buffer[didx++] = strip->pixels[i].g;
-        strip->buffer[didx++] = strip->pixels[i].r;
-        strip->buffer[didx++] = strip->pixels[i].b;
+    dled_format_select<dled_strip_fill>(strip->type)(strip);
+
+    return ESP_OK;
+}
+
+/* Rebuilt only when the brightness or the gamma correction change, so the float math is fine here */
+void dled_strip_build_levels(pixel_strip_t *strip)
+{
+    for (uint16_t i = 0; i < 256; i++) {
+        if (strip->gamma) {
+            strip->levels[i] = (uint8_t)(powf(i / 255.0f, DLED_STRIP_GAMMA) * strip->max_cc_val + 0.5f);
+        }
+        else {
+            strip->levels[i] = (uint8_t)((i * strip->max_cc_val + 127) / 255);
+        }
+    }
+
+    if (strip->levels16 == NULL) return;
+
+    /* entry i is the level of i / 256 of the full value, the last one is the full value */
+    for (uint16_t i = 0; i <= 256; i++) {
+        float value = i / 256.0f;
+        if (strip->gamma) { value = powf(value, DLED_STRIP_GAMMA); }
+        strip->levels16[i] = (uint16_t)(value * strip->max_cc_val * 256 + 0.5f);
+    }
+}
+
+esp_err_t dled_strip_create_hd(pixel_strip_t *strip)
+{
+    if (strip == NULL || strip->pixels == NULL) {
+        ESP_LOGE(LOG_TAG, "Argument is NULL or strip is not created");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strip->pixels16 != NULL) return ESP_OK;
+
+    uint32_t req_length = strip->length * sizeof(pixel16_t) + strip->buffer_length + 257 * sizeof(uint16_t);
+    strip->pixels16 = (pixel16_t*)boot_arena_alloc(strip->length * sizeof(pixel16_t), BOOT_ARENA_INTERNAL);
+    strip->residuals = (uint8_t*)boot_arena_alloc(strip->buffer_length * sizeof(uint8_t), BOOT_ARENA_INTERNAL);
+    strip->levels16 = (uint16_t*)boot_arena_alloc(257 * sizeof(uint16_t), BOOT_ARENA_INTERNAL);
+    if (strip->pixels16 == NULL || strip->residuals == NULL || strip->levels16 == NULL) {
+        boot_arena_free(strip->pixels16);  strip->pixels16 = NULL;
+        boot_arena_free(strip->residuals); strip->residuals = NULL;
+        boot_arena_free(strip->levels16);  strip->levels16 = NULL;
+        dled_strip_log_no_mem(LOG_TAG, "high precision pixels", req_length, true);
+        return ESP_ERR_NO_MEM;
+    }
+    else {
+        ESP_LOGI(LOG_TAG, "Allocated %d bytes for high precision pixels", req_length);
+    }
+
+    dled_strip_build_levels(strip);
+
+    return ESP_OK;
+}
+
+esp_err_t dled_strip_set_hd(pixel_strip_t *strip, bool hd)
+{
+    if (strip == NULL) {
+        ESP_LOGE(LOG_TAG, "Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (hd && strip->pixels16 == NULL) {
+        ESP_LOGE(LOG_TAG, "No high precision pixels");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    strip->hd = hd;
+    dled_strip_mark_all_dirty(strip);
+
+    return ESP_OK;
+}
+
+void dled_strip_set_brightness(pixel_strip_t *strip, uint8_t max_cc_val)
+{
+    if (strip == NULL) return;
+
+    strip->max_cc_val = max_cc_val;
+    dled_strip_build_levels(strip);
+    dled_strip_mark_all_dirty(strip);
+}
+
+void dled_strip_set_gamma(pixel_strip_t *strip, bool gamma)
+{
+    if (strip == NULL) return;
+
+    strip->gamma = gamma;
+    dled_strip_build_levels(strip);
+    dled_strip_mark_all_dirty(strip);
+}
+
+esp_err_t dled_strip_set_transform(pixel_strip_t *strip, bool reverse, bool mirror, uint32_t source_length)
+{
+    if (strip == NULL || strip->parent != NULL) {
+        ESP_LOGE(LOG_TAG, "Argument is NULL or a view");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (source_length == 0) { source_length = strip->length; }
+    if (source_length > strip->length) {
+        ESP_LOGE(LOG_TAG, "%d pixels do not fit in %d pixels", source_length, strip->length);
+        return ESP_ERR_INVALID_SIZE;
     }
 
+    strip->reverse = reverse;
+    strip->mirror = mirror;
+    strip->source_length = source_length;
+    strip->offset = strip->offset % source_length;
+    dled_strip_mark_all_dirty(strip);
+
     return ESP_OK;
 }
 
+void dled_strip_set_offset(pixel_strip_t *strip, uint32_t offset)
+{
+    if (strip == NULL || strip->parent != NULL) return;
+    if (strip->source_length == 0) return;
+
+    strip->offset = offset % strip->source_length;
+    dled_strip_mark_all_dirty(strip);
+}
+
+void dled_strip_set_pixel(pixel_strip_t *strip, uint32_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (strip == NULL) return;
+    if (index >= strip->length) return;
+
+    pixel_t *pixel = &strip->pixels[index];
+    if (pixel->r == r && pixel->g == g && pixel->b == b) return;
+
+    dled_pixel_set(pixel, r, g, b);
+    dled_strip_mark_dirty(strip, index, 1);
+}
+
+void dled_strip_mark_dirty(pixel_strip_t *strip, uint32_t first, uint32_t count)
+{
+    if (strip == NULL) return;
+    if (first >= strip->length || count == 0) return;
+
+    uint32_t end = (count > strip->length - first) ? strip->length : first + count;
+
+    if (strip->dirty_first >= strip->dirty_end) {
+        strip->dirty_first = first;
+        strip->dirty_end = end;
+        return;
+    }
+    if (first < strip->dirty_first) strip->dirty_first = first;
+    if (end > strip->dirty_end) strip->dirty_end = end;
+}
+
+void dled_strip_mark_all_dirty(pixel_strip_t *strip)
+{
+    if (strip == NULL) return;
+
+    strip->dirty_first = 0;
+    strip->dirty_end = strip->length;
+}
+
+void dled_strip_clear_dirty(pixel_strip_t *strip)
+{
+    if (strip == NULL) return;
+
+    strip->dirty_first = 0;
+    strip->dirty_end = 0;
+}
+
+void dled_strip_log_no_mem(const char *tag, const char *what, size_t size, bool arena)
+{
+    size_t used, left;
+
+    if (arena && boot_arena_usage(BOOT_ARENA_INTERNAL, &used, &left) == ESP_OK) {
+        ESP_LOGE(tag, "Failed to allocate %d bytes for %s, internal arena region %d bytes used and %d bytes left",
+                 (int)size, what, (int)used, (int)left);
+        return;
+    }
+    ESP_LOGE(tag, "Failed to allocate %d bytes for %s, %d bytes free, largest free block %d bytes",
+             (int)size, what, (int)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (int)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
 
 #ifdef __cplusplus
 }
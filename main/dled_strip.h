@@ -7,6 +7,7 @@ extern "C" {
 
 #include "dled_pixel.h"
 
+#include <stdbool.h>
 #include "esp_err.h"
 
 /**
@@ -20,21 +21,43 @@ typedef enum {
     DLED_WS2812D,
     DLED_WS2813,
     DLED_WS2815,
-    DLED_WS281x    /*!< This value should work for all WS281* and clones */
+    DLED_WS281x,   /*!< This value should work for all WS281* and clones */
+    DLED_WS2811,   /*!< WS2811 and the pixels using it, RGB order */
+    DLED_SK6812,
+    DLED_SK6812_RGBW /*!< SK6812 with a white LED, 4 bytes per LED */
 } dstrip_type_t;
 
 /**
  * @brief Structure to be used as a LED strip
  *
  */
-typedef struct {
+typedef struct pixel_strip_t_ {
 	pixel_t* pixels;        /*!< these are the pixels, one for each LED */
-	uint16_t length;        /*!< the number of pixels */
+	uint32_t length;        /*!< the number of pixels */
 
-	uint8_t* buffer;        /*!< buffer to hold data to be sent to LEDs */
-	uint16_t buffer_length; /*!< length, in bytes, of buffer */
+	uint8_t* buffer;        /*!< buffer to hold data to be sent to LEDs, allocated by dled_strip_fill_buffer */
+	uint32_t buffer_length; /*!< length, in bytes, of buffer */
 
-	uint8_t max_cc_val;     /*!< maximum value allowed for a color component */
+	uint8_t max_cc_val;     /*!< maximum value allowed for a color component, the brightness of the strip */
+	bool gamma;             /*!< true if the gamma correction is applied */
+	uint8_t levels[256];    /*!< output level of every color component value, applied when encoding */
+
+	pixel16_t* pixels16;    /*!< high precision pixels, allocated by dled_strip_create_hd */
+	uint8_t* residuals;     /*!< dithering error left by the last frame, one per byte sent */
+	uint16_t* levels16;     /*!< output levels of `pixels16` in 8.8 fixed point, 257 entries interpolated */
+	bool hd;                /*!< true if `pixels16` are sent instead of `pixels` */
+
+	struct pixel_strip_t_* parent; /*!< the strip owning the pixels, only for views (see dled_strip_create_view) */
+	uint32_t parent_first;         /*!< index in `parent` of the first pixel of the view, 0 if not a view */
+
+	uint32_t source_length; /*!< number of pixels rendered, repeated (tiled) over the strip if less than `map_length` */
+	uint32_t offset;        /*!< the pixels are shown moved by `offset` positions, less than `source_length` */
+	bool reverse;           /*!< true if the pixels are shown from the end of the strip */
+	bool mirror;            /*!< true if the second half of the strip shows the first half reversed */
+	uint32_t map_length;    /*!< length of the strip the transformations apply to, the parent's for views */
+
+	uint32_t dirty_first;   /*!< first pixel changed since the last encoding */
+	uint32_t dirty_end;     /*!< one past the last pixel changed since the last encoding, no change if <= `dirty_first` */
 
 	dstrip_type_t type;          /*!< type of digital LEDs */
 	uint8_t bytes_per_led;       /*!< number of bytes per LED */
@@ -56,28 +79,66 @@ esp_err_t dled_strip_init(pixel_strip_t *strip);
 /**
  * @brief Creates the buffers and set the members of a pixel_strip_t structure.
  *
- * Creates `pixels` and `buffers` of a pixel_strip_t structure.
+ * Creates `pixels` of a pixel_strip_t structure. `buffer` is created by the first
+ * call of dled_strip_fill_buffer. The gamma correction is off.
  * Based of supplied parameters it sets all of the structure's members.
  *
  * @param[in,out] strip      The structure to work with.
  * @param[in]     strip_type The type of digital LEDs.
  * @param[in]     length     The number of digital LEDs.
- * @param[in]     max_cc_val The maximum value allowed for a color component.
+ * @param[in]     max_cc_val The brightness, see dled_strip_set_brightness.
  *
  * @return
  *    - ESP_OK success
  *    - ESP_ERR_INVALID_ARG if the `strip` argument is NULL __OR__ `strip_type` is unknown or DSTRIP_NULL
  *    - ESP_ERR_INVALID_SIZE if length is zero
- *    - ESP_ERR_NO_MEM if failed to allocate memory for `pixels` or `buffer`
+ *    - ESP_ERR_NO_MEM if failed to allocate memory for `pixels`, the free memory is logged
+ */
+esp_err_t dled_strip_create(pixel_strip_t *strip, dstrip_type_t strip_type, uint32_t length, uint8_t max_cc_val);
+
+/**
+ * @brief Make a pixel_strip_t structure a view of a part of another strip.
+ *
+ * The view does not own any pixels, `pixels` (and `pixels16`) point inside the parent's
+ * so it can be sent on its own while the effects work on the whole parent.
+ * Call dled_strip_sync_view before encoding the view.
+ *
+ * @param[in,out] view   The structure to be set, initialized by dled_strip_init.
+ * @param[in]     parent The strip owning the pixels, already created.
+ * @param[in]     first  Index in `parent` of the first pixel of the view.
+ * @param[in]     length The number of pixels of the view.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL or `parent` is not created
+ *    - ESP_ERR_INVALID_SIZE if length is zero or the view does not fit in `parent`
+ */
+esp_err_t dled_strip_create_view(pixel_strip_t *view, pixel_strip_t *parent, uint32_t first, uint32_t length);
+
+/**
+ * @brief Bring a view up to date with its parent.
+ *
+ * Takes the parent's changed pixels that are in the view, its output levels, its
+ * high precision pixels and its transformations. The parent's changes are not cleared, so every view of a parent
+ * can be synced before calling dled_strip_clear_dirty on the parent.
+ *
+ * @param[in,out] view The structure to work with.
+ *
+ * @return true if the view has changed pixels (or sends high precision pixels).
  */
-esp_err_t dled_strip_create(pixel_strip_t *strip, dstrip_type_t strip_type, uint16_t length, uint8_t max_cc_val);
+bool dled_strip_sync_view(pixel_strip_t *view);
 
 /**
  * @brief Destroy the buffers of a pixel_strip_t structure.
  *
- * Destroys `pixels` and `buffers` of a pixel_strip_t structure.
+ * Destroys `pixels` and `buffers` of a pixel_strip_t structure. The pixels of a view
+ * belong to its parent and are not destroyed.
  * Calls `dled_strip_init` to initialize the structure.
  *
+ * @attention The buffers are taken from the boot arena (see boot_arena_alloc), which
+ * keeps them until the next reboot: a strip is created once at boot, destroying and
+ * creating it again leaks its buffers every time.
+ *
  * @param[in,out] strip      The structure to work with.
  *
  * @return
@@ -89,16 +150,237 @@ esp_err_t dled_strip_destroy(pixel_strip_t *strip);
 /**
  * @brief Fill structure's `buffer` from structure's `pixels`
  *
- * Fill structure's `buffer` from structure's `pixels` based of the type of LEDs.
+ * Fill structure's `buffer` from structure's `pixels` (or `pixels16`) based of the type
+ * of LEDs, the transformations and the output levels. Allocates `buffer` if needed.
  *
  * @param[in,out] strip      The structure to work with.
  *
  * @return
  *    - ESP_OK success
  *    - ESP_ERR_INVALID_ARG if the `strip` argument is NULL
+ *    - ESP_ERR_NO_MEM if failed to allocate memory for `buffer`
  */
 esp_err_t dled_strip_fill_buffer(pixel_strip_t *strip);
 
+/**
+ * @brief Creates the high precision buffers of a pixel_strip_t structure.
+ *
+ * Creates `pixels16`, `residuals` and `levels16`. Call after dled_strip_create.
+ * `pixels16` are sent instead of `pixels` after dled_strip_set_hd.
+ *
+ * @param[in,out] strip The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `strip` argument is NULL or the strip is not created
+ *    - ESP_ERR_NO_MEM if failed to allocate memory for the buffers
+ */
+esp_err_t dled_strip_create_hd(pixel_strip_t *strip);
+
+/**
+ * @brief Choose between `pixels` and `pixels16` for output.
+ *
+ * `pixels16` are quantized to 8 bits when encoded. The error is carried to the next
+ * frame (temporal dithering) so levels between two 8 bit values are shown too, this
+ * needs every frame to be encoded and sent. Marks all pixels as changed.
+ *
+ * @param[in,out] strip The structure to work with.
+ * @param[in]     hd    true to send `pixels16`.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `strip` argument is NULL
+ *    - ESP_ERR_INVALID_STATE if `hd` is true and there are no `pixels16`
+ */
+esp_err_t dled_strip_set_hd(pixel_strip_t *strip, bool hd);
+
+/**
+ * @brief Quantize a high precision color component to its output level.
+ *
+ * @param[in]     levels16 The `levels16` of the strip.
+ * @param[in,out] residual The dithering error of the color component.
+ * @param[in]     value    The color component.
+ *
+ * @return The output level.
+ */
+static inline __attribute__((always_inline)) uint8_t dled_strip_dither(const uint16_t *levels16, uint8_t *residual, uint16_t value)
+{
+    uint16_t idx = value >> 8;
+    uint32_t lo = levels16[idx];
+    uint32_t level = lo + (((levels16[idx + 1] - lo) * (value & 0xff)) >> 8) + *residual;
+
+    *residual = level & 0xff;
+    return level >> 8;
+}
+
+/**
+ * @brief Set the brightness of the strip.
+ *
+ * Pixels are kept as they are, every color component is scaled to `max_cc_val`
+ * when encoded for output so effects can always use the full 0-255 range.
+ * Marks all pixels as changed.
+ *
+ * @param[in,out] strip      The structure to work with.
+ * @param[in]     max_cc_val The output level of a 255 color component.
+ */
+void dled_strip_set_brightness(pixel_strip_t *strip, uint8_t max_cc_val);
+
+/**
+ * @brief Turn the gamma correction on or off.
+ *
+ * With the gamma correction the color components are mapped to output levels so the
+ * perceived brightness follows the values. Marks all pixels as changed.
+ *
+ * @param[in,out] strip The structure to work with.
+ * @param[in]     gamma true to turn on the gamma correction.
+ */
+void dled_strip_set_gamma(pixel_strip_t *strip, bool gamma);
+
+/**
+ * @brief Set how the pixels are placed on the strip.
+ *
+ * The pixels are not moved, the transformations are applied when encoding. In order:
+ * mirror, reverse, offset and tiling. With `mirror` the first half of the strip is shown
+ * reversed on the second half. The first `source_length` pixels are repeated over the
+ * strip (or its first half), so a pattern can be rendered once.
+ * Marks all pixels as changed.
+ *
+ * @param[in,out] strip         The structure to work with, not a view.
+ * @param[in]     reverse       true to show the pixels from the end of the strip.
+ * @param[in]     mirror        true to mirror the first half of the strip on the second half.
+ * @param[in]     source_length The number of pixels rendered, 0 for all of them.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `strip` argument is NULL or a view
+ *    - ESP_ERR_INVALID_SIZE if `source_length` is more than the strip's length
+ */
+esp_err_t dled_strip_set_transform(pixel_strip_t *strip, bool reverse, bool mirror, uint32_t source_length);
+
+/**
+ * @brief Move the pixels along the strip.
+ *
+ * Pixel `i` is shown at position `i + offset`, modulo `source_length`. This replaces moving
+ * all the pixels of the strip by one position with a single write.
+ * Marks all pixels as changed.
+ *
+ * @param[in,out] strip  The structure to work with, not a view.
+ * @param[in]     offset The new offset.
+ */
+void dled_strip_set_offset(pixel_strip_t *strip, uint32_t offset);
+
+/*
+ * Where the pixels are shown, after dled_strip_set_transform and dled_strip_set_offset.
+ * The encoders and the RMT interrupt handler call these for every pixel, so they are
+ * always inlined.
+ */
+
+/**
+ * @brief Check if the pixels are transformed, see dled_strip_set_transform.
+ *
+ * @param[in] strip The structure to work with.
+ *
+ * @return true if pixel `i` is not always shown at position `i`.
+ */
+static inline __attribute__((always_inline)) bool dled_strip_is_mapped(const pixel_strip_t *strip)
+{
+    return strip->offset != 0 || strip->reverse || strip->mirror || strip->source_length != strip->map_length;
+}
+
+/**
+ * @brief Get the pixel shown at a position of the strip.
+ *
+ * For views the index is in the parent's pixels, which start at `pixels - parent_first`.
+ *
+ * @param[in] strip The structure to work with.
+ * @param[in] index The position on the strip.
+ *
+ * @return Index of the pixel.
+ */
+static inline __attribute__((always_inline)) uint32_t dled_strip_source_index(const pixel_strip_t *strip, uint32_t index)
+{
+    uint32_t pos = strip->parent_first + index;
+    uint32_t span = strip->map_length;
+
+    if (strip->mirror) {
+        span = (span + 1) / 2;
+        if (pos >= span) { pos = strip->map_length - 1 - pos; }
+    }
+    if (strip->reverse) { pos = span - 1 - pos; }
+    pos = pos % strip->source_length;
+
+    return (pos >= strip->offset) ? pos - strip->offset : pos + strip->source_length - strip->offset;
+}
+
+/**
+ * @brief Get the address of the pixel shown at a position of the strip.
+ *
+ * @param[in] strip      The structure to work with.
+ * @param[in] pixels     `pixels` or `pixels16` of the strip.
+ * @param[in] pixel_size The size of a pixel of `pixels`.
+ * @param[in] index      The position on the strip.
+ * @param[in] mapped     The result of dled_strip_is_mapped.
+ *
+ * @return The address of the pixel.
+ */
+static inline __attribute__((always_inline)) const void* dled_strip_pixel_at(const pixel_strip_t *strip, const void *pixels,
+                                                                             size_t pixel_size, uint32_t index, bool mapped)
+{
+    /* a view may show a pixel of its parent before its own first one */
+    int32_t idx = mapped ? (int32_t)dled_strip_source_index(strip, index) - strip->parent_first : index;
+    return (const uint8_t*)pixels + idx * (int32_t)pixel_size;
+}
+
+/**
+ * @brief Set a pixel of the strip and mark it as changed.
+ *
+ * @param[in,out] strip   The structure to work with.
+ * @param[in]     index   Index of the pixel. Nothing is done if out of the strip.
+ * @param[in]     r, g, b The RGB color components.
+ */
+void dled_strip_set_pixel(pixel_strip_t *strip, uint32_t index, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Mark a range of pixels as changed.
+ *
+ * Call this after writing to `strip->pixels` directly. Only the changed pixels are
+ * encoded again by the output, the encoded data of the others is reused.
+ *
+ * @param[in,out] strip The structure to work with.
+ * @param[in]     first Index of the first changed pixel.
+ * @param[in]     count Number of changed pixels, clamped to the end of the strip.
+ */
+void dled_strip_mark_dirty(pixel_strip_t *strip, uint32_t first, uint32_t count);
+
+/**
+ * @brief Mark all pixels as changed.
+ *
+ * @param[in,out] strip The structure to work with.
+ */
+void dled_strip_mark_all_dirty(pixel_strip_t *strip);
+
+/**
+ * @brief Forget the changes, called by the output after encoding.
+ *
+ * @param[in,out] strip The structure to work with.
+ */
+void dled_strip_clear_dirty(pixel_strip_t *strip);
+
+/**
+ * @brief Log a failed allocation with the memory left.
+ *
+ * For a block of the arena, the use of its BOOT_ARENA_INTERNAL region: the heap was
+ * only tried because the region was full. For a block of the heap, or of an arena not
+ * initialized yet, the free heap and its largest free block, which tells a fragmented
+ * heap from a full one: long strips need a few large blocks.
+ *
+ * @param[in] tag   Tag of the log.
+ * @param[in] what  What the memory was for.
+ * @param[in] size  Number of bytes asked for.
+ * @param[in] arena true if the block was asked to boot_arena_alloc.
+ */
+void dled_strip_log_no_mem(const char *tag, const char *what, size_t size, bool arena);
+
 #ifdef __cplusplus
 }
 #endif
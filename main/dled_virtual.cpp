@@ -0,0 +1,221 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "dled_virtual.h"
+#include "dled_format.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *LOG_TAG  = "dled_virtual";
+
+esp_err_t dled_virtual_init(dled_virtual_sink_t *sink) {
+    if (sink == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    sink->strip = NULL;
+    sink->file = NULL;
+    sink->record_items = false;
+    rmt_dled_init(&sink->rps);
+    sink->frame = NULL;
+    sink->start_us = 0;
+    sink->frame_count = 0;
+    sink->timing.fill_us = 0;
+    sink->timing.encode_us = 0;
+    sink->timing.transmit_us = 0;
+
+    return ESP_OK;
+}
+
+/* Little endian whatever the host is, so recordings can be read anywhere */
+static void dled_virtual_put32(uint8_t *dst, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) {
+        dst[i] = value >> (8 * i);
+    }
+}
+
+static void dled_virtual_put64(uint8_t *dst, uint64_t value) {
+    dled_virtual_put32(dst, (uint32_t)value);
+    dled_virtual_put32(dst + 4, (uint32_t)(value >> 32));
+}
+
+static bool dled_virtual_write(dled_virtual_sink_t *sink, const void *data, size_t size) {
+    if (fwrite(data, 1, size, sink->file) != size) {
+        ESP_LOGE(LOG_TAG, "Failed to write %d bytes", (int)size);
+        return false;
+    }
+
+    return true;
+}
+
+esp_err_t dled_virtual_create(dled_virtual_sink_t *sink, pixel_strip_t *strip, FILE *file, bool record_items) {
+    if (sink == NULL || strip == NULL || file == NULL) {
+        ESP_LOGE(LOG_TAG, "create: Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sink->strip = strip;
+    sink->file = file;
+    sink->record_items = record_items;
+    sink->frame_count = 0;
+
+    if (record_items) {
+        /* the encoder of the RMT output, without the RMT peripheral. Its memory is
+        * given back by dled_virtual_destroy, a sink may be created again and again */
+        esp_err_t ret_val = rmt_dled_create_heap(&sink->rps, strip);
+        if (ret_val != ESP_OK) { return ret_val; }
+
+        sink->frame = (uint8_t*)malloc(strip->buffer_length);
+        if (sink->frame == NULL) {
+            ESP_LOGE(LOG_TAG, "Failed to allocate memory for frame");
+            dled_virtual_destroy(sink);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    uint8_t header[16];
+    memcpy(header, "DLED", 4);
+    header[4] = DLED_VIRTUAL_VERSION;
+    header[5] = record_items ? DLED_VIRTUAL_FLAG_ITEMS : 0;
+    header[6] = strip->bytes_per_led;
+    header[7] = 0; header[8] = 1; header[9] = 2; header[10] = 3;
+    dled_format_select<dled_format_order>(strip->type)(&header[7]);
+    header[11] = 0;
+    dled_virtual_put32(&header[12], strip->length);
+    if (!dled_virtual_write(sink, header, sizeof(header))) {
+        dled_virtual_destroy(sink);
+        return ESP_FAIL;
+    }
+
+    sink->start_us = esp_timer_get_time();
+    ESP_LOGI(LOG_TAG, "Recording %d LEDs%s", strip->length, record_items ? " with RMT items" : "");
+
+    return ESP_OK;
+}
+
+/* Encodes the frame to RMT items then reads the bytes back from them, so the high
+* precision pixels are dithered once, as they are when sending */
+static esp_err_t dled_virtual_encode_items(dled_virtual_sink_t *sink) {
+    rmt_pixel_strip_t *rps = &sink->rps;
+
+    esp_err_t ret_val = rmt_dled_encode_pixels(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    const rmt_item32_t *item = rps->ugly_buffer;
+    for (uint32_t i = 0; i < sink->strip->buffer_length; i++) {
+        uint8_t data = 0;
+        for (uint8_t bit = 0; bit < RMT_DLED_ITEMS_PER_BYTE; bit++, item++) {
+            data = (data << 1) | ((item->val == rps->rmtHI.val || item->val == rps->rmtHR.val) ? 1 : 0);
+        }
+        sink->frame[i] = data;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t dled_virtual_record(dled_virtual_sink_t *sink) {
+    if (sink == NULL || sink->strip == NULL || sink->file == NULL) {
+        ESP_LOGE(LOG_TAG, "record: Argument is NULL or not created");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pixel_strip_t *strip = sink->strip;
+    const uint8_t *frame;
+    esp_err_t ret_val;
+    int64_t start_us = esp_timer_get_time();
+
+    if (sink->record_items) {
+        ret_val = dled_virtual_encode_items(sink);
+        frame = sink->frame;
+        sink->timing.fill_us = 0;
+        sink->timing.encode_us = esp_timer_get_time() - start_us;
+    }
+    else {
+        ret_val = dled_strip_fill_buffer(strip);
+        dled_strip_clear_dirty(strip);
+        frame = strip->buffer;
+        sink->timing.fill_us = esp_timer_get_time() - start_us;
+        sink->timing.encode_us = 0;
+    }
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    start_us = esp_timer_get_time();
+
+    uint8_t time[8];
+    dled_virtual_put64(time, esp_timer_get_time() - sink->start_us);
+    if (!dled_virtual_write(sink, time, sizeof(time))) { return ESP_FAIL; }
+    if (!dled_virtual_write(sink, frame, strip->buffer_length)) { return ESP_FAIL; }
+
+    if (sink->record_items) {
+        uint8_t count[4];
+        dled_virtual_put32(count, sink->rps.item_count);
+        if (!dled_virtual_write(sink, count, sizeof(count))) { return ESP_FAIL; }
+        /* a few items at a time, as many write calls as items would be slow */
+        uint8_t items[64 * 4];
+        uint32_t pending = 0;
+        for (uint32_t i = 0; i < sink->rps.item_count; i++) {
+            dled_virtual_put32(&items[pending * 4], sink->rps.ugly_buffer[i].val);
+            if (++pending == 64 || i + 1 == sink->rps.item_count) {
+                if (!dled_virtual_write(sink, items, pending * 4)) { return ESP_FAIL; }
+                pending = 0;
+            }
+        }
+    }
+
+    sink->frame_count++;
+    sink->timing.transmit_us = esp_timer_get_time() - start_us;
+
+    return ESP_OK;
+}
+
+esp_err_t dled_virtual_destroy(dled_virtual_sink_t *sink) {
+    if (sink == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    if (sink->file != NULL) {
+        fflush(sink->file);
+        ESP_LOGI(LOG_TAG, "Recorded %d frames", sink->frame_count);
+    }
+
+    rmt_dled_destroy(&sink->rps);
+    free(sink->frame);
+
+    return dled_virtual_init(sink);
+}
+
+static esp_err_t dled_virtual_output_send_async(void *backend) {
+    return dled_virtual_record((dled_virtual_sink_t*)backend);
+}
+
+static esp_err_t dled_virtual_output_wait(void *backend, TickType_t wait_time) {
+    return ESP_OK;
+}
+
+static esp_err_t dled_virtual_output_timing(void *backend, dled_output_timing_t *timing) {
+    dled_virtual_sink_t *sink = (dled_virtual_sink_t*)backend;
+
+    *timing = sink->timing;
+    sink->timing.transmit_us = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t dled_virtual_output(dled_virtual_sink_t *sink, dled_output_t *output) {
+    if (sink == NULL || output == NULL) {
+        ESP_LOGE(LOG_TAG, "output: Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    output->name = "virtual";
+    output->backend = sink;
+    output->send_async = dled_virtual_output_send_async;
+    output->wait = dled_virtual_output_wait;
+    output->timing = dled_virtual_output_timing;
+
+    return ESP_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
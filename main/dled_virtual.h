@@ -0,0 +1,136 @@
+#ifndef MAIN_DLED_VIRTUAL_H_
+#define MAIN_DLED_VIRTUAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "dled_strip.h"
+#include "dled_output.h"
+#include "esp32_rmt_dled.h"
+
+/*
+ * Recording format, all numbers are little endian.
+ *
+ * Header, 16 bytes:
+ *     char     magic[4]       "DLED"
+ *     uint8_t  version        DLED_VIRTUAL_VERSION
+ *     uint8_t  flags          DLED_VIRTUAL_FLAG_ITEMS if the frames hold their RMT items
+ *     uint8_t  bytes_per_led
+ *     uint8_t  wire_order[4]  color component sent in every byte of a LED: 0 red, 1 green, 2 blue, 3 white
+ *     uint8_t  reserved
+ *     uint32_t length         number of LEDs
+ *
+ * Then for every frame:
+ *     uint64_t time_us        time since the start of the recording
+ *     uint8_t  data[length * bytes_per_led]  the bytes received by the LEDs, in the order they are sent
+ * and with DLED_VIRTUAL_FLAG_ITEMS:
+ *     uint32_t item_count
+ *     uint32_t items[item_count]             the `rmt_item32_t` sent to the RMT peripheral
+ *
+ * tools/dled_frames.py reads it.
+ */
+
+#define DLED_VIRTUAL_VERSION    1
+#define DLED_VIRTUAL_FLAG_ITEMS 0x01
+
+/**
+ * @brief A strip output recording the frames to a file instead of sending them
+ *
+ * Nothing is sent to the LEDs, so effects and encoders can be timed and checked
+ * without them, on the board or on Linux with the host build (see host/).
+ */
+typedef struct {
+	pixel_strip_t     *strip;        /*!< The strip recorded */
+	FILE              *file;         /*!< Where the frames are written */
+	bool              record_items;  /*!< true if the RMT items are recorded too */
+	rmt_pixel_strip_t rps;           /*!< Encodes the RMT items of the frames, it is never sent */
+	uint8_t           *frame;        /*!< The bytes of the frame, decoded from the RMT items */
+	int64_t           start_us;      /*!< When the recording started */
+	uint32_t          frame_count;   /*!< Number of frames recorded */
+	dled_output_timing_t timing;     /*!< Times of the last frame, writing it counts as its transmission */
+} dled_virtual_sink_t;
+
+/**
+ * @brief Initialize a dled_virtual_sink_t structure.
+ *
+ * @param[in,out] sink The structure to be initialized.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `sink` argument is NULL
+ */
+esp_err_t dled_virtual_init(dled_virtual_sink_t *sink);
+
+/**
+ * @brief Start recording the frames of a strip
+ *
+ * Writes the header of the recording. The time of the frames is counted from here.
+ *
+ * @param[in,out] sink         The structure to work with.
+ * @param[in]     strip        The strip, already created.
+ * @param[in]     file         The file to write to, opened for binary writing. It is not closed by the sink.
+ * @param[in]     record_items true to also record the RMT items of every frame, with the encoder of rmt_dled_create_heap.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ *    - ESP_ERR_NO_MEM if failed to allocate memory for the RMT items
+ *    - ESP_FAIL if the header could not be written
+ *
+ * On error nothing is kept, the sink is as dled_virtual_init left it.
+ */
+esp_err_t dled_virtual_create(dled_virtual_sink_t *sink, pixel_strip_t *strip, FILE *file, bool record_items);
+
+/**
+ * @brief Record the current frame of the strip
+ *
+ * Clears the changes of the strip, like sending it.
+ *
+ * @param[in,out] sink The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `sink` argument is NULL or it is not created
+ *    - ESP_FAIL if the frame could not be written
+ *    - the error codes of dled_strip_fill_buffer and rmt_dled_encode_pixels, if error
+ */
+esp_err_t dled_virtual_record(dled_virtual_sink_t *sink);
+
+/**
+ * @brief Stop recording and free the memory of the sink
+ *
+ * Flushes the file, the caller closes it.
+ *
+ * @param[in,out] sink The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `sink` argument is NULL
+ */
+esp_err_t dled_virtual_destroy(dled_virtual_sink_t *sink);
+
+/**
+ * @brief Set up an output recording the frames with the sink
+ *
+ * dled_output_send_async records the frame, dled_output_wait returns right away
+ * and dled_output_timing gives the times of the last recorded frame.
+ *
+ * @param[in]  sink   The sink, created.
+ * @param[out] output The output to set up.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ */
+esp_err_t dled_virtual_output(dled_virtual_sink_t *sink, dled_output_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,9 +3,15 @@ extern "C" {
 #endif
 
 #include "esp32_rmt_dled.h"
+#include "dled_format.h"
+#include "boot_arena.h"
 
 #include <stdint.h>
+#include <string.h>
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "driver/rmt.h"
 #include "soc/rmt_struct.h"
 #include "driver/gpio.h"
@@ -28,12 +34,101 @@ esp_err_t rmt_dled_init(rmt_pixel_strip_t *rps) {
     //rps->channel = ;
     rps->rmtLO.val = 0; rps->rmtHI.val = 0;
     rps->rmtLR.val = 0; rps->rmtHR.val = 0;
+    rps->ugly_buffers[0] = NULL; rps->ugly_buffers[1] = NULL;
     rps->ugly_buffer = NULL;
+    rps->back = 0;
+    rps->dirty_first[0] = 0; rps->dirty_end[0] = 0;
+    rps->dirty_first[1] = 0; rps->dirty_end[1] = 0;
+    rps->tx_buffer = NULL;
+    rps->item_count = 0;
+    rps->tx_busy = false;
+    rps->tx_start_us = 0;
+    rps->tx_end_us = 0;
+    rps->encode_us = 0;
+    rps->transmit_us = 0;
+    rps->encode_table = NULL;
+    rps->encode = NULL;
+    memset(rps->wire_order, 0, sizeof(rps->wire_order));
+    rps->streaming = false;
+    rps->stream_src = NULL;
+    rps->stream_size = 0;
+    rps->stream_raw = false;
+    rps->stream_hd = false;
+    rps->heap = false;
 
     return ESP_OK;
 }
 
-esp_err_t rmt_dled_create(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
+/* The buffers live until the next reboot, in the boot arena, unless the encoder is made to be destroyed */
+static void *rmt_dled_alloc(const rmt_pixel_strip_t *rps, size_t size) {
+    if (rps->heap) {
+        return heap_caps_calloc(1, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return boot_arena_alloc(size, BOOT_ARENA_INTERNAL);
+}
+
+static void rmt_dled_free(const rmt_pixel_strip_t *rps, void *ptr) {
+    if (rps->heap) {
+        heap_caps_free(ptr);
+    }
+    else {
+        boot_arena_free(ptr);
+    }
+}
+
+/* Every byte value gets its own run of `RMT_DLED_ITEMS_PER_BYTE` items, MSB first,
+* so encoding a byte is a block copy instead of a loop over its bits. */
+void rmt_dled_build_encode_table(rmt_pixel_strip_t *rps) {
+    rmt_item32_t *dst = rps->encode_table;
+
+    for (uint16_t data = 0; data < 256; data++) {
+        uint8_t mask = 0x80;
+        while (mask != 0) {
+            *dst++ = ((data & mask) != 0) ? rps->rmtHI : rps->rmtLO;
+            mask = mask >> 1;
+        }
+    }
+}
+
+static inline __attribute__((always_inline)) rmt_item32_t* rmt_dled_encode_byte(const rmt_item32_t *table, uint8_t data, rmt_item32_t *dst) {
+    memcpy(dst, &table[data * RMT_DLED_ITEMS_PER_BYTE], RMT_DLED_ITEMS_PER_BYTE * sizeof(rmt_item32_t));
+    return dst + RMT_DLED_ITEMS_PER_BYTE;
+}
+
+/* Encodes a range of pixels, specialized for every LED format */
+extern "C++" struct rmt_dled_encoder {
+    typedef rmt_item32_t* (*type)(const pixel_strip_t *strip, const rmt_item32_t *table,
+                                  uint32_t first, uint32_t end, rmt_item32_t *dst);
+
+    template <class Format>
+    static type with() { return &encode<Format>; }
+
+    template <class Format>
+    static rmt_item32_t* encode(const pixel_strip_t *strip, const rmt_item32_t *table,
+                                uint32_t first, uint32_t end, rmt_item32_t *dst) {
+        bool mapped = dled_strip_is_mapped(strip);
+        uint8_t data[Format::bytes_per_led];
+
+        if (strip->hd) {
+            for (uint32_t i = first; i < end; i++) {
+                dled_format_encode16<Format>(strip, i, mapped, data);
+                for (uint8_t b = 0; b < Format::bytes_per_led; b++) {
+                    dst = rmt_dled_encode_byte(table, data[b], dst);
+                }
+            }
+            return dst;
+        }
+        for (uint32_t i = first; i < end; i++) {
+            dled_format_encode<Format>(strip, i, mapped, data);
+            for (uint8_t b = 0; b < Format::bytes_per_led; b++) {
+                dst = rmt_dled_encode_byte(table, data[b], dst);
+            }
+        }
+        return dst;
+    }
+};
+
+esp_err_t rmt_dled_create_items(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
     if (rps == NULL) {
         ESP_LOGE(LOG_TAG, "init: Argument is NULL");
         return ESP_ERR_INVALID_ARG;
@@ -49,16 +144,17 @@ esp_err_t rmt_dled_create(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
 
     rps->strip = strip;
 
-    /* for every pixel are needed `8 * rps->strip->bytes_per_led` bits
-    * for every bit is needed a `rmt_item32_t` */
-    uint32_t req_length = rps->strip->length * 8 * rps->strip->bytes_per_led * sizeof(rmt_item32_t);
-    rps->ugly_buffer = (rmt_item32_t*)malloc(req_length);
-    if (rps->ugly_buffer == NULL){
-        ESP_LOGE(LOG_TAG, "Failed to allocate memory for ugly buffer");
-        return ESP_ERR_NO_MEM;
-    }
-    else {
-        ESP_LOGI(LOG_TAG, "Allocated %d bytes for ugly_buffer", req_length);
+    /* kept by a rmt_dled_create which had no memory for its items */
+    if (rps->encode_table == NULL) {
+        uint32_t req_length = 256 * RMT_DLED_ITEMS_PER_BYTE * sizeof(rmt_item32_t);
+        rps->encode_table = (rmt_item32_t*)rmt_dled_alloc(rps, req_length);
+        if (rps->encode_table == NULL){
+            dled_strip_log_no_mem(LOG_TAG, "encode table", req_length, !rps->heap);
+            return ESP_ERR_NO_MEM;
+        }
+        else {
+            ESP_LOGI(LOG_TAG, "Allocated %d bytes for encode_table", req_length);
+        }
     }
 
     rps->rmtLO.level0 = 1;
@@ -81,9 +177,220 @@ esp_err_t rmt_dled_create(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
     rps->rmtHR.duration0 = strip->T1H / rmt_clk_duration;
     rps->rmtHR.duration1 = strip->TRS / rmt_clk_duration;
 
+    rmt_dled_build_encode_table(rps);
+
+    rps->encode = dled_format_select<rmt_dled_encoder>(strip->type);
+    dled_format_select<dled_format_order>(strip->type)(rps->wire_order);
+
+    return ESP_OK;
+}
+
+/* Creates `count` ugly buffers, 1 or 2 */
+static esp_err_t rmt_dled_create_buffers(rmt_pixel_strip_t *rps, pixel_strip_t *strip, uint8_t count) {
+    esp_err_t ret_val = rmt_dled_create_items(rps, strip);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    rps->streaming = false;
+
+    /* for every pixel are needed `8 * rps->strip->bytes_per_led` bits
+    * for every bit is needed a `rmt_item32_t` */
+    uint32_t req_length = rps->strip->length * 8 * rps->strip->bytes_per_led * sizeof(rmt_item32_t);
+    rps->ugly_buffers[0] = (rmt_item32_t*)rmt_dled_alloc(rps, req_length);
+    if (rps->ugly_buffers[0] == NULL){
+        /* `encode_table` is kept for rmt_dled_create_streaming */
+        dled_strip_log_no_mem(LOG_TAG, "ugly buffer", req_length, !rps->heap);
+        return ESP_ERR_NO_MEM;
+    }
+    else {
+        ESP_LOGI(LOG_TAG, "Allocated %d bytes for ugly_buffer", req_length);
+    }
+
+    /* The second buffer lets a frame be encoded while the previous one is on the wire.
+    * Without it everything still works, encoding just waits for the transmission to end. */
+    rps->ugly_buffers[1] = (count > 1) ? (rmt_item32_t*)rmt_dled_alloc(rps, req_length) : NULL;
+    if (count < 2) {
+        rps->ugly_buffers[1] = rps->ugly_buffers[0];
+    }
+    else if (rps->ugly_buffers[1] == NULL){
+        ESP_LOGW(LOG_TAG, "Failed to allocate memory for second ugly buffer, sending will not overlap encoding");
+        rps->ugly_buffers[1] = rps->ugly_buffers[0];
+    }
+    else {
+        ESP_LOGI(LOG_TAG, "Allocated %d bytes for second ugly_buffer", req_length);
+    }
+    rps->ugly_buffer = rps->ugly_buffers[0];
+    rps->back = 0;
+    for (uint8_t b = 0; b < 2; b++) {
+        rps->dirty_first[b] = 0;
+        rps->dirty_end[b] = strip->length;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_create(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
+    return rmt_dled_create_buffers(rps, strip, 2);
+}
+
+esp_err_t rmt_dled_create_heap(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
+    if (rps == NULL) {
+        ESP_LOGE(LOG_TAG, "init: Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    rps->heap = true;
+    esp_err_t ret_val = rmt_dled_create_buffers(rps, strip, 1);
+    if (ret_val == ESP_ERR_NO_MEM) {
+        /* nothing is kept for rmt_dled_create_streaming, it would take the arena's memory */
+        rmt_dled_destroy(rps);
+    }
+
+    return ret_val;
+}
+
+esp_err_t rmt_dled_create_streaming(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
+    esp_err_t ret_val = rmt_dled_create_items(rps, strip);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    rps->streaming = true;
+
     return ESP_OK;
 }
 
+/* Streaming strips, by channel, for the translators */
+static rmt_pixel_strip_t *rmt_dled_streams[RMT_CHANNEL_MAX];
+
+/* All the configured strips, by channel, for the end of transmission callback */
+static rmt_pixel_strip_t *rmt_dled_channels[RMT_CHANNEL_MAX];
+
+esp_err_t rmt_dled_destroy(rmt_pixel_strip_t *rps) {
+    if (rps == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    rmt_dled_wait(rps, portMAX_DELAY);
+
+    for (uint8_t ch = 0; ch < RMT_CHANNEL_MAX; ch++) {
+        if (rmt_dled_streams[ch] == rps) { rmt_dled_streams[ch] = NULL; }
+        if (rmt_dled_channels[ch] == rps) { rmt_dled_channels[ch] = NULL; }
+    }
+    if (rps->ugly_buffers[1] != rps->ugly_buffers[0]) { rmt_dled_free(rps, rps->ugly_buffers[1]); }
+    rmt_dled_free(rps, rps->ugly_buffers[0]);
+    rmt_dled_free(rps, rps->encode_table);
+
+    return rmt_dled_init(rps);
+}
+
+
+/* The bytes of the LED at `index` as sent, before the output levels. Also used by the translator,
+* which is shared by all the LED types to stay small in IRAM. */
+static inline __attribute__((always_inline)) void rmt_dled_wire_values(const rmt_pixel_strip_t *rps, uint32_t index,
+                                                                       bool mapped, bool hd, uint16_t *wire) {
+    const pixel_strip_t *strip = rps->strip;
+    uint16_t rgbw[4];
+    if (hd) {
+        const pixel16_t *pixel = (const pixel16_t*)dled_strip_pixel_at(strip, strip->pixels16, sizeof(pixel16_t), index, mapped);
+        rgbw[0] = pixel->r; rgbw[1] = pixel->g; rgbw[2] = pixel->b;
+    }
+    else {
+        const pixel_t *pixel = (const pixel_t*)dled_strip_pixel_at(strip, strip->pixels, sizeof(pixel_t), index, mapped);
+        rgbw[0] = pixel->r; rgbw[1] = pixel->g; rgbw[2] = pixel->b;
+    }
+    if (strip->bytes_per_led == 4) {
+        /* same as dled_format_4 */
+        uint16_t w = rgbw[0] < rgbw[1] ? rgbw[0] : rgbw[1];
+        if (rgbw[2] < w) { w = rgbw[2]; }
+        rgbw[0] -= w; rgbw[1] -= w; rgbw[2] -= w; rgbw[3] = w;
+    }
+    for (uint8_t i = 0; i < strip->bytes_per_led; i++) {
+        wire[i] = rgbw[rps->wire_order[i]];
+    }
+}
+
+/* Translates at most `wanted_num / RMT_DLED_ITEMS_PER_BYTE` of the `src_size` bytes of `rps` left to send.
+* The driver passes what is left of the size given to rmt_write_sample, so the bytes already sent are
+* `stream_size - src_size`: `src` itself is never read, it does not point to the bytes sent for pixels. */
+static void IRAM_ATTR rmt_dled_translate(rmt_pixel_strip_t *rps, rmt_item32_t *dest, size_t src_size,
+                                         size_t wanted_num, size_t *translated_size, size_t *item_num) {
+    *translated_size = 0;
+    *item_num = 0;
+    if (rps == NULL || dest == NULL || src_size > rps->stream_size) { return; }
+
+    size_t offset = rps->stream_size - src_size;
+    size_t count = wanted_num / RMT_DLED_ITEMS_PER_BYTE;
+    if (count > src_size) { count = src_size; }
+
+    const rmt_item32_t *table = rps->encode_table;
+    rmt_item32_t *dst = dest;
+
+    if (rps->stream_raw) {
+        const uint8_t *data = rps->stream_src + offset;
+        for (size_t i = 0; i < count; i++) {
+            dst = rmt_dled_encode_byte(table, data[i], dst);
+        }
+    }
+    else {
+        /* `offset` counts bytes in the order they are sent, the pixel and the byte
+        * of the LED are found from it then followed along */
+        pixel_strip_t *strip = rps->strip;
+        bool mapped = dled_strip_is_mapped(strip);
+        bool hd = rps->stream_hd;
+        uint8_t bytes_per_led = strip->bytes_per_led;
+        uint32_t index = offset / bytes_per_led;
+        uint8_t component = offset % bytes_per_led;
+        uint8_t *residual = hd ? strip->residuals + offset : NULL;
+        uint16_t wire[4];
+        rmt_dled_wire_values(rps, index, mapped, hd, wire);
+        for (size_t i = 0; i < count; i++) {
+            uint8_t data = hd ? dled_strip_dither(strip->levels16, residual++, wire[component]) : strip->levels[wire[component]];
+            dst = rmt_dled_encode_byte(table, data, dst);
+            if (++component == bytes_per_led && i + 1 < count) {
+                component = 0;
+                rmt_dled_wire_values(rps, ++index, mapped, hd, wire);
+            }
+        }
+    }
+
+    if (offset + count == rps->stream_size && count > 0) {
+        // change last bit to include reset time
+        rmt_item32_t *last = dst - 1;
+        *last = (last->val == rps->rmtHI.val) ? rps->rmtHR : rps->rmtLR;
+    }
+
+    *translated_size = count;
+    *item_num = dst - dest;
+}
+
+/* The driver does not tell the translator which channel it works for, so every channel has
+* its own, called by the RMT driver from its interrupt handler every time the channel memory
+* needs refilling. */
+#define RMT_DLED_TRANSLATOR(ch) \
+    static void IRAM_ATTR rmt_dled_translate_##ch(const void *src, rmt_item32_t *dest, size_t src_size, \
+                                                  size_t wanted_num, size_t *translated_size, size_t *item_num) { \
+        rmt_dled_translate(rmt_dled_streams[ch], dest, src_size, wanted_num, translated_size, item_num); \
+    }
+
+RMT_DLED_TRANSLATOR(0)
+RMT_DLED_TRANSLATOR(1)
+RMT_DLED_TRANSLATOR(2)
+RMT_DLED_TRANSLATOR(3)
+RMT_DLED_TRANSLATOR(4)
+RMT_DLED_TRANSLATOR(5)
+RMT_DLED_TRANSLATOR(6)
+RMT_DLED_TRANSLATOR(7)
+
+static const sample_to_rmt_t rmt_dled_translators[] = {
+    rmt_dled_translate_0, rmt_dled_translate_1, rmt_dled_translate_2, rmt_dled_translate_3,
+    rmt_dled_translate_4, rmt_dled_translate_5, rmt_dled_translate_6, rmt_dled_translate_7,
+};
+
+/* Called by the RMT driver, from its interrupt handler, at the end of every transmission.
+* Only 32 bits of the time are kept so the write can not be torn. */
+static void IRAM_ATTR rmt_dled_tx_end(rmt_channel_t channel, void *arg) {
+    rmt_pixel_strip_t *rps = rmt_dled_channels[channel];
+    if (rps != NULL) {
+        rps->tx_end_us = (uint32_t)esp_timer_get_time();
+    }
+}
+
 void rmt_dled_set_gpio(rmt_pixel_strip_t *rps) {
     gpio_pad_select_gpio(rps->gpio_number);
     gpio_set_direction(  rps->gpio_number, GPIO_MODE_OUTPUT);
@@ -164,66 +471,334 @@ esp_err_t rmt_dled_config(rmt_pixel_strip_t *rps, gpio_num_t gpio_number_in, rmt
         return ret_val;
     }
 
+    if (rps->streaming) {
+        if (rps->channel >= sizeof(rmt_dled_translators) / sizeof(rmt_dled_translators[0])) {
+            ESP_LOGE(LOG_TAG, "No translator for channel %d", rps->channel);
+            return ESP_ERR_INVALID_ARG;
+        }
+        ret_val = rmt_translator_init(rps->channel, rmt_dled_translators[rps->channel]);
+        if(ret_val != ESP_OK) {
+            ESP_LOGE(LOG_TAG, "[0x%x] rmt_translator_init failed", ret_val);
+            return ret_val;
+        }
+        rmt_dled_streams[rps->channel] = rps;
+    }
+
+    /* there is a single callback for all the channels */
+    rmt_register_tx_end_callback(rmt_dled_tx_end, NULL);
+    rmt_dled_channels[rps->channel] = rps;
+
     return ESP_OK;
 }
 
-void rmt_dled_byte_to_rmtitem(rmt_pixel_strip_t *rps, uint8_t data, uint16_t idx_in) {
-    uint8_t mask = 0x80;
-    uint16_t idx = idx_in;
-
-    while (mask != 0){
-        rps->ugly_buffer[idx++] =
-            ((data & mask) != 0) ? rps->rmtHI : rps->rmtLO;
-        mask = mask >> 1;
-    }
+void rmt_dled_byte_to_rmtitem(rmt_pixel_strip_t *rps, uint8_t data, uint32_t idx) {
+    memcpy(&rps->ugly_buffer[idx],
+           &rps->encode_table[data * RMT_DLED_ITEMS_PER_BYTE],
+           RMT_DLED_ITEMS_PER_BYTE * sizeof(rmt_item32_t));
 }
 
-esp_err_t rmt_dled_send(rmt_pixel_strip_t *rps) {
+esp_err_t rmt_dled_check(rmt_pixel_strip_t *rps) {
     if (rps == NULL) {
         ESP_LOGE(LOG_TAG, "argument is NULL");
         return ESP_ERR_INVALID_ARG;
     }
-    if (rps->ugly_buffer == NULL) {
+    if (rps->ugly_buffer == NULL && !rps->streaming) {
         ESP_LOGE(LOG_TAG, "ugly buffer is NULL");
         return ESP_ERR_INVALID_ARG;
     }
-    if (rps->strip == NULL) {
-        ESP_LOGE(LOG_TAG, "buffer is NULL");
+    if (rps->encode_table == NULL) {
+        ESP_LOGE(LOG_TAG, "encode table is NULL");
         return ESP_ERR_INVALID_ARG;
     }
-    if (rps->strip->buffer == NULL) {
-        ESP_LOGE(LOG_TAG, "buffer is NULL");
+    if (rps->strip == NULL) {
+        ESP_LOGE(LOG_TAG, "strip is NULL");
         return ESP_ERR_INVALID_ARG;
     }
-    if (rps->strip->buffer_length == 0) {
-        ESP_LOGE(LOG_TAG, "buffer length is 0");
-        return ESP_ERR_INVALID_ARG;
+
+    return ESP_OK;
+}
+
+void rmt_dled_add_dirty(rmt_pixel_strip_t *rps, uint8_t b, uint32_t first, uint32_t end) {
+    if (rps->dirty_first[b] >= rps->dirty_end[b]) {
+        rps->dirty_first[b] = first;
+        rps->dirty_end[b] = end;
+        return;
     }
+    if (first < rps->dirty_first[b]) rps->dirty_first[b] = first;
+    if (end > rps->dirty_end[b]) rps->dirty_end[b] = end;
+}
 
-    uint16_t didx = 0;
-    for (uint16_t i = 0; i < rps->strip->buffer_length; i++) {
-        rmt_dled_byte_to_rmtitem(rps, rps->strip->buffer[i], didx);
-        didx += 8;
+/* With only one ugly buffer the buffer to encode into may still be on the wire */
+esp_err_t rmt_dled_claim_buffer(rmt_pixel_strip_t *rps) {
+    if (rps->tx_busy && rps->tx_buffer == rps->ugly_buffer) {
+        return rmt_dled_wait(rps, portMAX_DELAY);
     }
 
+    return ESP_OK;
+}
+
+void rmt_dled_set_reset_item(rmt_pixel_strip_t *rps) {
     // change last bit to include reset time
-    didx--;
-    if (rps->ugly_buffer[didx].val == rps->rmtHI.val) {
+    uint32_t didx = rps->item_count - 1;
+    if (rps->ugly_buffer[didx].val == rps->rmtHI.val || rps->ugly_buffer[didx].val == rps->rmtHR.val) {
         rps->ugly_buffer[didx] = rps->rmtHR;
     }
     else {
         rps->ugly_buffer[didx] = rps->rmtLR;
     }
+}
+
+/* The dithering changes the output of every frame so all the pixels are encoded */
+void rmt_dled_encode_pixels16(rmt_pixel_strip_t *rps) {
+    rps->encode(rps->strip, rps->encode_table, 0, rps->strip->length, rps->ugly_buffer);
+
+    pixel_strip_t *strip = rps->strip;
+    /* the buffers do not hold `pixels` any more */
+    for (uint8_t b = 0; b < 2; b++) {
+        rmt_dled_add_dirty(rps, b, 0, strip->length);
+    }
+    rmt_dled_set_reset_item(rps);
+}
+
+/* Only the pixels changed since this ugly buffer was last encoded */
+void rmt_dled_encode_dirty(rmt_pixel_strip_t *rps) {
+    pixel_strip_t *strip = rps->strip;
+    uint32_t first = rps->dirty_first[rps->back];
+    uint32_t end   = rps->dirty_end[rps->back];
+    if (first >= end) { return; }
+
+    rps->encode(strip, rps->encode_table, first, end,
+                rps->ugly_buffer + first * strip->bytes_per_led * RMT_DLED_ITEMS_PER_BYTE);
 
-    esp_err_t ret_val = rmt_write_items(rps->channel, rps->ugly_buffer, rps->strip->buffer_length * 8, true);
+    rps->dirty_first[rps->back] = 0;
+    rps->dirty_end[rps->back] = 0;
+    if (end == strip->length) {
+        rmt_dled_set_reset_item(rps);
+    }
+}
+
+esp_err_t rmt_dled_encode_pixels(rmt_pixel_strip_t *rps) {
+    esp_err_t ret_val = rmt_dled_check(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    if (rps->strip->pixels == NULL) {
+        ESP_LOGE(LOG_TAG, "pixels are NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (rps->strip->length == 0) {
+        ESP_LOGE(LOG_TAG, "strip length is 0");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (rps->streaming) {
+        /* nothing to encode now, the translator does it while sending */
+        ret_val = rmt_dled_wait(rps, portMAX_DELAY);
+        if (ret_val != ESP_OK) { return ret_val; }
+
+        rps->encode_us = 0;
+        dled_strip_clear_dirty(rps->strip);
+        /* The translator of the channel reads the pixels of the strip, it only counts the
+        * bytes of `stream_src`: they are not the bytes sent and never read. */
+        rps->stream_src = (const uint8_t*)rps->strip->pixels;
+        rps->stream_size = rps->strip->length * rps->strip->bytes_per_led;
+        rps->stream_raw = false;
+        rps->stream_hd = rps->strip->hd;
+        rps->item_count = rps->stream_size * RMT_DLED_ITEMS_PER_BYTE;
+        return ESP_OK;
+    }
+
+    ret_val = rmt_dled_claim_buffer(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    int64_t start_us = esp_timer_get_time();
+
+    /* Every ugly buffer keeps the frame it was last encoded with so the changes
+    * are recorded for both and only the changed pixels are encoded again. */
+    pixel_strip_t *strip = rps->strip;
+    bool mapped = dled_strip_is_mapped(strip);
+    if (strip->dirty_first < strip->dirty_end) {
+        /* with transformations a changed pixel may be shown anywhere */
+        uint32_t first = mapped ? 0 : strip->dirty_first;
+        uint32_t end   = mapped ? strip->length : strip->dirty_end;
+        for (uint8_t b = 0; b < 2; b++) {
+            rmt_dled_add_dirty(rps, b, first, end);
+        }
+        dled_strip_clear_dirty(strip);
+    }
+
+    rps->item_count = strip->length * strip->bytes_per_led * RMT_DLED_ITEMS_PER_BYTE;
+    if (strip->hd) {
+        rmt_dled_encode_pixels16(rps);
+    }
+    else {
+        rmt_dled_encode_dirty(rps);
+    }
+    rps->encode_us = esp_timer_get_time() - start_us;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_start(rmt_pixel_strip_t *rps) {
+    esp_err_t ret_val = rmt_dled_check(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    if (rps->item_count == 0) {
+        ESP_LOGE(LOG_TAG, "nothing encoded");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ret_val = rmt_dled_wait(rps, portMAX_DELAY);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    rps->tx_start_us = (uint32_t)esp_timer_get_time();
+    if (rps->streaming) {
+        /* The translator reads the source while sending, it must not change until rmt_dled_wait */
+        ret_val = rmt_write_sample(rps->channel, rps->stream_src, rps->stream_size, false);
+        if(ret_val != ESP_OK) {
+            ESP_LOGE(LOG_TAG, "[0x%x] rmt_write_sample failed", ret_val);
+            return ret_val;
+        }
+        rps->tx_busy = true;
+        rps->tx_buffer = NULL;
+        return ESP_OK;
+    }
+
+    ret_val = rmt_write_items(rps->channel, rps->ugly_buffer, rps->item_count, false);
     if(ret_val != ESP_OK) {
         ESP_LOGE(LOG_TAG, "[0x%x] rmt_write_items failed", ret_val);
         return ret_val;
     }
 
+    rps->tx_busy = true;
+    rps->tx_buffer = rps->ugly_buffer;
+    rps->back = 1 - rps->back;
+    rps->ugly_buffer = rps->ugly_buffers[rps->back];
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_wait(rmt_pixel_strip_t *rps, TickType_t wait_time) {
+    if (rps == NULL) {
+        ESP_LOGE(LOG_TAG, "argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!rps->tx_busy) { return ESP_OK; }
+
+    esp_err_t ret_val = rmt_wait_tx_done(rps->channel, wait_time);
+    if (ret_val == ESP_ERR_TIMEOUT) { return ret_val; }
+    if (ret_val != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "[0x%x] rmt_wait_tx_done failed", ret_val);
+        return ret_val;
+    }
+
+    rps->tx_busy = false;
+    /* The driver may wake this task before calling the end of transmission callback */
+    uint32_t end_us = rps->tx_end_us;
+    if ((int32_t)(end_us - rps->tx_start_us) < 0) {
+        end_us = (uint32_t)esp_timer_get_time();
+    }
+    rps->transmit_us = end_us - rps->tx_start_us;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_check_buffer(rmt_pixel_strip_t *rps) {
+    esp_err_t ret_val = rmt_dled_check(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    if (rps->strip->buffer == NULL) {
+        ESP_LOGE(LOG_TAG, "buffer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (rps->strip->buffer_length == 0) {
+        ESP_LOGE(LOG_TAG, "buffer length is 0");
+        return ESP_ERR_INVALID_ARG;
+    }
+
     return ESP_OK;
 }
 
+esp_err_t rmt_dled_encode_buffer(rmt_pixel_strip_t *rps) {
+    esp_err_t ret_val = rmt_dled_check_buffer(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    if (rps->streaming) {
+        ESP_LOGE(LOG_TAG, "streaming strips have no ugly buffer");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ret_val = rmt_dled_claim_buffer(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    int64_t start_us = esp_timer_get_time();
+    uint32_t didx = 0;
+    for (uint32_t i = 0; i < rps->strip->buffer_length; i++) {
+        rmt_dled_byte_to_rmtitem(rps, rps->strip->buffer[i], didx);
+        didx += RMT_DLED_ITEMS_PER_BYTE;
+    }
+
+    rps->item_count = didx;
+    rmt_dled_set_reset_item(rps);
+
+    /* this buffer no longer holds the encoded pixels */
+    rps->dirty_first[rps->back] = 0;
+    rps->dirty_end[rps->back] = rps->strip->length;
+    rps->encode_us = esp_timer_get_time() - start_us;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_send(rmt_pixel_strip_t *rps) {
+    esp_err_t ret_val = rmt_dled_check_buffer(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    if (rps->streaming) {
+        ret_val = rmt_dled_wait(rps, portMAX_DELAY);
+        if (ret_val != ESP_OK) { return ret_val; }
+
+        rps->stream_src = rps->strip->buffer;
+        rps->stream_size = rps->strip->buffer_length;
+        rps->stream_raw = true;
+        rps->stream_hd = false;
+        rps->item_count = rps->stream_size * RMT_DLED_ITEMS_PER_BYTE;
+        ret_val = rmt_dled_start(rps);
+        if (ret_val != ESP_OK) { return ret_val; }
+
+        return rmt_dled_wait(rps, portMAX_DELAY);
+    }
+
+    ret_val = rmt_dled_encode_buffer(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    ret_val = rmt_dled_start(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    return rmt_dled_wait(rps, portMAX_DELAY);
+}
+
+esp_err_t rmt_dled_send_pixels_async(rmt_pixel_strip_t *rps) {
+    esp_err_t ret_val = rmt_dled_encode_pixels(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    ret_val = rmt_dled_start(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    /* streamed pixels are read while sending, the caller would change the frame on the wire */
+    if (rps->streaming) {
+        return rmt_dled_wait(rps, portMAX_DELAY);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_send_pixels(rmt_pixel_strip_t *rps) {
+    esp_err_t ret_val = rmt_dled_send_pixels_async(rps);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    return rmt_dled_wait(rps, portMAX_DELAY);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,6 +11,11 @@ extern "C" {
 
 #include "dled_strip.h"
 
+/**
+ * @brief Number of `rmt_item32_t` needed to send one byte, one item for every bit.
+ */
+#define RMT_DLED_ITEMS_PER_BYTE 8
+
 /**
  * @brief Structure to control a LED strip using the RMT peripheral
  *
@@ -23,7 +28,31 @@ typedef struct {
 	rmt_item32_t  rmtLO, rmtHI; /*!< Values required to send 0 and 1 */
     rmt_item32_t  rmtLR, rmtHR; /*!< Values required to send 0 and 1 including reset */
 
-	rmt_item32_t  *ugly_buffer; /*!< The buffer to be passed to the RMT driver for sending */
+	rmt_item32_t  *ugly_buffers[2];   /*!< The ping-pong buffers passed to the RMT driver, may be the same buffer */
+	rmt_item32_t  *ugly_buffer;       /*!< The buffer the next frame is encoded into */
+	uint8_t       back;               /*!< Index in `ugly_buffers` of `ugly_buffer` */
+	uint32_t      dirty_first[2];     /*!< For every ugly buffer, first pixel to encode again */
+	uint32_t      dirty_end[2];       /*!< For every ugly buffer, one past the last pixel to encode again */
+	const rmt_item32_t *tx_buffer;    /*!< The buffer of the last started transmission */
+	uint32_t      item_count;         /*!< Number of items encoded in `ugly_buffer` */
+	bool          tx_busy;            /*!< true until the end of the last started transmission is seen */
+	uint32_t      tx_start_us;        /*!< When the last transmission was started, low bits of esp_timer_get_time */
+	volatile uint32_t tx_end_us;      /*!< When the RMT driver reported its end, set from the interrupt */
+	uint32_t      encode_us;          /*!< Time taken by the last encoding, in microseconds */
+	uint32_t      transmit_us;        /*!< Time taken by the last completed transmission, in microseconds */
+
+	rmt_item32_t  *encode_table; /*!< `RMT_DLED_ITEMS_PER_BYTE` precomputed items for every byte value */
+	rmt_item32_t* (*encode)(const pixel_strip_t *strip, const rmt_item32_t *table,
+	                        uint32_t first, uint32_t end, rmt_item32_t *dst); /*!< Encodes the pixels `first` to `end`, specialized for the LED type */
+	uint8_t       wire_order[4];  /*!< Color component sent in every byte of a LED, for the translator */
+
+	bool          streaming;    /*!< true if the items are translated while sending, without ugly buffers */
+	const uint8_t *stream_src;  /*!< Given to rmt_write_sample when streaming, the bytes sent if `stream_raw` */
+	uint32_t      stream_size;  /*!< Number of bytes sent when streaming */
+	bool          stream_raw;   /*!< true if `stream_src` is already in the order of the LEDs */
+	bool          stream_hd;    /*!< true if the high precision pixels of the strip are sent */
+
+	bool          heap;         /*!< true if the buffers come from the heap, see rmt_dled_create_heap */
 } rmt_pixel_strip_t;
 
 /**
@@ -41,7 +70,8 @@ esp_err_t rmt_dled_init(rmt_pixel_strip_t *rps);
  * @brief Creates the buffer and set the `rmt_item32_t` members of a rmt_pixel_strip_t structure.
  *
  * Creates the buffer to be passed to the RMT driver for sending.
- * Based on `strip` sets rmtLO, rmtHI, rmtLR and rmtHR members.
+ * Based on `strip` sets rmtLO, rmtHI, rmtLR and rmtHR members and builds
+ * `encode_table`, the 256 entries table used to translate bytes to RMT items.
  *
  * @param[in,out] rps   The structure to work with.
  * @param[in]     strip The strip of pixels.
@@ -50,16 +80,73 @@ esp_err_t rmt_dled_init(rmt_pixel_strip_t *rps);
  *    - ESP_OK success
  *    - ESP_ERR_INVALID_ARG if the `rps` or `strip` arguments are NULL
  *    - ESP_ERR_INVALID_SIZE if `strip->length` is zero
- *    - ESP_ERR_NO_MEM if failed to allocate memory for buffer
+ *    - ESP_ERR_NO_MEM if failed to allocate memory for buffer or encode table. The encode
+ *      table is kept for rmt_dled_create_streaming.
  */
 esp_err_t rmt_dled_create(rmt_pixel_strip_t *rps, pixel_strip_t *strip);
 
+/**
+ * @brief Like rmt_dled_create, for an encoder created and destroyed while running.
+ *
+ * The encode table and a single ugly buffer are taken from the heap instead of the boot
+ * arena, so rmt_dled_destroy gives them back. Encoding waits for the end of the
+ * transmission, if the items are sent at all: the recordings of dled_virtual only read them.
+ *
+ * @param[in,out] rps   The structure to work with.
+ * @param[in]     strip The strip of pixels.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - the error codes of rmt_dled_create, if error. Nothing is kept on ESP_ERR_NO_MEM.
+ */
+esp_err_t rmt_dled_create_heap(rmt_pixel_strip_t *rps, pixel_strip_t *strip);
+
+/**
+ * @brief Set the `rmt_item32_t` members of a rmt_pixel_strip_t structure for streaming.
+ *
+ * Like rmt_dled_create but no ugly buffer is created. The bytes to send are translated
+ * to RMT items by the RMT driver's interrupt handler, a few at a time, as the channel
+ * memory empties. The memory used does not depend on the length of the strip.
+ *
+ * rmt_dled_send_pixels_async waits for the end of transmission in this mode because the
+ * pixels are read while they are sent. rmt_dled_start does not, so several strips can be
+ * started before waiting for all of them.
+ *
+ * @param[in,out] rps   The structure to work with.
+ * @param[in]     strip The strip of pixels.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `rps` or `strip` arguments are NULL
+ *    - ESP_ERR_INVALID_SIZE if `strip->length` is zero
+ *    - ESP_ERR_NO_MEM if failed to allocate memory for the encode table
+ */
+esp_err_t rmt_dled_create_streaming(rmt_pixel_strip_t *rps, pixel_strip_t *strip);
+
+/**
+ * @brief Free the buffers of a rmt_pixel_strip_t structure.
+ *
+ * Waits for the end of the transmission first. The RMT driver stays installed.
+ *
+ * @attention Except for rmt_dled_create_heap, the buffers are taken from the boot arena
+ * (see boot_arena_alloc), which keeps them until the next reboot: a strip is created once
+ * at boot, destroying and creating it again leaks the ugly buffers and the encode table every time.
+ *
+ * @param[in,out] rps The structure to work with, initialized again.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `rps` argument is NULL
+ */
+esp_err_t rmt_dled_destroy(rmt_pixel_strip_t *rps);
+
 /**
  * @brief Configures the RMT peripheral
  *
  * Configures the GPIO `gpio_number`
  * Configure the RMT peripheral using the RMT driver.
  * Sets `gpio_number` and `channel` members.
+ * For streaming strips installs the translator of the RMT driver.
  *
  * @param[in,out] rps         The structure to work with.
  * @param[in]     gpio_number The number of GPIO connected to the LED strip.
@@ -78,6 +165,8 @@ esp_err_t rmt_dled_config(rmt_pixel_strip_t *rps, gpio_num_t gpio_number, rmt_ch
  * @attention: Call dled_strip_fill_buffer(rps->strip) before calling this function
  * because it will transfer data from strip->pixels to strip->buffer !
  *
+ * Kept for compatibility, rmt_dled_send_pixels does the same work in a single pass.
+ *
  * @param[in,out] rps The structure to work with.
  *
  * @return
@@ -89,6 +178,108 @@ esp_err_t rmt_dled_config(rmt_pixel_strip_t *rps, gpio_num_t gpio_number, rmt_ch
  */
 esp_err_t rmt_dled_send(rmt_pixel_strip_t *rps);
 
+/**
+ * @brief Encode the strip's output buffer into the free ugly buffer
+ *
+ * The encoding of rmt_dled_send, nothing is sent. Call rmt_dled_start for that.
+ *
+ * @param[in,out] rps The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `rps` argument is NULL
+ *    - ESP_ERR_INVALID_ARG if `rps->strip` or a buffer is NULL
+ *    - ESP_ERR_INVALID_ARG if the strip's output buffer length is zero
+ *    - ESP_ERR_INVALID_STATE if the strip is streaming, it has no ugly buffer
+ */
+esp_err_t rmt_dled_encode_buffer(rmt_pixel_strip_t *rps);
+
+/**
+ * @brief Encode the strip's pixels and send them to RMT driver
+ *
+ * Reads `strip->pixels` and writes the RMT items directly, applying the color order
+ * and the number of bytes of the LED type on the way. `strip->buffer` is not used so dled_strip_fill_buffer
+ * does not need to be called.
+ *
+ * Only the pixels marked as changed (see dled_strip_mark_dirty) are encoded, the
+ * RMT items of the others are kept from the previous frames. If the strip sends its
+ * high precision pixels (see dled_strip_set_hd) all of them are dithered and encoded.
+ *
+ * @param[in,out] rps The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `rps` argument is NULL
+ *    - ESP_ERR_INVALID_ARG if `rps->strip`, its pixels or a buffer is NULL
+ *    - ESP_ERR_INVALID_ARG if the strip's length is zero
+ *    - the error codes returned by the RMT driver, if error
+ */
+esp_err_t rmt_dled_send_pixels(rmt_pixel_strip_t *rps);
+
+/**
+ * @brief Encode the strip's pixels into the free ugly buffer
+ *
+ * Same encoding as rmt_dled_send_pixels but nothing is sent, call rmt_dled_start for that.
+ * While a transmission is running the other ugly buffer is used so the encoding
+ * does not wait. If there is only one ugly buffer this waits for the transmission to end.
+ *
+ * @param[in,out] rps The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - the error codes of rmt_dled_send_pixels, if error
+ */
+esp_err_t rmt_dled_encode_pixels(rmt_pixel_strip_t *rps);
+
+/**
+ * @brief Start sending the last encoded frame without waiting for it to end
+ *
+ * Waits for the previous transmission to end, starts the new one then swaps the ugly buffers.
+ * The caller may change the pixels right away, the frame on the wire is not affected.
+ * A streaming strip reads the pixels while sending, call rmt_dled_wait before changing them.
+ *
+ * @param[in,out] rps The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `rps` argument or its buffers are NULL
+ *    - ESP_ERR_INVALID_STATE if nothing was encoded
+ *    - the error codes returned by the RMT driver, if error
+ */
+esp_err_t rmt_dled_start(rmt_pixel_strip_t *rps);
+
+/**
+ * @brief Encode the strip's pixels and start sending them, without waiting for the end
+ *
+ * Calls rmt_dled_encode_pixels then rmt_dled_start. Encoding frame N+1 overlaps the
+ * transmission of frame N, the wait is done only when the next transmission is started.
+ * A streaming strip waits for the end of the transmission before returning.
+ *
+ * @param[in,out] rps The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - the error codes of rmt_dled_encode_pixels and rmt_dled_start, if error
+ */
+esp_err_t rmt_dled_send_pixels_async(rmt_pixel_strip_t *rps);
+
+/**
+ * @brief Wait for the end of the last started transmission
+ *
+ * Sets `transmit_us` to the time the transmission took, from rmt_dled_start to the end
+ * of transmission interrupt of the RMT driver.
+ *
+ * @param[in,out] rps       The structure to work with.
+ * @param[in]     wait_time Maximum time to wait, in ticks.
+ *
+ * @return
+ *    - ESP_OK success, nothing is being sent
+ *    - ESP_ERR_INVALID_ARG if the `rps` argument is NULL
+ *    - ESP_ERR_TIMEOUT if the transmission did not end in `wait_time`
+ *    - the error codes returned by the RMT driver, if error
+ */
+esp_err_t rmt_dled_wait(rmt_pixel_strip_t *rps, TickType_t wait_time);
+
 #ifdef __cplusplus
 }
 #endif
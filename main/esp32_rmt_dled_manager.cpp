@@ -0,0 +1,189 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp32_rmt_dled_manager.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *LOG_TAG  = "rmt_dled_manager";
+
+esp_err_t rmt_dled_manager_init(rmt_dled_manager_t *manager, pixel_strip_t *strip) {
+    if (manager == NULL || strip == NULL) {
+        ESP_LOGE(LOG_TAG, "init: Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    manager->strip = strip;
+    manager->count = 0;
+    manager->fill_us = 0;
+    for (uint8_t i = 0; i < RMT_DLED_MANAGER_MAX_SEGMENTS; i++) {
+        dled_strip_init(&manager->segments[i].view);
+        rmt_dled_init(&manager->segments[i].rps);
+        manager->segments[i].changed = false;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_manager_add_segment(rmt_dled_manager_t *manager, uint32_t first, uint32_t length,
+                                       gpio_num_t gpio_number, bool streaming) {
+    if (manager == NULL || manager->strip == NULL) {
+        ESP_LOGE(LOG_TAG, "Argument is NULL or not initialized");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (manager->count >= RMT_DLED_MANAGER_MAX_SEGMENTS) {
+        ESP_LOGE(LOG_TAG, "No RMT channel left for the segment");
+        return ESP_ERR_NO_MEM;
+    }
+
+    rmt_dled_segment_t *segment = &manager->segments[manager->count];
+    esp_err_t ret_val;
+
+    ret_val = dled_strip_create_view(&segment->view, manager->strip, first, length);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    if (streaming) {
+        ret_val = rmt_dled_create_streaming(&segment->rps, &segment->view);
+    }
+    else {
+        ret_val = rmt_dled_create(&segment->rps, &segment->view);
+        /* the items of a whole frame take 24 or 32 words per LED, long segments are translated while sent */
+        if (ret_val == ESP_ERR_NO_MEM) {
+            ESP_LOGW(LOG_TAG, "No memory to encode %d pixels in advance, they are streamed", length);
+            ret_val = rmt_dled_create_streaming(&segment->rps, &segment->view);
+        }
+    }
+    if (ret_val != ESP_OK) {
+        dled_strip_init(&segment->view);
+        return ret_val;
+    }
+
+    ret_val = rmt_dled_config(&segment->rps, gpio_number, (rmt_channel_t)manager->count);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    ESP_LOGI(LOG_TAG, "Segment %d: %d pixels at %d on GPIO %d", manager->count, length, first, gpio_number);
+    manager->count++;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_manager_send_async(rmt_dled_manager_t *manager) {
+    if (manager == NULL) {
+        ESP_LOGE(LOG_TAG, "argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret_val;
+    bool streaming = false;
+
+    int64_t start_us = esp_timer_get_time();
+    for (uint8_t i = 0; i < manager->count; i++) {
+        rmt_dled_segment_t *segment = &manager->segments[i];
+        segment->changed = dled_strip_sync_view(&segment->view);
+    }
+    manager->fill_us = esp_timer_get_time() - start_us;
+
+    /* Encoding everything before starting anything keeps the segments in step */
+    for (uint8_t i = 0; i < manager->count; i++) {
+        rmt_dled_segment_t *segment = &manager->segments[i];
+        if (!segment->changed) { continue; }
+
+        ret_val = rmt_dled_encode_pixels(&segment->rps);
+        if (ret_val != ESP_OK) { return ret_val; }
+    }
+    dled_strip_clear_dirty(manager->strip);
+
+    for (uint8_t i = 0; i < manager->count; i++) {
+        rmt_dled_segment_t *segment = &manager->segments[i];
+        if (!segment->changed) { continue; }
+
+        ret_val = rmt_dled_start(&segment->rps);
+        if (ret_val != ESP_OK) { return ret_val; }
+        streaming |= segment->rps.streaming;
+    }
+
+    /* streamed pixels are read while sending, the caller would change the frame on the wire */
+    if (streaming) {
+        return rmt_dled_manager_wait(manager, portMAX_DELAY);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_manager_wait(rmt_dled_manager_t *manager, TickType_t wait_time) {
+    if (manager == NULL) {
+        ESP_LOGE(LOG_TAG, "argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t i = 0; i < manager->count; i++) {
+        esp_err_t ret_val = rmt_dled_wait(&manager->segments[i].rps, wait_time);
+        if (ret_val != ESP_OK) { return ret_val; }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_dled_manager_send(rmt_dled_manager_t *manager) {
+    esp_err_t ret_val = rmt_dled_manager_send_async(manager);
+    if (ret_val != ESP_OK) { return ret_val; }
+
+    return rmt_dled_manager_wait(manager, portMAX_DELAY);
+}
+
+static esp_err_t rmt_dled_manager_output_send_async(void *backend) {
+    return rmt_dled_manager_send_async((rmt_dled_manager_t*)backend);
+}
+
+static esp_err_t rmt_dled_manager_output_wait(void *backend, TickType_t wait_time) {
+    return rmt_dled_manager_wait((rmt_dled_manager_t*)backend, wait_time);
+}
+
+esp_err_t rmt_dled_manager_timing(rmt_dled_manager_t *manager, dled_output_timing_t *timing) {
+    if (manager == NULL || timing == NULL) {
+        ESP_LOGE(LOG_TAG, "timing: Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* the segments are encoded one after the other but sent at the same time */
+    timing->fill_us = manager->fill_us;
+    timing->encode_us = 0;
+    timing->transmit_us = 0;
+    for (uint8_t i = 0; i < manager->count; i++) {
+        rmt_pixel_strip_t *rps = &manager->segments[i].rps;
+        if (manager->segments[i].changed) {
+            timing->encode_us += rps->encode_us;
+        }
+        if (rps->transmit_us > timing->transmit_us) {
+            timing->transmit_us = rps->transmit_us;
+        }
+        rps->transmit_us = 0;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t rmt_dled_manager_output_timing(void *backend, dled_output_timing_t *timing) {
+    return rmt_dled_manager_timing((rmt_dled_manager_t*)backend, timing);
+}
+
+esp_err_t rmt_dled_manager_output(rmt_dled_manager_t *manager, dled_output_t *output) {
+    if (manager == NULL || output == NULL) {
+        ESP_LOGE(LOG_TAG, "output: Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    output->name = "rmt";
+    output->backend = manager;
+    output->send_async = rmt_dled_manager_output_send_async;
+    output->wait = rmt_dled_manager_output_wait;
+    output->timing = rmt_dled_manager_output_timing;
+
+    return ESP_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
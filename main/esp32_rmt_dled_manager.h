@@ -0,0 +1,154 @@
+#ifndef MAIN_ESP32_RMT_DLED_MANAGER_H_
+#define MAIN_ESP32_RMT_DLED_MANAGER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/rmt.h"
+
+#include "dled_strip.h"
+#include "dled_output.h"
+#include "esp32_rmt_dled.h"
+
+/**
+ * @brief Maximum number of segments, one for every RMT channel.
+ */
+#define RMT_DLED_MANAGER_MAX_SEGMENTS RMT_CHANNEL_MAX
+
+/**
+ * @brief A part of the logical strip sent on its own RMT channel and GPIO
+ *
+ */
+typedef struct {
+	pixel_strip_t     view;     /*!< The pixels of the segment, a view of the logical strip */
+	rmt_pixel_strip_t rps;      /*!< The output of the segment */
+	bool              changed;  /*!< true if the segment is sent with the current frame */
+} rmt_dled_segment_t;
+
+/**
+ * @brief Structure to send one logical strip over several RMT channels at the same time
+ *
+ * The effects work on the logical strip, every segment sends a part of it. All the
+ * segments are encoded first then all the transmissions are started, so the time
+ * needed to send a frame is the time of the longest segment, not of the whole strip.
+ */
+typedef struct {
+	pixel_strip_t      *strip;   /*!< The logical strip */
+	rmt_dled_segment_t segments[RMT_DLED_MANAGER_MAX_SEGMENTS]; /*!< The segments, segment `n` uses RMT channel `n` */
+	uint8_t            count;    /*!< Number of segments */
+	uint32_t           fill_us;  /*!< Time taken by syncing the views of the segments with the last frame */
+} rmt_dled_manager_t;
+
+/**
+ * @brief Initialize a rmt_dled_manager_t structure.
+ *
+ * @param[in,out] manager The structure to be initialized.
+ * @param[in]     strip   The logical strip, already created.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ */
+esp_err_t rmt_dled_manager_init(rmt_dled_manager_t *manager, pixel_strip_t *strip);
+
+/**
+ * @brief Add a segment sending a part of the logical strip
+ *
+ * The segment uses the next free RMT channel. Creates its view and its RMT output
+ * (rmt_dled_create or rmt_dled_create_streaming) then configures the RMT peripheral.
+ * A segment too long for the memory left is streamed even if `streaming` is false.
+ *
+ * @param[in,out] manager     The structure to work with.
+ * @param[in]     first       Index in the logical strip of the first pixel of the segment.
+ * @param[in]     length      Number of pixels of the segment.
+ * @param[in]     gpio_number The number of GPIO connected to the segment's LEDs.
+ * @param[in]     streaming   true to translate the pixels while sending, see rmt_dled_create_streaming.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `manager` argument is NULL or it is not initialized
+ *    - ESP_ERR_NO_MEM if all RMT channels are used
+ *    - the error codes of dled_strip_create_view, rmt_dled_create and rmt_dled_config, if error
+ */
+esp_err_t rmt_dled_manager_add_segment(rmt_dled_manager_t *manager, uint32_t first, uint32_t length,
+                                       gpio_num_t gpio_number, bool streaming);
+
+/**
+ * @brief Encode the changed segments and start sending them, without waiting for the end
+ *
+ * The changes of the logical strip are given to the segments and cleared. Segments
+ * without changes are not sent again. If a segment is streaming this waits for the end
+ * of all transmissions, like rmt_dled_send_pixels_async.
+ *
+ * @param[in,out] manager The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if the `manager` argument is NULL
+ *    - the error codes of rmt_dled_encode_pixels and rmt_dled_start, if error
+ */
+esp_err_t rmt_dled_manager_send_async(rmt_dled_manager_t *manager);
+
+/**
+ * @brief Wait for the end of the transmissions of all segments
+ *
+ * @param[in,out] manager   The structure to work with.
+ * @param[in]     wait_time Maximum time to wait for every segment, in ticks.
+ *
+ * @return
+ *    - ESP_OK success, nothing is being sent
+ *    - ESP_ERR_INVALID_ARG if the `manager` argument is NULL
+ *    - the error codes of rmt_dled_wait, if error
+ */
+esp_err_t rmt_dled_manager_wait(rmt_dled_manager_t *manager, TickType_t wait_time);
+
+/**
+ * @brief Send the changed segments and wait for the end of the transmissions
+ *
+ * @param[in,out] manager The structure to work with.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - the error codes of rmt_dled_manager_send_async and rmt_dled_manager_wait, if error
+ */
+esp_err_t rmt_dled_manager_send(rmt_dled_manager_t *manager);
+
+/**
+ * @brief Get where the time of the last frames went
+ *
+ * `fill_us` is the sync of the views, the encoders read the pixels themselves. `encode_us`
+ * adds the segments encoded for the last frame and `transmit_us` is the longest of the
+ * transmissions that ended since the last call, the segments are sent at the same time.
+ *
+ * @param[in,out] manager The structure to work with.
+ * @param[out]    timing  The times.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ */
+esp_err_t rmt_dled_manager_timing(rmt_dled_manager_t *manager, dled_output_timing_t *timing);
+
+/**
+ * @brief Set up an output sending the frames through the manager
+ *
+ * dled_output_send_async, dled_output_wait and dled_output_timing call
+ * rmt_dled_manager_send_async, rmt_dled_manager_wait and rmt_dled_manager_timing.
+ *
+ * @param[in]  manager The manager, with its segments added.
+ * @param[out] output  The output to set up.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ */
+esp_err_t rmt_dled_manager_output(rmt_dled_manager_t *manager, dled_output_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -58,10 +58,13 @@ function to process requests, decode URLs, serve files, etc. etc.
 
 #include "http_server.h"
 #include "wifi_manager.h"
+#include "boot_arena.h"
 
 
 EventGroupHandle_t http_server_event_group;
 EventBits_t uxBits;
+static dled_stats_t *http_server_stats = NULL;
+static char *http_server_stats_json = NULL; /* too large for the stack of this task */
 
 /* embedded binary data */
 extern const uint8_t style_css_start[] asm("_binary_style_css_start");
@@ -89,6 +92,13 @@ void http_server_set_event_start(){
 	xEventGroupSetBits(http_server_event_group, HTTP_SERVER_START_BIT_0 );
 }
 
+void http_server_set_stats(dled_stats_t *stats){
+	if(http_server_stats_json == NULL){
+		http_server_stats_json = boot_arena_alloc(DLED_STATS_JSON_SIZE, BOOT_ARENA_INTERNAL);
+	}
+	http_server_stats = http_server_stats_json ? stats : NULL;
+}
+
 
 void http_server(void *pvParameters) {
 
@@ -213,6 +223,16 @@ void http_server_netconn_serve(struct netconn *conn) {
 #endif
 				}
 			}
+			else if(strstr(line, "GET /stats.json ")){
+				int len = http_server_stats ? dled_stats_json(http_server_stats, http_server_stats_json, DLED_STATS_JSON_SIZE) : -1;
+				if(len >= 0){
+					netconn_write(conn, http_ok_json_no_cache_hdr, sizeof(http_ok_json_no_cache_hdr) - 1, NETCONN_NOCOPY);
+					netconn_write(conn, http_server_stats_json, len, NETCONN_COPY);
+				}
+				else{
+					netconn_write(conn, http_503_hdr, sizeof(http_503_hdr) - 1, NETCONN_NOCOPY);
+				}
+			}
 			else if(strstr(line, "DELETE /connect.json ")) {
 #if WIFI_MANAGER_DEBUG
 				printf("http_server_netconn_serve: DELETE /connect.json\n");
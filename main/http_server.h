@@ -38,6 +38,8 @@ function to process requests, decode URLs, serve files, etc. etc.
 extern "C" {
 #endif
 
+#include "dled_stats.h"
+
 #define HTTP_SERVER_START_BIT_0	( 1 << 0 )
 
 
@@ -45,6 +47,11 @@ void http_server(void *pvParameters);
 void http_server_netconn_serve(struct netconn *conn);
 void http_server_set_event_start();
 
+/**
+ * @brief sets the render statistics served as /stats.json, the route answers 503 until then.
+ */
+void http_server_set_stats(dled_stats_t *stats);
+
 /**
  * @brief gets a char* pointer to the first occurence of header_name withing the complete http request request.
  *
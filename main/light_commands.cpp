@@ -0,0 +1,134 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "light_commands.h"
+
+#include <string.h>
+#include "esp_log.h"
+
+static const char *LOG_TAG  = "light_commands";
+
+esp_err_t light_commands_init(light_commands_t *commands, uint16_t length) {
+    if (commands == NULL || length == 0) {
+        ESP_LOGE(LOG_TAG, "init: Argument is NULL or length is 0");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(commands, 0, sizeof(light_commands_t));
+    vPortCPUInitializeMutex(&commands->lock);
+    commands->queue = xQueueCreate(length, sizeof(light_command_t));
+    if (commands->queue == NULL) {
+        ESP_LOGE(LOG_TAG, "Failed to create a queue of %d commands", length);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t light_commands_send(light_commands_t *commands, light_command_type_t type, uint32_t value) {
+    if (commands == NULL || type >= LIGHT_COMMAND_TYPES) { return ESP_ERR_INVALID_ARG; }
+    if (commands->queue == NULL) {
+        ESP_LOGE(LOG_TAG, "send: The queue was not created");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    light_command_t command;
+    command.type = type;
+    command.value = value;
+
+    portENTER_CRITICAL(&commands->lock);
+    command.sequence = ++commands->sequence;
+    commands->sent++;
+    portEXIT_CRITICAL(&commands->lock);
+
+    if (xQueueSend(commands->queue, &command, 0) == pdTRUE) { return ESP_OK; }
+
+    /* full, wait for the render task in `overflow` */
+    portENTER_CRITICAL(&commands->lock);
+    commands->overflowed++;
+    light_command_t *older = &commands->overflow[type];
+    if ((commands->overflow_mask & LIGHT_COMMAND_BIT(type)) == 0) {
+        *older = command;
+        commands->overflow_mask |= LIGHT_COMMAND_BIT(type);
+    }
+    else {
+        commands->coalesced++;
+        if ((int32_t)(command.sequence - older->sequence) > 0) { *older = command; }
+    }
+    portEXIT_CRITICAL(&commands->lock);
+
+    return ESP_OK;
+}
+
+/* Keeps `command` in `latest` if it is the latest of its kind */
+static void light_commands_keep(light_command_t *latest, uint8_t *mask, uint32_t *coalesced, const light_command_t *command) {
+    light_command_t *older = &latest[command->type];
+
+    if ((*mask & LIGHT_COMMAND_BIT(command->type)) == 0) {
+        *older = *command;
+        *mask |= LIGHT_COMMAND_BIT(command->type);
+        return;
+    }
+    (*coalesced)++;
+    if ((int32_t)(command->sequence - older->sequence) > 0) { *older = *command; }
+}
+
+uint8_t light_commands_drain(light_commands_t *commands, light_settings_t *settings, uint8_t *taken) {
+    light_command_t latest[LIGHT_COMMAND_TYPES];
+    light_command_t command;
+    uint8_t mask = 0;
+    uint32_t coalesced = 0;
+
+    if (taken != NULL) { *taken = 0; }
+    if (commands == NULL || commands->queue == NULL || settings == NULL) { return 0; }
+
+    /* only what is in the queue now, the handlers may keep sending while it is drained */
+    UBaseType_t waiting = uxQueueMessagesWaiting(commands->queue);
+    while (waiting-- > 0 && xQueueReceive(commands->queue, &command, 0) == pdTRUE) {
+        light_commands_keep(latest, &mask, &coalesced, &command);
+    }
+    portENTER_CRITICAL(&commands->lock);
+    for (uint8_t type = 0; type < LIGHT_COMMAND_TYPES; type++) {
+        if (commands->overflow_mask & LIGHT_COMMAND_BIT(type)) {
+            light_commands_keep(latest, &mask, &coalesced, &commands->overflow[type]);
+        }
+    }
+    commands->overflow_mask = 0;
+    commands->coalesced += coalesced;
+    portEXIT_CRITICAL(&commands->lock);
+
+    uint8_t changed = 0;
+    for (uint8_t type = 0; type < LIGHT_COMMAND_RESTART; type++) {
+        if ((mask & LIGHT_COMMAND_BIT(type)) == 0) { continue; }
+
+        uint32_t value = latest[type].value;
+        if (type != LIGHT_COMMAND_COLOR && value > UINT8_MAX) {
+            ESP_LOGW(LOG_TAG, "Command %d: %u is out of range", type, (unsigned)value);
+            continue;
+        }
+        uint32_t sequence = settings->sequence;
+        switch (type) {
+            case LIGHT_COMMAND_COLOR:
+                light_settings_set_color(settings, (value >> 16) & 0xff, (value >> 8) & 0xff, value & 0xff);
+                break;
+            case LIGHT_COMMAND_SPEED:
+                light_settings_set_speed_delay(settings, value);
+                break;
+            case LIGHT_COMMAND_BRIGHTNESS:
+                light_settings_set_brightness(settings, value);
+                break;
+            case LIGHT_COMMAND_EFFECT:
+                light_settings_set_effect(settings, value);
+                break;
+        }
+        if (settings->sequence != sequence) { changed |= LIGHT_COMMAND_BIT(type); }
+    }
+
+    if (taken != NULL) { *taken = mask; }
+    return changed;
+}
+
+#ifdef __cplusplus
+}
+#endif
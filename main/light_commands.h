@@ -0,0 +1,107 @@
+#ifndef MAIN_LIGHT_COMMANDS_H_
+#define MAIN_LIGHT_COMMANDS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "light_settings.h"
+
+/**
+ * @brief The kinds of commands, and the setting each one changes
+ */
+typedef enum {
+    LIGHT_COMMAND_COLOR = 0,  /*!< `value` is the color as 0xrrggbb */
+    LIGHT_COMMAND_SPEED,      /*!< `value` is the speed delay */
+    LIGHT_COMMAND_BRIGHTNESS, /*!< `value` is the brightness */
+    LIGHT_COMMAND_EFFECT,     /*!< `value` is the effect */
+    LIGHT_COMMAND_RESTART,    /*!< (Re)start the effect, no `value` */
+    LIGHT_COMMAND_TYPES
+} light_command_type_t;
+
+/**
+ * @brief The bit of a kind of command in the masks of light_commands_drain.
+ */
+#define LIGHT_COMMAND_BIT(type) (1 << (type))
+
+/**
+ * @brief A command, what MQTT, HTTP and the touch pads ask the render task to do
+ */
+typedef struct {
+    uint8_t  type;     /*!< light_command_type_t */
+    uint32_t value;    /*!< See light_command_type_t */
+    uint32_t sequence; /*!< Order of the commands, the latest of a kind wins */
+} light_command_t;
+
+/**
+ * @brief A bounded queue of commands, drained by the render task once per frame
+ *
+ * The handlers never wait: a command which doesn't fit in the queue takes the place of
+ * the last one of its kind which didn't fit either. A burst of commands, like the
+ * ones of a slider in Home Assistant, then costs one change of every setting per frame
+ * and never leaves a backlog behind.
+ */
+typedef struct {
+    QueueHandle_t   queue;                         /*!< The commands, in order */
+    light_command_t overflow[LIGHT_COMMAND_TYPES]; /*!< Latest command of every kind which didn't fit in `queue` */
+    uint8_t         overflow_mask;                 /*!< LIGHT_COMMAND_BIT of every kind in `overflow` */
+    uint32_t        sequence;                      /*!< Sequence of the last command sent */
+    uint32_t        sent;                          /*!< Number of commands sent */
+    uint32_t        coalesced;                     /*!< Number of commands replaced by a later one of their kind */
+    uint32_t        overflowed;                    /*!< Number of commands which didn't fit in `queue` */
+    portMUX_TYPE    lock;                          /*!< Held while `overflow` and the counters change */
+} light_commands_t;
+
+/**
+ * @brief Initialize a light_commands_t structure and create its queue.
+ *
+ * @param[in,out] commands The structure to be initialized.
+ * @param[in]     length   Number of commands the queue holds.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if `commands` is NULL or `length` is 0
+ *    - ESP_ERR_NO_MEM if the queue could not be created
+ */
+esp_err_t light_commands_init(light_commands_t *commands, uint16_t length);
+
+/**
+ * @brief Send a command to the render task
+ *
+ * Never waits, may be called from any task.
+ *
+ * @param[in] commands The commands.
+ * @param[in] type     The kind of command.
+ * @param[in] value    See light_command_type_t.
+ *
+ * @return
+ *    - ESP_OK success, the command is in the queue or replaced an older one
+ *    - ESP_ERR_INVALID_ARG if `commands` is NULL or `type` is unknown
+ *    - ESP_ERR_INVALID_STATE if light_commands_init did not create the queue
+ */
+esp_err_t light_commands_send(light_commands_t *commands, light_command_type_t type, uint32_t value);
+
+/**
+ * @brief Take every command sent and apply the latest of every kind to the settings
+ *
+ * Called by the render task once per frame. Commands with a value the settings don't
+ * take (an unknown effect, a brightness of 0) are dropped by the setters.
+ *
+ * @param[in]  commands The commands.
+ * @param[in]  settings The settings changed by the commands.
+ * @param[out] taken    LIGHT_COMMAND_BIT of every kind of command taken, may be NULL.
+ *
+ * @return LIGHT_COMMAND_BIT of every setting which changed
+ */
+uint8_t light_commands_drain(light_commands_t *commands, light_settings_t *settings, uint8_t *taken);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
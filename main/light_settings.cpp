@@ -0,0 +1,179 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "light_settings.h"
+
+#include <stdio.h>
+#include "esp_log.h"
+
+static const char *LOG_TAG  = "light_settings";
+
+/* Called with the lock held, around the change of the fields. The fences keep the fields
+* from being written before the sequence is odd or after it is even again. */
+static void light_settings_write_begin(light_settings_t *settings) {
+    settings->sequence++;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void light_settings_write_end(light_settings_t *settings) {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    settings->sequence = settings->sequence == UINT32_MAX ? 2 : settings->sequence + 1;
+}
+
+esp_err_t light_settings_init(light_settings_t *settings, uint8_t effect, uint8_t effect_count) {
+    if (settings == NULL || effect >= effect_count) {
+        ESP_LOGE(LOG_TAG, "init: Argument is NULL or unknown effect");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    settings->r = (LIGHT_SETTINGS_DEFAULT_COLOR >> 16) & 0xff;
+    settings->g = (LIGHT_SETTINGS_DEFAULT_COLOR >> 8) & 0xff;
+    settings->b = LIGHT_SETTINGS_DEFAULT_COLOR & 0xff;
+    settings->speed_delay = LIGHT_SETTINGS_DEFAULT_SPEED_DELAY;
+    settings->brightness = LIGHT_SETTINGS_DEFAULT_BRIGHTNESS;
+    settings->effect = effect;
+    settings->effect_count = effect_count;
+    settings->sequence = 2; // so it differs from a `seen` of 0
+    vPortCPUInitializeMutex(&settings->lock);
+
+    return ESP_OK;
+}
+
+/* Value of a hexadecimal digit, -1 if it isn't one */
+static int light_settings_hex(char c) {
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+}
+
+esp_err_t light_settings_parse_color(const char *text, size_t length, uint8_t *r, uint8_t *g, uint8_t *b) {
+    if (text == NULL || r == NULL || g == NULL || b == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    if (length > 0 && text[0] == '#') {
+        text++;
+        length--;
+    }
+    if (length != 6) { return ESP_ERR_INVALID_ARG; }
+
+    uint8_t rgb[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        int high = light_settings_hex(text[2 * i]);
+        int low = light_settings_hex(text[2 * i + 1]);
+        if (high < 0 || low < 0) { return ESP_ERR_INVALID_ARG; }
+        rgb[i] = (high << 4) | low;
+    }
+    *r = rgb[0];
+    *g = rgb[1];
+    *b = rgb[2];
+
+    return ESP_OK;
+}
+
+void light_settings_format_color(const light_settings_t *settings, char *text) {
+    if (settings == NULL || text == NULL) { return; }
+
+    snprintf(text, LIGHT_SETTINGS_COLOR_TEXT_SIZE, "#%02x%02x%02x", settings->r, settings->g, settings->b);
+}
+
+esp_err_t light_settings_set_color(light_settings_t *settings, uint8_t r, uint8_t g, uint8_t b) {
+    if (settings == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    portENTER_CRITICAL(&settings->lock);
+    if (settings->r != r || settings->g != g || settings->b != b) {
+        light_settings_write_begin(settings);
+        settings->r = r;
+        settings->g = g;
+        settings->b = b;
+        light_settings_write_end(settings);
+    }
+    portEXIT_CRITICAL(&settings->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t light_settings_set_color_text(light_settings_t *settings, const char *text, size_t length) {
+    uint8_t r, g, b;
+
+    if (settings == NULL || light_settings_parse_color(text, length, &r, &g, &b) != ESP_OK) {
+        ESP_LOGW(LOG_TAG, "Not a color: '%.*s'", text ? (int)length : 0, text ? text : "");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return light_settings_set_color(settings, r, g, b);
+}
+
+esp_err_t light_settings_set_speed_delay(light_settings_t *settings, uint8_t speed_delay) {
+    if (settings == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    portENTER_CRITICAL(&settings->lock);
+    if (settings->speed_delay != speed_delay) {
+        light_settings_write_begin(settings);
+        settings->speed_delay = speed_delay;
+        light_settings_write_end(settings);
+    }
+    portEXIT_CRITICAL(&settings->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t light_settings_set_brightness(light_settings_t *settings, uint8_t brightness) {
+    if (settings == NULL || brightness == 0) { return ESP_ERR_INVALID_ARG; }
+
+    portENTER_CRITICAL(&settings->lock);
+    if (settings->brightness != brightness) {
+        light_settings_write_begin(settings);
+        settings->brightness = brightness;
+        light_settings_write_end(settings);
+    }
+    portEXIT_CRITICAL(&settings->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t light_settings_set_effect(light_settings_t *settings, uint8_t effect) {
+    if (settings == NULL || effect >= settings->effect_count) {
+        ESP_LOGW(LOG_TAG, "Unknown effect %d", effect);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&settings->lock);
+    if (settings->effect != effect) {
+        light_settings_write_begin(settings);
+        settings->effect = effect;
+        light_settings_write_end(settings);
+    }
+    portEXIT_CRITICAL(&settings->lock);
+
+    return ESP_OK;
+}
+
+bool light_settings_changed(const light_settings_t *settings, uint32_t *seen) {
+    uint32_t sequence = __atomic_load_n(&settings->sequence, __ATOMIC_ACQUIRE);
+    if (sequence == *seen) { return false; }
+
+    *seen = sequence;
+    return true;
+}
+
+void light_settings_get(const light_settings_t *settings, light_settings_t *copy) {
+    uint32_t sequence;
+
+    do {
+        sequence = __atomic_load_n(&settings->sequence, __ATOMIC_ACQUIRE);
+        copy->r = settings->r;
+        copy->g = settings->g;
+        copy->b = settings->b;
+        copy->speed_delay = settings->speed_delay;
+        copy->brightness = settings->brightness;
+        copy->effect = settings->effect;
+        copy->effect_count = settings->effect_count;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) != 0 || sequence != settings->sequence);
+    copy->sequence = sequence;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,161 @@
+#ifndef MAIN_LIGHT_SETTINGS_H_
+#define MAIN_LIGHT_SETTINGS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Default color, a yellowish orange like a real marquee.
+ */
+#define LIGHT_SETTINGS_DEFAULT_COLOR 0xff8200
+
+/**
+ * @brief Default time between two steps of the effects, in milliseconds.
+ */
+#define LIGHT_SETTINGS_DEFAULT_SPEED_DELAY 100
+
+/**
+ * @brief Default brightness, the max_cc_val of the strip.
+ */
+#define LIGHT_SETTINGS_DEFAULT_BRIGHTNESS 64
+
+/**
+ * @brief Size of a color as text, "#rrggbb" and the terminating 0.
+ */
+#define LIGHT_SETTINGS_COLOR_TEXT_SIZE 8
+
+/**
+ * @brief The settings of the lights, checked and parsed once when they are set
+ *
+ * The settings are a sequence lock. The MQTT and touch tasks change them with the setters,
+ * one at a time. The render task never waits for them: light_settings_get copies them
+ * again if a setter changed them during the copy, so the copy is never half old and half
+ * new. `sequence` is odd while a setter changes them and goes up by 2 with every change,
+ * so the render task only has to compare it once per frame to know if it must take the
+ * settings again.
+ *
+ * A single field can be read directly, light_settings_get is needed for more than one.
+ */
+typedef struct {
+    uint8_t           r, g, b;      /*!< Color of the single color effects */
+    uint8_t           speed_delay;  /*!< Time between two steps of the effects, in milliseconds */
+    uint8_t           brightness;   /*!< max_cc_val of the strip, never 0 */
+    uint8_t           effect;       /*!< The effect shown, below `effect_count` */
+    uint8_t           effect_count; /*!< Number of effects */
+    volatile uint32_t sequence;     /*!< Odd while the settings change, never 0 */
+    portMUX_TYPE      lock;         /*!< Held by the setters, never by light_settings_get */
+} light_settings_t;
+
+/**
+ * @brief Initialize a light_settings_t structure with the default settings.
+ *
+ * @param[in,out] settings     The structure to be initialized.
+ * @param[in]     effect       The default effect.
+ * @param[in]     effect_count Number of effects.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if `settings` is NULL or `effect` is not below `effect_count`
+ */
+esp_err_t light_settings_init(light_settings_t *settings, uint8_t effect, uint8_t effect_count);
+
+/**
+ * @brief Parse a color written as "#rrggbb" or "rrggbb"
+ *
+ * @param[in]  text   The text, does not need to end with a 0.
+ * @param[in]  length Length of `text`.
+ * @param[out] r, g, b The color.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL or `text` is not a color
+ */
+esp_err_t light_settings_parse_color(const char *text, size_t length, uint8_t *r, uint8_t *g, uint8_t *b);
+
+/**
+ * @brief Write the color of the settings as "#rrggbb"
+ *
+ * @param[in]  settings The settings, a copy from light_settings_get.
+ * @param[out] text     At least LIGHT_SETTINGS_COLOR_TEXT_SIZE bytes.
+ */
+void light_settings_format_color(const light_settings_t *settings, char *text);
+
+/**
+ * @brief Set the color
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if `settings` is NULL
+ */
+esp_err_t light_settings_set_color(light_settings_t *settings, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Set the color from its text, see light_settings_parse_color
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL or `text` is not a color, the color is kept
+ */
+esp_err_t light_settings_set_color_text(light_settings_t *settings, const char *text, size_t length);
+
+/**
+ * @brief Set the time between two steps of the effects
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if `settings` is NULL
+ */
+esp_err_t light_settings_set_speed_delay(light_settings_t *settings, uint8_t speed_delay);
+
+/**
+ * @brief Set the brightness
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if `settings` is NULL or `brightness` is 0
+ */
+esp_err_t light_settings_set_brightness(light_settings_t *settings, uint8_t brightness);
+
+/**
+ * @brief Set the effect
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if `settings` is NULL or `effect` is not below `effect_count`
+ */
+esp_err_t light_settings_set_effect(light_settings_t *settings, uint8_t effect);
+
+/**
+ * @brief Tell if the settings changed since `*seen`
+ *
+ * Does not wait and does not take the lock, the render task calls it once per frame.
+ *
+ * @param[in]     settings The settings.
+ * @param[in,out] seen     The sequence last seen, set to the current one.
+ *
+ * @return true if the settings changed
+ */
+bool light_settings_changed(const light_settings_t *settings, uint32_t *seen);
+
+/**
+ * @brief Copy the settings as they were between two changes
+ *
+ * Does not take the lock, tries again while a setter changes the settings.
+ *
+ * @param[in]  settings The settings.
+ * @param[out] copy     Where they are copied, `lock` is not.
+ */
+void light_settings_get(const light_settings_t *settings, light_settings_t *copy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,310 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "light_store.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "rom/crc.h"
+
+static const char *LOG_TAG  = "light_store";
+
+/* How long light_store_flush waits for another task saving the settings */
+#define LIGHT_STORE_FLUSH_WAIT_MS 1000
+
+/* Key of the record in NVS */
+#define LIGHT_STORE_KEY "settings"
+
+/* Bytes of the record before the ones covered by `crc` */
+#define LIGHT_STORE_RECORD_HEADER_SIZE offsetof(light_store_record_t, r)
+
+esp_err_t light_store_init(light_store_t *store, const char *nvs_namespace) {
+    if (store == NULL || nvs_namespace == NULL) {
+        ESP_LOGE(LOG_TAG, "init: Argument is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(store, 0, sizeof(light_store_t));
+    store->nvs_namespace = nvs_namespace;
+    vPortCPUInitializeMutex(&store->lock);
+    store->flushing = xSemaphoreCreateMutex();
+    if (store->flushing == NULL) {
+        ESP_LOGE(LOG_TAG, "Failed to create the mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void light_store_mark(light_store_t *store, uint8_t changed) {
+    if (store == NULL || changed == 0) { return; }
+
+    portENTER_CRITICAL(&store->lock);
+    for (uint8_t type = 0; type < LIGHT_COMMAND_RESTART; type++) {
+        if (changed & LIGHT_COMMAND_BIT(type)) { store->changes++; }
+    }
+    store->dirty |= changed;
+    portEXIT_CRITICAL(&store->lock);
+}
+
+uint8_t light_store_dirty(light_store_t *store) {
+    if (store == NULL) { return 0; }
+
+    portENTER_CRITICAL(&store->lock);
+    uint8_t dirty = store->dirty;
+    portEXIT_CRITICAL(&store->lock);
+
+    return dirty;
+}
+
+/* Takes one setting into `saved` if it differs, returns true if it did */
+static bool light_store_take(uint8_t type, const light_settings_t *settings, light_settings_t *saved) {
+    switch (type) {
+        case LIGHT_COMMAND_COLOR:
+            if (settings->r == saved->r && settings->g == saved->g && settings->b == saved->b) { return false; }
+            saved->r = settings->r;
+            saved->g = settings->g;
+            saved->b = settings->b;
+            return true;
+        case LIGHT_COMMAND_SPEED:
+            if (settings->speed_delay == saved->speed_delay) { return false; }
+            saved->speed_delay = settings->speed_delay;
+            return true;
+        case LIGHT_COMMAND_BRIGHTNESS:
+            if (settings->brightness == saved->brightness) { return false; }
+            saved->brightness = settings->brightness;
+            return true;
+        case LIGHT_COMMAND_EFFECT:
+            if (settings->effect == saved->effect) { return false; }
+            saved->effect = settings->effect;
+            return true;
+    }
+    return false;
+}
+
+static uint32_t light_store_record_crc(const uint8_t *data, size_t size) {
+    return crc32_le(0, data + LIGHT_STORE_RECORD_HEADER_SIZE, size - LIGHT_STORE_RECORD_HEADER_SIZE);
+}
+
+/* Writes `settings` as a record, the caller commits */
+static esp_err_t light_store_write_record(nvs_handle handle, const light_settings_t *settings) {
+    light_store_record_t record;
+
+    memset(&record, 0, sizeof(light_store_record_t));
+    record.version = LIGHT_STORE_RECORD_VERSION;
+    record.size = sizeof(light_store_record_t);
+    record.r = settings->r;
+    record.g = settings->g;
+    record.b = settings->b;
+    record.speed_delay = settings->speed_delay;
+    record.brightness = settings->brightness;
+    record.effect = settings->effect;
+    record.crc = light_store_record_crc((const uint8_t*)&record, sizeof(light_store_record_t));
+
+    return nvs_set_blob(handle, LIGHT_STORE_KEY, &record, sizeof(light_store_record_t));
+}
+
+/* Applies a record of any version, returns ESP_ERR_INVALID_CRC if it is damaged */
+static esp_err_t light_store_apply_record(const uint8_t *data, size_t length, light_settings_t *settings) {
+    const light_store_record_t *header = (const light_store_record_t*)data;
+
+    if (length <= LIGHT_STORE_RECORD_HEADER_SIZE || header->size != length
+        || header->crc != light_store_record_crc(data, length)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (header->version != LIGHT_STORE_RECORD_VERSION) {
+        ESP_LOGI(LOG_TAG, "Reading a version %d record", header->version);
+    }
+
+    /* the fields missing from an older record keep their default */
+    light_store_record_t record;
+    record.r = settings->r;
+    record.g = settings->g;
+    record.b = settings->b;
+    record.speed_delay = settings->speed_delay;
+    record.brightness = settings->brightness;
+    record.effect = settings->effect;
+    memcpy(&record, data, length < sizeof(light_store_record_t) ? length : sizeof(light_store_record_t));
+
+    light_settings_set_color(settings, record.r, record.g, record.b);
+    light_settings_set_speed_delay(settings, record.speed_delay);
+    light_settings_set_brightness(settings, record.brightness);
+    light_settings_set_effect(settings, record.effect);
+
+    return ESP_OK;
+}
+
+/* Reads the keys of the firmware before the record, returns ESP_ERR_NVS_NOT_FOUND if there is none */
+static esp_err_t light_store_read_keys(nvs_handle handle, light_settings_t *settings) {
+    char color[LIGHT_SETTINGS_COLOR_TEXT_SIZE];
+    size_t size = sizeof(color);
+    uint8_t value;
+    bool found = false;
+
+    if (nvs_get_str(handle, "palette", color, &size) == ESP_OK) {
+        light_settings_set_color_text(settings, color, strlen(color));
+        found = true;
+    }
+    if (nvs_get_u8(handle, "speed", &value) == ESP_OK) {
+        light_settings_set_speed_delay(settings, value);
+        found = true;
+    }
+    if (nvs_get_u8(handle, "brightness", &value) == ESP_OK) {
+        light_settings_set_brightness(settings, value);
+        found = true;
+    }
+    if (nvs_get_u8(handle, "effect", &value) == ESP_OK) {
+        light_settings_set_effect(settings, value);
+        found = true;
+    }
+
+    return found ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t light_store_load(light_store_t *store, light_settings_t *settings) {
+    if (store == NULL || settings == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    int64_t start_us = esp_timer_get_time();
+    uint8_t data[LIGHT_STORE_RECORD_MAX_SIZE];
+    size_t length = sizeof(data);
+    nvs_handle handle;
+
+    esp_err_t err = nvs_open(store->nvs_namespace, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "Error (%s) opening NVS", esp_err_to_name(err));
+        light_settings_get(settings, &store->saved);
+        return err;
+    }
+
+    err = nvs_get_blob(handle, LIGHT_STORE_KEY, data, &length);
+    if (err == ESP_OK) {
+        err = light_store_apply_record(data, length, settings);
+        if (err != ESP_OK) {
+            ESP_LOGE(LOG_TAG, "The settings are damaged, using the defaults");
+        }
+    }
+    else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        /* once, from the firmware before the record */
+        err = light_store_read_keys(handle, settings);
+        if (err == ESP_OK) {
+            err = light_store_write_record(handle, settings);
+            if (err == ESP_OK) {
+                err = nvs_commit(handle);
+            }
+            if (err == ESP_OK) {
+                ESP_LOGI(LOG_TAG, "Settings moved to a version %d record", LIGHT_STORE_RECORD_VERSION);
+            }
+        }
+        else {
+            err = ESP_OK; // nothing saved yet
+        }
+    }
+    nvs_close(handle);
+
+    light_settings_get(settings, &store->saved);
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "Error (%s) reading the settings", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(LOG_TAG, "Settings read in %u us", (unsigned)(esp_timer_get_time() - start_us));
+
+    return ESP_OK;
+}
+
+esp_err_t light_store_flush(light_store_t *store, const light_settings_t *settings) {
+    if (store == NULL || settings == NULL) { return ESP_ERR_INVALID_ARG; }
+
+    if (xSemaphoreTake(store->flushing, pdMS_TO_TICKS(LIGHT_STORE_FLUSH_WAIT_MS)) != pdTRUE) {
+        ESP_LOGE(LOG_TAG, "Another task is saving the settings");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    portENTER_CRITICAL(&store->lock);
+    uint8_t dirty = store->dirty;
+    store->dirty = 0;
+    portEXIT_CRITICAL(&store->lock);
+
+    if (dirty == 0) {
+        xSemaphoreGive(store->flushing);
+        return ESP_OK;
+    }
+
+    /* only the marked settings are saved, the others may not be marked yet */
+    light_settings_t copy;
+    light_settings_t saved = store->saved;
+    light_settings_get(settings, &copy);
+
+    uint8_t written = 0;
+    uint32_t avoided = 0;
+    for (uint8_t type = 0; type < LIGHT_COMMAND_RESTART; type++) {
+        if ((dirty & LIGHT_COMMAND_BIT(type)) == 0) { continue; }
+        if (light_store_take(type, &copy, &saved)) {
+            written |= LIGHT_COMMAND_BIT(type);
+        }
+        else {
+            avoided++;
+        }
+    }
+
+    esp_err_t err = ESP_OK;
+    if (written != 0) {
+        nvs_handle handle;
+        err = nvs_open(store->nvs_namespace, NVS_READWRITE, &handle);
+        if (err == ESP_OK) {
+            err = light_store_write_record(handle, &saved);
+            if (err == ESP_OK) {
+                err = nvs_commit(handle);
+            }
+            nvs_close(handle);
+        }
+    }
+
+    if (err == ESP_OK) {
+        store->saved = saved;
+    }
+    portENTER_CRITICAL(&store->lock);
+    if (err == ESP_OK) {
+        store->writes_avoided += avoided;
+        if (written != 0) { store->commits++; }
+    }
+    else {
+        store->dirty |= dirty; // try again with the next flush
+    }
+    portEXIT_CRITICAL(&store->lock);
+    xSemaphoreGive(store->flushing);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "Error (%s) saving the settings", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(LOG_TAG, "Settings saved (%02x), %u commits for %u changes so far",
+             written, (unsigned)store->commits, (unsigned)store->changes);
+
+    return ESP_OK;
+}
+
+int light_store_json(light_store_t *store, char *buffer, size_t size) {
+    if (store == NULL || buffer == NULL) { return -1; }
+
+    portENTER_CRITICAL(&store->lock);
+    uint32_t changes = store->changes;
+    uint32_t commits = store->commits;
+    uint32_t writes_avoided = store->writes_avoided;
+    uint8_t dirty = store->dirty;
+    portEXIT_CRITICAL(&store->lock);
+
+    int length = snprintf(buffer, size,
+                          "{\"changes\":%u,\"commits\":%u,\"commits_avoided\":%u,\"writes_avoided\":%u,\"dirty\":%u}",
+                          (unsigned)changes, (unsigned)commits, (unsigned)(changes - commits),
+                          (unsigned)writes_avoided, dirty);
+
+    return length >= 0 && (size_t)length < size ? length : -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
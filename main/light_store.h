@@ -0,0 +1,154 @@
+#ifndef MAIN_LIGHT_STORE_H_
+#define MAIN_LIGHT_STORE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "light_settings.h"
+#include "light_commands.h"
+
+/**
+ * @brief Size of a buffer large enough for light_store_json.
+ */
+#define LIGHT_STORE_JSON_SIZE 128
+
+/**
+ * @brief Version of light_store_record_t written by this firmware.
+ */
+#define LIGHT_STORE_RECORD_VERSION 1
+
+/**
+ * @brief Largest record read from NVS, records of later versions may be larger than ours.
+ */
+#define LIGHT_STORE_RECORD_MAX_SIZE 64
+
+/**
+ * @brief The settings as one NVS blob
+ *
+ * Later versions only add fields at the end and never change the ones before, so every
+ * version reads the fields it knows of any record: the fields a record is too short for
+ * keep their default, the fields this firmware doesn't know are ignored.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  version;     /*!< LIGHT_STORE_RECORD_VERSION of the firmware which wrote it */
+    uint8_t  size;        /*!< Size of the whole record in bytes */
+    uint16_t reserved;    /*!< 0 */
+    uint32_t crc;         /*!< crc32_le of the `size - 8` bytes after it */
+    uint8_t  r, g, b;     /*!< Color of the single color effects */
+    uint8_t  speed_delay; /*!< Time between two steps of the effects, in milliseconds */
+    uint8_t  brightness;  /*!< max_cc_val of the strip */
+    uint8_t  effect;      /*!< The effect shown */
+} light_store_record_t;
+
+/**
+ * @brief The settings saved in NVS, written back in one transaction once they stop changing
+ *
+ * The settings are one light_store_record_t, read once at boot by light_store_load. The
+ * render task marks the settings which changed, the settings task saves them all at once
+ * after a quiet period, with one blob and one nvs_commit. A setting which changed back to
+ * what NVS holds is not written. `saved` is what NVS holds, so nothing is read back to know.
+ */
+typedef struct {
+    const char        *nvs_namespace;  /*!< Namespace of the settings in NVS */
+    light_settings_t  saved;           /*!< The settings as NVS holds them */
+    uint8_t           dirty;           /*!< LIGHT_COMMAND_BIT of every setting changed since they were saved */
+    uint32_t          changes;         /*!< Number of changes marked */
+    uint32_t          commits;         /*!< Number of nvs_commit */
+    uint32_t          writes_avoided;  /*!< Number of settings not written because NVS already held them */
+    portMUX_TYPE      lock;            /*!< Held while `dirty` and the counters change */
+    SemaphoreHandle_t flushing;        /*!< Held while the settings are written */
+} light_store_t;
+
+/**
+ * @brief Initialize a light_store_t structure.
+ *
+ * @param[in,out] store         The structure to be initialized.
+ * @param[in]     nvs_namespace Namespace of the settings in NVS, must stay valid.
+ *
+ * @return
+ *    - ESP_OK success
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ *    - ESP_ERR_NO_MEM if the mutex could not be created
+ */
+esp_err_t light_store_init(light_store_t *store, const char *nvs_namespace);
+
+/**
+ * @brief Read the settings from NVS, once at boot
+ *
+ * Reads the record with one lookup. Without a record, the settings are read once from
+ * the keys of the firmware before it ("palette", "speed", "brightness" and "effect") and
+ * saved as a record right away, the keys are kept for an older firmware. Settings which
+ * are not in NVS, or not valid, keep their value.
+ *
+ * @param[in]     store    The store.
+ * @param[in,out] settings The settings, initialized with their defaults.
+ *
+ * @return
+ *    - ESP_OK success, or nothing saved yet
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ *    - ESP_ERR_INVALID_CRC if the record is damaged, the settings keep their defaults
+ *    - the error of NVS otherwise
+ */
+esp_err_t light_store_load(light_store_t *store, light_settings_t *settings);
+
+/**
+ * @brief Mark settings to be saved
+ *
+ * Never waits, may be called from any task.
+ *
+ * @param[in] store   The store.
+ * @param[in] changed LIGHT_COMMAND_BIT of every setting which changed.
+ */
+void light_store_mark(light_store_t *store, uint8_t changed);
+
+/**
+ * @brief Tell which settings wait to be saved
+ *
+ * @return LIGHT_COMMAND_BIT of every setting marked since the last light_store_flush
+ */
+uint8_t light_store_dirty(light_store_t *store);
+
+/**
+ * @brief Save the marked settings in one transaction
+ *
+ * Writes the record once if a marked setting differs from `saved`, then commits once.
+ * Settings which could not be saved stay marked.
+ *
+ * @param[in] store    The store.
+ * @param[in] settings The settings to save from.
+ *
+ * @return
+ *    - ESP_OK success, or nothing to save
+ *    - ESP_ERR_INVALID_ARG if an argument is NULL
+ *    - ESP_ERR_TIMEOUT if another task is saving the settings for too long
+ *    - the error of NVS otherwise
+ */
+esp_err_t light_store_flush(light_store_t *store, const light_settings_t *settings);
+
+/**
+ * @brief Write the counters of the store as a JSON object
+ *
+ * @code
+ * {"changes":120,"commits":4,"commits_avoided":116,"writes_avoided":2,"dirty":0}
+ * @endcode
+ * `commits_avoided` is `changes - commits`, every change used to be committed on its own.
+ *
+ * @param[in]  store  The store.
+ * @param[out] buffer Where the text is written.
+ * @param[in]  size   Size of `buffer`, LIGHT_STORE_JSON_SIZE is enough.
+ *
+ * @return The length of the text, -1 if it does not fit in `buffer`
+ */
+int light_store_json(light_store_t *store, char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
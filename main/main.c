@@ -53,6 +53,7 @@ SOFTWARE.
 #include "esp_system.h"
 #include "esp_event_loop.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 // TCP/IP stack stuff
@@ -69,13 +70,28 @@ SOFTWARE.
 
 // Our own stuff
 #include "esp32_rmt_dled.h" // WS2811 control
+#include "esp32_rmt_dled_manager.h" // One or more strips on their own GPIOs
+#include "dled_bench.h"
+#include "boot_arena.h" // Every buffer is taken at boot
+#include "dled_stats.h" // Render times for /stats.json and the telemetry
+#include "light_settings.h" // Color, speed, brightness and effect, parsed once when they change
+#include "light_commands.h" // What MQTT and the touch pads ask the render task to do
+#include "light_store.h" // Saves the settings in NVS once they stop changing
 #include "http_server.h" // Wifi manager
 #include "wifi_manager.h" // Wifi manager
 
 #define STACK_SIZE (6*1024)
 #define LED_TASK_PRIORITY 10
-#define NUM_LEDS 112
-#define FLOAT_TO_INT(x) ((x)>=0?(int)((x)+0.5):(int)((x)-0.5))
+#define NUM_LEDS 112 // LEDs on the first strip
+#define TOTAL_LEDS (NUM_LEDS + CONFIG_LED_STRIP2_LENGTH) // The effects see all the strips as one
+#if CONFIG_LED_OUTPUT_STREAMING
+#define LED_STREAMING true // Pixels are translated to RMT items while they are sent
+#else
+#define LED_STREAMING false
+#endif
+#define RENDER_FRAME_MS 10 // The render task makes a frame every RENDER_FRAME_MS
+#define WIPE_PIXELS_PER_FRAME 3 // Number of pixels changed per frame by the wipe style effects
+#define RAINBOW_HUE_STEP 43 // Hue between two pixels of the rainbow, about the 1530 colors of dled_pixel_rainbow_step
 
 // Touch pad stuff (for controlling basic on/off of the lights)
 #define TOUCH_THRESH_NO_USE   (0)
@@ -103,19 +119,23 @@ typedef enum led_effect {
 } led_effect;
 
 
-TaskHandle_t led_task_handle = NULL; // Used for LED tasks
-rmt_pixel_strip_t rps; // LED Stuff
+static TaskHandle_t render_task_handle = NULL; // The LED task
+static TaskHandle_t settings_task_handle = NULL; // Saves the settings the render task changed
+static EventGroupHandle_t settings_changed_group = NULL; // LIGHT_COMMAND_BIT of the settings to save
+int64_t effect_requested_us = 0; // When showtime() was last called
+rmt_dled_manager_t leds; // LED Stuff
+dled_output_t led_output; // Where the render task sends the frames, the RMT channels of `leds`
+dled_stats_t render_stats; // Times of the frames of every effect
 pixel_strip_t strip; // LED Stuff
 // These are just the defaults.  You can change them via the MQTT_CONFIG_TOPIC
 int strip1_gpio = 16; // NOTE: Using GPIO 16 (aka P16). 0 is the RMT peripheral "channel"
-uint8_t led_brightness = 64;
+light_settings_t light_settings; // Color, speed, brightness and effect, see light_settings_init
+light_commands_t light_commands; // Changes of light_settings, applied by the render task
+light_store_t light_store; // The settings NVS holds, and the ones waiting to be saved
 bool led_brightness_up = true; // Used by TOUCH2 to cycle through brightness up/down
-uint8_t effect_speed_delay = 100;
 uint8_t twinkly = 25; // Controls how much twinkle the led_twinkle() effect will...  Twinkle
     // Lower values == less likely to twinkle any given LED
-char led_palette[] = "#ff8200"; // Default to a yellowish orange color (like a real marquee)
-enum led_effect current_effect = RAINBOW;
-enum led_effect prev_effect = OFF;
+uint8_t prev_effect = OFF; // What ON turns back on, written by the render task, read with prev_effect_get()
 
 struct tm last_press = { 0 };// Used to detect a long press of the power button (e.g. to reset wifi)
 
@@ -131,15 +151,6 @@ const int WIFI_CONNECTED_BIT = BIT0; // Same as what WIFI_MANAGER uses
 static void obtain_time(void);
 static void initialize_sntp(void);
 
-/**
-* @brief Structure to access various LED strip items from an MQTT context
-*
-*/
-typedef struct {
-    rmt_pixel_strip_t *rps;       /*!< LED strip's main struct */
-    TaskHandle_t *effectHandle;   /*!< Handle to kill any running effects) */
-} effect_context_t;
-
 /* Variable holding number of times ESP32 restarted since first boot.
 * It is placed into RTC memory using RTC_DATA_ATTR and
 * maintains its value when ESP32 wakes from deep sleep.
@@ -183,11 +194,9 @@ int random(int min, int max) {
     return out;
 }
 
-char* substring(const char* str, size_t begin, size_t len) {
-    if (str == 0 || strlen(str) == 0 || strlen(str) < begin || strlen(str) < (begin+len))
-        return 0;
-
-    return strndup(str + begin, len);
+// The MQTT and touch pad tasks read prev_effect while the render task changes it
+static uint8_t prev_effect_get(void) {
+    return __atomic_load_n(&prev_effect, __ATOMIC_ACQUIRE);
 }
 
 void delay_ms(uint32_t ms) {
@@ -195,31 +204,6 @@ void delay_ms(uint32_t ms) {
     vTaskDelay(ms / portTICK_PERIOD_MS);
 }
 
-void rotate_pixels(pixel_t *pixels, int length) {
-    /* Store last element of pixels */
-    pixel_t last = pixels[length - 1];
-
-    for (int i=length-1; i>0; i--) {
-        /* Move each pixel to its right */
-        pixels[i] = pixels[i - 1];
-    }
-
-    /* Copy last element of array to first */
-    pixels[0] = last;
-}
-void rotate_pixels_reverse(pixel_t *pixels, int length) {
-    /* Store last element of pixels */
-    pixel_t first = pixels[0];
-
-    for (int i=0; i<length-1; i++) {
-        /* Move each pixel to its left */
-        pixels[i] = pixels[i + 1];
-    }
-
-    /* Copy first element of array to last */
-    pixels[length-1] = first;
-}
-
 // Initialize TOUCH0
 static void tp_init() {
     ESP_LOGI(TAG, "Initializing touch sensors");
@@ -228,232 +212,327 @@ static void tp_init() {
     touch_pad_config(TOUCH3, TOUCH_THRESH_NO_USE);
 }
 
-static void initialize_leds(rmt_pixel_strip_t *rps, pixel_strip_t *strip) {
+static void initialize_leds(rmt_dled_manager_t *leds, pixel_strip_t *strip, dled_output_t *output) {
     esp_err_t err;
+    light_settings_t current;
 
+    light_settings_get(&light_settings, &current);
     dled_strip_init(strip);
-    dled_strip_create(strip, DLED_WS281x, NUM_LEDS, led_brightness); // NOTE: DLED_WS281x works with WS2811 12mm pixels
+    dled_strip_create(strip, DLED_WS2811, TOTAL_LEDS, current.brightness); // WS2811 12mm pixels, the encoders send RGB
+#if CONFIG_LED_GAMMA_CORRECTION
+    dled_strip_set_gamma(strip, true);
+#endif
+#if CONFIG_LED_HIGH_PRECISION
+    err = dled_strip_create_hd(strip);
+    if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] dled_strip_create_hd failed", err); } // Effects will use the 8-bit pixels
+#endif
 
-    rmt_dled_init(rps);
+    rmt_dled_manager_init(leds, strip);
 
-    err = rmt_dled_create(rps, strip);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "[0x%x] rmt_dled_init failed", err);
-        while(true) { }
-    }
     // TODO: Change this to accept a passed-in GPIO
-    err = rmt_dled_config(rps, strip1_gpio, 0);
+    err = rmt_dled_manager_add_segment(leds, 0, NUM_LEDS, strip1_gpio, LED_STREAMING);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "[0x%x] rmt_dled_config failed", err);
+        ESP_LOGE(TAG, "[0x%x] rmt_dled_manager_add_segment failed", err);
         while(true) { }
     }
+#if CONFIG_LED_STRIP2_LENGTH > 0
+    // The second strip continues where the first one ends but is sent at the same time
+    err = rmt_dled_manager_add_segment(leds, NUM_LEDS, CONFIG_LED_STRIP2_LENGTH, CONFIG_LED_STRIP2_GPIO, LED_STREAMING);
+    if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_manager_add_segment failed", err); } // Keep going with the first strip
+#endif
+
+    rmt_dled_manager_output(leds, output);
+    err = dled_output_send(output);
+    if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] dled_output_send failed", err); }
+    else               { ESP_LOGI(TAG, "LEDs initialized and turned off"); } // dled_strip_create zeroed the pixels
+}
 
-    err = rmt_dled_send(rps);
-    if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-    else               { ESP_LOGI(TAG, "LEDs initialized and turned off"); }
+/**
+* @brief The state shared by the effects, reset by every effect's init
+*
+*/
+typedef struct {
+    uint32_t step;          /*!< Where the effect is in its sequence */
+    uint32_t hue;           /*!< Hue of color drifting effects, the high 16 bits are the hue of dled_pixel_hsv */
+    uint32_t last_ms;       /*!< When the effect last rendered a frame */
+    uint32_t next_step_ms;  /*!< When the effect should take its next step */
+    bool reverse;           /*!< Direction of effects going back and forth */
+} effect_state_t;
+
+/**
+* @brief An effect run by the render task
+*
+* All functions are called from the render task, at frame boundaries.
+*/
+typedef struct {
+    const char *name;
+    void (*init)(uint32_t now_ms);    /*!< Prepares the effect and the pixels */
+    bool (*render)(uint32_t now_ms);  /*!< Renders one frame, returns true if the pixels changed */
+    void (*teardown)(void);           /*!< Called before the next effect starts, may be NULL */
+    void (*update)(void);             /*!< Called when `params` changed while it runs, may be NULL */
+} effect_t;
+
+static effect_state_t fx;
+static light_settings_t params; // The render task's copy of light_settings, taken again when they change
+
+// Returns true (and schedules the next step) if the effect should take a step at now_ms
+static bool effect_step_due(uint32_t now_ms, uint32_t period_ms) {
+    if ((int32_t)(now_ms - fx.next_step_ms) < 0) {
+        return false;
+    }
+    fx.next_step_ms = now_ms + period_ms;
+    return true;
+}
 
-    uint16_t step;
+static void effect_init_state(uint32_t now_ms) {
+    // Undo any moving/tiling from the previous effect
+    dled_strip_set_transform(&strip, false, false, 0);
+    dled_strip_set_offset(&strip, 0);
+    fx.step = 0;
+    fx.hue = 0;
+    fx.last_ms = now_ms;
+    fx.next_step_ms = now_ms;
+    fx.reverse = false;
+}
 
-    // Blank the LEDs on startup
-    step = 0;
-    while (step < strip->length) {
-        dled_pixel_move_pixel(strip->pixels, strip->length, 0, step);
-        dled_strip_fill_buffer(strip);
-        rmt_dled_send(rps);
-        step++;
+// Uses the high precision pixels if we have them so slow rainbows don't step
+void led_rainbow_init(uint32_t now_ms) {
+    effect_init_state(now_ms);
+    if (strip.pixels16) {
+        dled_strip_set_hd(&strip, true);
     }
 }
 
-void led_rainbow(void *event_ctx) {
-    uint16_t step;
-    esp_err_t err;
-    step = 0;
-    while (true) {
-        while (step < UINT16_MAX) {
-            dled_pixel_rainbow_step(strip.pixels, strip.length, led_brightness, step);
-            dled_strip_fill_buffer(&strip);
-            err = rmt_dled_send(&rps);
-            if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-            step++;
-            delay_ms(effect_speed_delay);
-        }
-        step = 0;
+void led_rainbow_teardown(void) {
+    dled_strip_set_hd(&strip, false);
+}
+
+bool led_rainbow(uint32_t now_ms) {
+    // The rainbow moves by one pixel every params.speed_delay, a little every frame so it never jumps
+    uint32_t delay = params.speed_delay ? params.speed_delay : 1;
+    uint16_t previous_hue = fx.hue >> 16;
+    fx.hue += (uint64_t)(now_ms - fx.last_ms) * ((uint32_t)RAINBOW_HUE_STEP << 16) / delay;
+    fx.last_ms = now_ms;
+    if (strip.hd) {
+        dled_pixel_hue_step16(strip.pixels16, strip.length, fx.hue >> 16, RAINBOW_HUE_STEP, 65535, 65535);
+        return true; // Always, the output dithers between frames
     }
+    if ((fx.hue >> 16) == previous_hue) return false;
+    dled_pixel_hue_step(strip.pixels, strip.length, fx.hue >> 16, RAINBOW_HUE_STEP, 255, 255);
+    dled_strip_mark_all_dirty(&strip);
+    return true;
 }
 
-void led_rainbow_marquee(void *event_ctx) {
-    uint16_t step;
-    esp_err_t err;
-    step = 0;
+bool led_rainbow_marquee(uint32_t now_ms) {
+    if (!effect_step_due(now_ms, params.speed_delay)) return false;
     // For this effect we let the previous effect get overwritten gradually (because it looks cool)
-    while (true) {
-        while (step < UINT16_MAX) {
-            // Rainbow all the pixels that are divisible by 3 and bove the pixels to the left by one
-            if (step % 3 == 0) {
-                strip.pixels[strip.length-1] = dled_pixel_get_color_by_index(led_brightness, step);
-            } else {
-                dled_pixel_set(&strip.pixels[strip.length-1], 0, 0, 0); // WS2811 are GRB
-            }
-            rotate_pixels(strip.pixels, strip.length);
-            dled_strip_fill_buffer(&strip);
-            err = rmt_dled_send(&rps);
-            if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-            step++;
-            delay_ms(effect_speed_delay);
-        }
-        step = 0;
+    // Move the pixels to the right by one and rainbow the new first pixel if it is divisible by 3
+    dled_strip_set_offset(&strip, strip.offset + 1);
+    uint32_t first = dled_strip_source_index(&strip, 0);
+    if (fx.step % 3 == 0) {
+        strip.pixels[first] = dled_pixel_rainbow_color(255, fx.step);
+    } else {
+        dled_pixel_set(&strip.pixels[first], 0, 0, 0);
     }
+    fx.step++;
+    return true;
 }
 
-void set_strip_color(int r, int b, int g, int speed) {
-    esp_err_t err;
-    uint16_t step = 0;
-    while (step < strip.length) {
-        dled_pixel_set(&strip.pixels[step], g, r, b); // WS2811 are GRB
-        dled_strip_fill_buffer(rps.strip); // Do them one at a time to make it smooooooth and cool
-        err = rmt_dled_send(&rps);
-        if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-        step++;
-        delay_ms(speed);
+// Wipes a color over the strip, a few pixels per frame, then waits hold_ms before wiping again
+static bool effect_wipe(uint32_t now_ms, uint32_t hold_ms, void (*set_pixel)(uint32_t idx)) {
+    if (fx.step >= strip.length) {
+        if (!effect_step_due(now_ms, 0)) return false;
+        fx.step = 0;
+    }
+    for (uint16_t n = 0; n < WIPE_PIXELS_PER_FRAME && fx.step < strip.length; n++) {
+        set_pixel(fx.step++);
     }
+    if (fx.step >= strip.length) {
+        fx.next_step_ms = now_ms + hold_ms;
+    }
+    return true;
 }
 
-void led_blank(void *event_ctx) {
-    while (true) {
-        set_strip_color(0,0,0,50); // All black (off)
-        delay_ms(50); // This one doesn't need an adjustable delay
-    }
+static void led_blank_pixel(uint32_t idx) {
+    dled_strip_set_pixel(&strip, idx, 0, 0, 0); // All black (off)
 }
 
-void led_set_brightness(pixel_t *pixel, int max_cc_val) {
-    // Brightness value is 0-255 so we need to figure out the percentage to fade it in or out for each color based on the number of steps
-    float percent = (float)max_cc_val/255.0;
-    pixel->r = FLOAT_TO_INT((float)pixel->r*percent);
-    pixel->g = FLOAT_TO_INT((float)pixel->g*percent);
-    pixel->b = FLOAT_TO_INT((float)pixel->b*percent);
+bool led_blank(uint32_t now_ms) {
+    if (!effect_step_due(now_ms, 50)) return false; // This one doesn't need an adjustable delay
+    led_blank_pixel(fx.step);
+    fx.step = (fx.step + 1) % strip.length;
+    return true;
 }
 
-void led_color(void *event_ctx) {
-    // Convert the hex to r, g, and b codes we can send to the strip...
-    char *nohash = substring(led_palette, 1, 6); // Remove the leading #
-    int r, g, b;
-    sscanf(nohash, "%02x%02x%02x", &r, &g, &b);
-//     printf("r, g, b = %d, %d, %d\n", r, g, b);
-    uint16_t step = 0;
-    esp_err_t err;
-    while (true) { // infinite loop because that's how tasks work
-        while (step < strip.length) {
-            dled_pixel_set(&strip.pixels[step], g, r, b); // WS2811 are GRB
-            led_set_brightness(&strip.pixels[step], led_brightness);
-            dled_strip_fill_buffer(rps.strip); // Do them one at a time to make it smooooooth and cool
-            err = rmt_dled_send(&rps);
-            if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-            step++;
-        }
-        delay_ms(effect_speed_delay);
-        step = 0;
-    }
+static void led_color_pixel(uint32_t idx) {
+    dled_pixel_set(&strip.pixels[idx], params.r, params.g, params.b);
+    dled_strip_mark_dirty(&strip, idx, 1);
+}
+
+bool led_color(uint32_t now_ms) {
+    // Do them a few at a time to make it smooooooth and cool
+    return effect_wipe(now_ms, params.speed_delay, led_color_pixel);
 }
 
 // Enumerate the LEDs forwards and backwards using solid color mode
-void led_enumerate(void *event_ctx) {
-    // Convert the hex to r, g, and b codes we can send to the strip...
-    char *nohash = substring(led_palette, 1, 6); // Remove the leading #
-    int r, g, b;
-    sscanf(nohash, "%02x%02x%02x", &r, &g, &b);
-    uint16_t step = 0;
-    bool step_reverse = false;
-    esp_err_t err;
+void led_enumerate_init(uint32_t now_ms) {
+    effect_init_state(now_ms);
     // Start by setting the first pixel of the array to green and all others off
-    dled_pixel_set(&strip.pixels[0], 255, 0, 0);
-    led_set_brightness(&strip.pixels[0], led_brightness);
-    for (int i = 1; i < strip.length; i++) {
-        dled_pixel_set(&strip.pixels[i], 0, 0, 0); // WS2811 are GRB
+    dled_pixel_set(&strip.pixels[0], 0, 255, 0);
+    for (uint32_t i = 1; i < strip.length; i++) {
+        dled_pixel_set(&strip.pixels[i], 0, 0, 0);
     }
-    while (true) { // infinite loop because that's how tasks work
-        while (step < strip.length) {
-            dled_strip_fill_buffer(rps.strip); // Do them one at a time to make it smooooooth and cool
-            err = rmt_dled_send(&rps);
-            if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-            if (step_reverse) {
-                rotate_pixels_reverse(strip.pixels, strip.length);
-            } else {
-                rotate_pixels(strip.pixels, strip.length);
-            }
-            step++;
-            delay_ms(effect_speed_delay);
-        }
-        if (step_reverse) {
-            step_reverse = false;
-        } else {
-            step_reverse = true;
-        }
-        step = 0;
-        if (strip.pixels[0].r > 0) { // Red mode, switch to green
-            dled_pixel_set(&strip.pixels[0], 0, 255, 0);
-        } else if (strip.pixels[0].g > 0) { // Green mode, switch to blue
-            dled_pixel_set(&strip.pixels[0], 0, 0, 255);
-        } else if (strip.pixels[0].b > 0) { // Blue mode, switch to red
+    dled_strip_mark_all_dirty(&strip);
+}
+
+bool led_enumerate(uint32_t now_ms) {
+    if (!effect_step_due(now_ms, params.speed_delay)) return false;
+    if (fx.step >= strip.length) {
+        fx.reverse = !fx.reverse;
+        fx.step = 0;
+        if (strip.pixels[0].g > 0) { // Green mode, switch to red
             dled_pixel_set(&strip.pixels[0], 255, 0, 0);
+        } else if (strip.pixels[0].r > 0) { // Red mode, switch to blue
+            dled_pixel_set(&strip.pixels[0], 0, 0, 255);
+        } else if (strip.pixels[0].b > 0) { // Blue mode, switch to green
+            dled_pixel_set(&strip.pixels[0], 0, 255, 0);
         }
+        dled_strip_mark_dirty(&strip, 0, 1);
+    }
+    if (fx.reverse) {
+        dled_strip_set_offset(&strip, strip.offset + strip.source_length - 1);
+    } else {
+        dled_strip_set_offset(&strip, strip.offset + 1);
     }
+    fx.step++;
+    return true;
 }
 
 // Uses the current palette to twinkle random LEDs on and off
-void led_twinkle(void *event_ctx) {
-    uint16_t step = 0;
-    esp_err_t err;
-    while (true) { // infinite loop because that's how tasks work
-        while (step < strip.length) {
-            // Convert the hex to r, g, and b codes we can send to the strip...
-            char *nohash = substring(led_palette, 1, 6); // Remove the leading #
-            int r, g, b;
-            sscanf(nohash, "%02x%02x%02x", &r, &g, &b);
-            uint16_t val = random(1, 100);
-            if (val < twinkly) {
-                dled_pixel_set(&strip.pixels[step], g, r, b); // WS2811 are GRB
-            } else {
-                dled_pixel_set(&strip.pixels[step], 0, 0, 0); // Turn this pixel off
-            }
-            led_set_brightness(&strip.pixels[step], led_brightness);
-            err = rmt_dled_send(&rps);
-            if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-            dled_strip_fill_buffer(rps.strip);
-            step++;
-        }
-        delay_ms(effect_speed_delay*4);
-        step = 0;
+static void led_twinkle_pixel(uint32_t idx) {
+    uint8_t val = 1 + dled_scale8(esp_random(), 99); // 1 to 100 without a divide
+    if (val < twinkly) {
+        dled_pixel_set(&strip.pixels[idx], params.r, params.g, params.b);
+    } else {
+        dled_pixel_set(&strip.pixels[idx], 0, 0, 0); // Turn this pixel off
     }
+    dled_strip_mark_dirty(&strip, idx, 1);
 }
 
-void led_marquee(void *event_ctx) {
-    uint16_t step = 0;
-    esp_err_t err;
-    char *nohash = substring(led_palette, 1, 6); // Remove the leading #
-    int r, g, b;
-    sscanf(nohash, "%02x%02x%02x", &r, &g, &b); // Converts strings like "FF00FF" to rgb values from 0-255
-    // Start by filling the pixels array with our marquee sequence (every 3rd pixel off)
-    // Every 3rd pixel is turned on
-    for (int i = 0; i < strip.length; i++) {
-        if (i % 3 == 0) {
-            dled_pixel_set(&strip.pixels[i], g, r, b); // WS2811 are GRB
-            led_set_brightness(&strip.pixels[i], led_brightness);
-        } else {
-            dled_pixel_set(&strip.pixels[i], 0, 0, 0); // WS2811 are GRB
-        }
-    }
+bool led_twinkle(uint32_t now_ms) {
+    return effect_wipe(now_ms, params.speed_delay*4, led_twinkle_pixel);
+}
+
+void led_marquee_init(uint32_t now_ms) {
+    effect_init_state(now_ms);
+    // The marquee sequence is just 3 pixels (every 3rd pixel on) repeated over the whole strip
+    dled_strip_set_transform(&strip, false, false, 3);
+    dled_pixel_set(&strip.pixels[0], params.r, params.g, params.b);
+    dled_pixel_set(&strip.pixels[1], 0, 0, 0);
+    dled_pixel_set(&strip.pixels[2], 0, 0, 0);
+}
+
+// The color is in the sequence, so a new one has to be put there
+void led_marquee_update(void) {
+    dled_pixel_set(&strip.pixels[0], params.r, params.g, params.b);
+    dled_strip_mark_all_dirty(&strip);
+}
+
+bool led_marquee(uint32_t now_ms) {
+    if (!effect_step_due(now_ms, params.speed_delay)) return false;
+    dled_strip_set_offset(&strip, strip.offset + 1); // Moves the whole sequence
+    return true;
+}
+
+// Indexed by led_effect
+static const effect_t effects[] = {
+    [OFF]             = { "blank",           effect_init_state,  led_blank,           NULL,                 NULL },
+    [COLOR]           = { "color",           effect_init_state,  led_color,           NULL,                 NULL },
+    [RAINBOW]         = { "rainbow",         led_rainbow_init,   led_rainbow,         led_rainbow_teardown, NULL },
+    [ENUMERATE]       = { "enumerate",       led_enumerate_init, led_enumerate,       NULL,                 NULL },
+    [MARQUEE]         = { "marquee",         led_marquee_init,   led_marquee,         NULL,                 led_marquee_update },
+    [TWINKLE]         = { "twinkle",         effect_init_state,  led_twinkle,         NULL,                 NULL },
+    [RAINBOW_MARQUEE] = { "rainbow_marquee", effect_init_state,  led_rainbow_marquee, NULL,                 NULL },
+};
+
+/*
+  The one and only LED task.  Renders a frame every RENDER_FRAME_MS and sends it
+  while the next one is rendered.  The commands sent since the last frame are
+  applied first, only the latest of every kind, so a burst of them costs one
+  change per frame.  Effects are switched between two frames when showtime()
+  asks for it or the effect setting changes, so nothing is interrupted in the
+  middle of a frame.  The other settings apply to the running effect.
+ */
+static void render_task(void *pvParameter) {
+    const effect_t *effect = NULL;
+    uint32_t settings_seen = 0;
+    bool first_frame = true;
+    TickType_t last_wake = xTaskGetTickCount();
+    esp_err_t err = ESP_OK;
     while (true) {
-        while (step < strip.length) {
-            rotate_pixels(strip.pixels, strip.length);
-            // Broken:
-//             dled_pixel_chase_pixels(strip.pixels, strip.length, led_brightness, step, leds_at_a_time);
-            dled_strip_fill_buffer(rps.strip); // Do them one at a time to make it smooooooth and cool
-            err = rmt_dled_send(&rps);
-            if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] rmt_dled_send failed", err); }
-            step++;
-            delay_ms(effect_speed_delay);
+        int64_t frame_start_us = esp_timer_get_time();
+        uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        bool changed = false;
+        dled_stats_frame_t frame;
+        dled_stats_frame_init(&frame);
+        uint8_t taken;
+        uint8_t settings_to_save = light_commands_drain(&light_commands, &light_settings, &taken);
+        if (settings_to_save) {
+            xEventGroupSetBits(settings_changed_group, settings_to_save); // Saved by settings_task
+        }
+        bool settings_changed = light_settings_changed(&light_settings, &settings_seen);
+        if (settings_changed) {
+            light_settings_get(&light_settings, &params);
+            // Brightness is applied by the output so changing it doesn't bother the effect
+            if (strip.max_cc_val != params.brightness) {
+                dled_strip_set_brightness(&strip, params.brightness);
+                changed = true;
+            }
+        }
+        if ((taken & LIGHT_COMMAND_BIT(LIGHT_COMMAND_RESTART)) || effect != &effects[params.effect]) {
+            if (effect && effect->teardown) {
+                effect->teardown();
+            }
+            effect = &effects[params.effect];
+            if (params.effect != OFF) {
+                __atomic_store_n(&prev_effect, params.effect, __ATOMIC_RELEASE); // What ON turns back on
+            }
+            effect->init(now_ms);
+            ESP_LOGI(TAG, "Switched to '%s' in %lld us", effect->name, esp_timer_get_time() - effect_requested_us);
+        } else if (settings_changed && effect->update) {
+            effect->update();
+            changed = true;
+        }
+        if (effect && effect->render(now_ms)) {
+            changed = true;
+        }
+        frame.stage_us[DLED_STATS_RENDER] = esp_timer_get_time() - frame_start_us;
+        if (changed) {
+            err = dled_output_send_async(&led_output);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "[0x%x] dled_output_send_async failed", err);
+                frame.dropped = true;
+            }
+            dled_output_timing_t timing;
+            if (err == ESP_OK && dled_output_timing(&led_output, &timing) == ESP_OK) {
+                frame.stage_us[DLED_STATS_FILL] = timing.fill_us;
+                frame.stage_us[DLED_STATS_ENCODE] = timing.encode_us;
+                if (timing.transmit_us > 0) { // Usually the previous frame's
+                    frame.stage_us[DLED_STATS_TRANSMIT] = timing.transmit_us;
+                }
+            }
+        }
+        if (first_frame && changed && err == ESP_OK) { // Sent, esp_timer starts at boot
+            ESP_LOGI(TAG, "First frame %lld us after boot", esp_timer_get_time());
+            first_frame = false;
+        }
+        if (esp_timer_get_time() - frame_start_us > RENDER_FRAME_MS * 1000) {
+            frame.dropped = true; // Missed its deadline
+        }
+        if (effect) {
+            dled_stats_add(&render_stats, effect - effects, &frame);
         }
-        step = 0;
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(RENDER_FRAME_MS));
     }
 }
 
@@ -489,244 +568,44 @@ void led_marquee(void *event_ctx) {
 //     }
 // }
 
-void read_flash_settings() {
-    ESP_LOGI(TAG, "Reading settings from NVS flash...");
-    nvs_handle storage_handle;
-    esp_err_t err;
-    err = nvs_open(broadway_nvs_namespace, NVS_READONLY, &storage_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!\n", esp_err_to_name(err));
-    } else {
-        // Read palette
-        size_t string_size;
-        err = nvs_get_str(storage_handle, "palette", NULL, &string_size); // Just gets the size
-        if (err != ESP_OK) { ESP_LOGE(TAG, "Reading palette setting failed: [0x%x]", err); }
-        char* palette_val = malloc(string_size);
-        err = nvs_get_str(storage_handle, "palette", palette_val, &string_size);
-        if (err != ESP_OK) { ESP_LOGE(TAG, "Reading palette setting failed: [0x%x]", err); }
-        switch (err) {
-            case ESP_OK:
-                ESP_LOGI(TAG, "Setting palette... %.*s", string_size, palette_val);
-                strcpy(led_palette, palette_val); // Apply the setting
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initalized yet; that's OK
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        free(palette_val); // Clean up
-        uint8_t speed_val = 0;
-        err = nvs_get_u8(storage_handle, "speed", &speed_val);
-        switch (err) {
-            case ESP_OK:
-                effect_speed_delay = speed_val; // Apply the setting
-                ESP_LOGI(TAG, "Setting speed... %d", effect_speed_delay);
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initalized yet; that's OK
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        uint8_t brightness_val = 0;
-        err = nvs_get_u8(storage_handle, "brightness", &brightness_val);
-        switch (err) {
-            case ESP_OK:
-                led_brightness = brightness_val; // Apply the setting
-                ESP_LOGI(TAG, "Setting brightness... %d", led_brightness);
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initalized yet; that's OK
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        uint8_t effect_val = 0;
-        err = nvs_get_u8(storage_handle, "effect", &effect_val);
-        ESP_LOGI(TAG, "Stored effect val: %d", effect_val);
-        switch (err) {
-            case ESP_OK:
-                current_effect = (led_effect)effect_val; // Apply the setting
-                ESP_LOGI(TAG, "Starting effect: %d", current_effect);
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initalized yet; that's OK
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        // Close/cleanup
-        nvs_close(storage_handle);
-    }
-    ESP_LOGI(TAG, "Settings loaded!");
-}
-
-void store_palette() {
-    nvs_handle storage_handle;
-    esp_err_t err;
-    err = nvs_open(broadway_nvs_namespace, NVS_READWRITE, &storage_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!\n", esp_err_to_name(err));
-    } else {
-        // Read
-        size_t string_size;
-        bool needs_write = false;
-        err = nvs_get_str(storage_handle, "palette", NULL, &string_size);
-        char* palette_val = malloc(string_size);
-        err = nvs_get_str(storage_handle, "palette", palette_val, &string_size);
-        switch (err) {
-            case ESP_OK:
-                needs_write = true;
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initialized yet (that's OK)
-                needs_write = true;
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        if (needs_write) {
-            // Write
-            if (strcmp(led_palette, palette_val) != 0) {
-                err = nvs_set_str(storage_handle, "palette", led_palette);
-                err = nvs_commit(storage_handle);
-            }
-        }
-        // Close
-        free(palette_val);
-        nvs_close(storage_handle);
-    }
-}
-
-void store_speed() {
-    nvs_handle storage_handle;
-    esp_err_t err;
-    err = nvs_open(broadway_nvs_namespace, NVS_READWRITE, &storage_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!\n", esp_err_to_name(err));
-    } else {
-        // Read
-        bool needs_write = false;
-        uint8_t speed_val = 0;
-        err = nvs_get_u8(storage_handle, "speed", &speed_val);
-        switch (err) {
-            case ESP_OK:
-                needs_write = true;
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initialized yet (that's OK)
-                needs_write = true;
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        if (needs_write) {
-            // Write
-            if (speed_val != effect_speed_delay) {
-                err = nvs_set_u8(storage_handle, "speed", effect_speed_delay);
-                err = nvs_commit(storage_handle);
-            }
-        }
-        // Close
-        nvs_close(storage_handle);
-    }
+void showtime() {
+//     ESP_LOGI(TAG, "Showtime!");
+    // (Re)start the current effect at the next frame
+    effect_requested_us = esp_timer_get_time();
+    light_commands_send(&light_commands, LIGHT_COMMAND_RESTART, 0);
 }
 
-void store_brightness() {
-    nvs_handle storage_handle;
-    esp_err_t err;
-    err = nvs_open(broadway_nvs_namespace, NVS_READWRITE, &storage_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!\n", esp_err_to_name(err));
-    } else {
-        // Read
-        bool needs_write = false;
-        uint8_t brightness_val = 0;
-        err = nvs_get_u8(storage_handle, "brightness", &brightness_val);
-        switch (err) {
-            case ESP_OK:
-                needs_write = true;
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initialized yet (that's OK)
-                needs_write = true;
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        if (needs_write) {
-            // Write
-            if (brightness_val != led_brightness) {
-                err = nvs_set_u8(storage_handle, "brightness", led_brightness);
-                err = nvs_commit(storage_handle);
+/*
+  Saves the settings the render task changed, away from the MQTT client and the
+  touch pads so a burst of commands doesn't wait for the flash.  They are saved
+  together, once nothing changed for CONFIG_SETTINGS_SAVE_DELAY seconds (or at
+  the latest four times that after the first change, for a touch pad held down).
+ */
+static void settings_task(void *pvParameter) {
+    const EventBits_t all = LIGHT_COMMAND_BIT(LIGHT_COMMAND_COLOR) | LIGHT_COMMAND_BIT(LIGHT_COMMAND_SPEED)
+                          | LIGHT_COMMAND_BIT(LIGHT_COMMAND_BRIGHTNESS) | LIGHT_COMMAND_BIT(LIGHT_COMMAND_EFFECT);
+    const TickType_t quiet = pdMS_TO_TICKS(CONFIG_SETTINGS_SAVE_DELAY * 1000);
+    TickType_t dirty_since = 0;
+    while (true) {
+        bool dirty = light_store_dirty(&light_store) != 0;
+        EventBits_t changed = xEventGroupWaitBits(settings_changed_group, all, pdTRUE, pdFALSE, dirty ? quiet : portMAX_DELAY);
+        changed &= all;
+        if (changed) {
+            if (!dirty) {
+                dirty_since = xTaskGetTickCount();
             }
-        }
-        // Close
-        nvs_close(storage_handle);
-    }
-}
-
-void store_effect() {
-    nvs_handle storage_handle;
-    esp_err_t err;
-    err = nvs_open(broadway_nvs_namespace, NVS_READWRITE, &storage_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!\n", esp_err_to_name(err));
-    } else {
-        // Read
-        bool needs_write = false;
-        uint8_t effect_val = 0;
-        err = nvs_get_u8(storage_handle, "effect", &effect_val);
-        switch (err) {
-            case ESP_OK:
-                needs_write = true;
-                break;
-            case ESP_ERR_NVS_NOT_FOUND: // Not initialized yet (that's OK)
-                needs_write = true;
-                break;
-            default :
-                ESP_LOGE(TAG, "Error (%s) reading!\n", esp_err_to_name(err));
-        }
-        if (needs_write) {
-            // Write
-            if (effect_val != current_effect) {
-                err = nvs_set_u8(storage_handle, "effect", (uint8_t)current_effect);
-                err = nvs_commit(storage_handle);
+            light_store_mark(&light_store, changed);
+            if (xTaskGetTickCount() - dirty_since < quiet * 4) {
+                continue; // Wait for the changes to stop
             }
         }
-        // Close
-        nvs_close(storage_handle);
+        light_store_flush(&light_store, &light_settings);
     }
 }
 
-void showtime() {
-//     ESP_LOGI(TAG, "Showtime!");
-    // End any running effect task
-    if (led_task_handle) {
-//         printf("Calling vTaskDelete on the existing task.\n");
-        vTaskDelete(led_task_handle);
-        led_task_handle = NULL;
-    }
-    // (Re)start any effects
-    if (current_effect == OFF) {
-        ESP_LOGI(TAG, "Turning the lights off...");
-        xTaskCreate(led_blank, "blank", STACK_SIZE, NULL, LED_TASK_PRIORITY, &led_task_handle);
-    } else if (current_effect == ENUMERATE) {
-        ESP_LOGI(TAG, "Creating 'enumerate' task...");
-        xTaskCreate(led_enumerate, "enumerate", STACK_SIZE, NULL, LED_TASK_PRIORITY, &led_task_handle);
-    } else if (current_effect == COLOR) {
-        ESP_LOGI(TAG, "Creating 'color' task...");
-        xTaskCreate(led_color, "color", STACK_SIZE, NULL, LED_TASK_PRIORITY, &led_task_handle);
-    } else if (current_effect == RAINBOW) {
-        ESP_LOGI(TAG, "Creating 'rainbow' task...");
-        xTaskCreate(led_rainbow, "rainbow", STACK_SIZE, NULL, LED_TASK_PRIORITY, &led_task_handle);
-    } else if (current_effect == TWINKLE) {
-        ESP_LOGI(TAG, "Creating 'twinkle' task...");
-        xTaskCreate(led_twinkle, "twinkle", STACK_SIZE, NULL, LED_TASK_PRIORITY, &led_task_handle);
-    } else if (current_effect == MARQUEE) {
-        ESP_LOGI(TAG, "Creating 'marquee' task...");
-        xTaskCreate(led_marquee, "marquee", STACK_SIZE, NULL, LED_TASK_PRIORITY, &led_task_handle);
-    } else if (current_effect == RAINBOW_MARQUEE) {
-        ESP_LOGI(TAG, "Creating 'rainbow_marquee' task...");
-        xTaskCreate(led_rainbow_marquee, "rainbow_marquee", STACK_SIZE, NULL, LED_TASK_PRIORITY, &led_task_handle);
-    }
-    if (current_effect != OFF) {
-        prev_effect = current_effect;
-    }
+// Saves what is waiting before esp_restart() (a brownout resets without calling this)
+static void settings_shutdown(void) {
+    light_store_flush(&light_store, &light_settings);
 }
 
 static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event) {
@@ -746,13 +625,7 @@ static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event) {
             break;
         case MQTT_EVENT_SUBSCRIBED:
             ESP_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
-            // End any running effect task (if this is a re-sub situation)
-            if (led_task_handle) {
-                printf("Calling vTaskDelete on the existing task.\n");
-                vTaskDelete(led_task_handle);
-                led_task_handle = NULL;
-            }
-            new_effect = true; // Make sure everything starts properly
+            new_effect = true; // Make sure everything starts properly (if this is a re-sub situation)
             break;
         case MQTT_EVENT_UNSUBSCRIBED:
             ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
@@ -769,55 +642,53 @@ static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event) {
             if (strncmp(event->topic, CONFIG_MQTT_TOPIC_MODE, strlen(CONFIG_MQTT_TOPIC_MODE)) == 0) {
                 // Start the new requested effect
                 if (strncmp(event->data, "rainbow", 7) == 0) {
-                    current_effect = RAINBOW;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, RAINBOW);
                 } else if (strncmp(event->data, "color", 5) == 0) {
-                    current_effect = COLOR;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, COLOR);
                 }  else if (strncmp(event->data, "enumerate", 4) == 0) {
-                    current_effect = ENUMERATE;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, ENUMERATE);
                 } else if (strncmp(event->data, "twinkle", 7) == 0) {
-                    current_effect = TWINKLE;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, TWINKLE);
                 } else if (strncmp(event->data, "marquee", 7) == 0) {
-                    current_effect = MARQUEE;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, MARQUEE);
                 } else if (strncmp(event->data, "rmarquee", 8) == 0) {
-                    current_effect = RAINBOW_MARQUEE;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, RAINBOW_MARQUEE);
                 }
-                store_effect(); // Save the running effect to NVS flash
                 new_effect = true;
             // Set the lights on or off (it's actually just a different "effect"):
             } else if (strncmp(event->topic, CONFIG_MQTT_TOPIC_CONTROL, strlen(CONFIG_MQTT_TOPIC_CONTROL)) == 0) {
                 if (strncmp(event->data, "OFF", 3) == 0) {
-                    current_effect = OFF;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, OFF);
                 } else if (strncmp(event->data, "ON", 2) == 0) {
-                    current_effect = prev_effect;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, prev_effect_get());
                 }
-                store_effect(); // Save the running effect to NVS flash
                 new_effect = true;
             } else if (strncmp(event->topic, CONFIG_MQTT_TOPIC_COLOR, strlen(CONFIG_MQTT_TOPIC_COLOR)) == 0) {
-                strncpy(led_palette, event->data, event->data_len); // Set the palette
-                store_palette(); // Save the new palette to NVS flash
-                new_effect = true;
+                // Parsed once here, a payload which isn't a color is ignored
+                uint8_t r, g, b;
+                if (light_settings_parse_color(event->data, event->data_len, &r, &g, &b) == ESP_OK) {
+                    light_commands_send(&light_commands, LIGHT_COMMAND_COLOR, (r << 16) | (g << 8) | b);
+                } else {
+                    ESP_LOGW(TAG, "Not a color: '%.*s'", event->data_len, event->data);
+                }
             } else if (strncmp(event->topic, CONFIG_MQTT_TOPIC_SPEED, strlen(CONFIG_MQTT_TOPIC_SPEED)) == 0) {
                 int i = atoi(event->data);
                 if (i >= 0 && i <= 255) {
                     i = 255 - i; // Convert speed to ms delay
                     if (i == 0) {
-                        effect_speed_delay = 10; // Make it at least ten
+                        light_commands_send(&light_commands, LIGHT_COMMAND_SPEED, 10); // Make it at least ten
                     } else {
-                        effect_speed_delay = i;
+                        light_commands_send(&light_commands, LIGHT_COMMAND_SPEED, i);
                     }
                 }
-                store_speed(); // Save the current speed to NVS flash
-                new_effect = true;
             } else if (strncmp(event->topic, CONFIG_MQTT_TOPIC_BRIGHTNESS, strlen(CONFIG_MQTT_TOPIC_BRIGHTNESS)) == 0) {
-                char *temp = substring(event->data, 0, event->data_len);
+                char temp[4] = { 0 };
+                strncpy(temp, event->data, event->data_len < 3 ? event->data_len : 3);
                 int i = atoi(temp);
                 if (i > 0 && i <= 255) {
-                    printf("Setting led_brightness (i)=%d\n", i);
-                    led_brightness = i;
-                    strip.max_cc_val = led_brightness;
+                    ESP_LOGD(TAG, "Setting brightness to %d", i);
+                    light_commands_send(&light_commands, LIGHT_COMMAND_BRIGHTNESS, i);
                 }
-                store_brightness(); // Store the current brightness level to NVS flash
-                new_effect = true;
             }
             break;
         case MQTT_EVENT_ERROR:
@@ -830,6 +701,54 @@ static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event) {
     return ESP_OK;
 }
 
+#if CONFIG_TELEMETRY_PERIOD > 0
+/*
+  Publishes the render statistics of every effect which rendered frames to
+  CONFIG_MQTT_TOPIC_TELEMETRY/<effect> every CONFIG_TELEMETRY_PERIOD seconds,
+  then starts them again. The use of the memory goes to CONFIG_MQTT_TOPIC_TELEMETRY/heap,
+  the NVS commits of the settings to CONFIG_MQTT_TOPIC_TELEMETRY/settings.
+ */
+#define TELEMETRY_PAYLOAD_SIZE (DLED_STATS_EFFECT_JSON_SIZE > BOOT_ARENA_JSON_SIZE ? DLED_STATS_EFFECT_JSON_SIZE : BOOT_ARENA_JSON_SIZE)
+static void telemetry_task(void *pvParameter) {
+    esp_mqtt_client_handle_t client = (esp_mqtt_client_handle_t)pvParameter;
+    dled_stats_effect_t *stats = boot_arena_alloc(sizeof(dled_stats_effect_t), BOOT_ARENA_INTERNAL);
+    char *payload = boot_arena_alloc(TELEMETRY_PAYLOAD_SIZE, BOOT_ARENA_INTERNAL);
+    char topic[64];
+    if (stats == NULL || payload == NULL) {
+        ESP_LOGE(TAG, "Not enough memory for the telemetry");
+        vTaskDelete(NULL);
+        return;
+    }
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_TELEMETRY_PERIOD * 1000));
+        int len = boot_arena_json(payload, TELEMETRY_PAYLOAD_SIZE);
+        if (len >= 0) {
+            snprintf(topic, sizeof(topic), "%s/heap", CONFIG_MQTT_TOPIC_TELEMETRY);
+            esp_mqtt_client_publish(client, topic, payload, len, 0, 0);
+        }
+        len = light_store_json(&light_store, payload, TELEMETRY_PAYLOAD_SIZE);
+        if (len >= 0) {
+            snprintf(topic, sizeof(topic), "%s/settings", CONFIG_MQTT_TOPIC_TELEMETRY);
+            esp_mqtt_client_publish(client, topic, payload, len, 0, 0);
+        }
+        for (uint8_t i = 0; i < render_stats.count; i++) {
+            dled_stats_read(&render_stats, DLED_STATS_PERIOD, i, stats);
+            if (stats->frames == 0) {
+                continue;
+            }
+            len = dled_stats_effect_json(render_stats.names[i], stats, payload, TELEMETRY_PAYLOAD_SIZE);
+            if (len < 0) {
+                continue;
+            }
+            snprintf(topic, sizeof(topic), "%s/%s", CONFIG_MQTT_TOPIC_TELEMETRY, render_stats.names[i]);
+            if (esp_mqtt_client_publish(client, topic, payload, len, 0, 0) < 0) {
+                ESP_LOGW(TAG, "Telemetry for '%s' not published", render_stats.names[i]);
+            }
+        }
+    }
+}
+#endif
+
 static void mqtt_app_start(void) {
     ESP_LOGI(TAG, "Waiting for Wifi before starting MQTT client...");
     xEventGroupWaitBits(
@@ -878,6 +797,9 @@ static void mqtt_app_start(void) {
     esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
     ESP_LOGI(TAG, "MQTT Connecting to broker: [%s]", CONFIG_BROKER_URL);
     esp_mqtt_client_start(client);
+#if CONFIG_TELEMETRY_PERIOD > 0
+    xTaskCreate(&telemetry_task, "telemetry", 3072, client, 5, NULL);
+#endif
 }
 
 /*
@@ -893,9 +815,10 @@ static void tp_read_task(void *pvParameter) {
     uint16_t delay = 200; // ms delay between loops/checks
     uint16_t long_press0 = 0; // Used to detect a long press on the power touch button (and to de-bounce)
     uint16_t long_press2 = 0; // Really just used to de-bounce this touch pad
-    uint16_t long_press3 = 0; // Only used to detect when brightness adjustment is done
     // NOTE: We don't bother detecting long press on TOUCH3 (brightness) because it doesn't make (much) sense
+    light_settings_t current; // What the touch pads change, read once per loop through the sequence lock
     while (true) {
+        light_settings_get(&light_settings, &current);
         touch_pad_read_raw_data(TOUCH0, &touch_value);
         // NOTE: Filter was too slow in my testing.  Makes more sense with constant-touch situations:
 //         touch_pad_read_filtered(i, &touch_value);
@@ -905,17 +828,13 @@ static void tp_read_task(void *pvParameter) {
             long_press0 += delay; // Increment
             if (long_press0 < delay*2) { // De-bounce (and don't go nuts changing modes while the user presses a touch pad)
                 touched = true;
-                if (current_effect == OFF) {
-                    current_effect = prev_effect;
-                    if (current_effect == OFF) { // Previous effect *was* OFF
-                        current_effect = RAINBOW; // Start anew
-                    }
-                    prev_effect = OFF;
+                if (current.effect == OFF) {
+                    // The render task keeps prev_effect, OFF if nothing else ran yet
+                    uint8_t on_effect = prev_effect_get();
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, on_effect == OFF ? RAINBOW : on_effect);
                 } else {
-                    prev_effect = current_effect;
-                    current_effect = OFF;
+                    light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, OFF);
                 }
-                store_effect(); // Save the running effect (ON or OFF) make to NVS flash
             }
         } else {
             long_press0 = 0; // No longer touching...  Reset the long press timer
@@ -927,15 +846,15 @@ static void tp_read_task(void *pvParameter) {
             long_press2 += delay; // Increment
             if (long_press2 < delay*2) { // De-bounce (and don't go nuts changing modes while the user presses a touch pad)
                 touched = true;
-                current_effect++;
-                if (current_effect == ENUMERATE) {
+                uint8_t next_effect = current.effect + 1;
+                if (next_effect == ENUMERATE) {
                     // This one is special; skip it
-                    current_effect++;
+                    next_effect++;
                 }
-                if (current_effect > 6) {
-                    current_effect = 1;
+                if (next_effect > RAINBOW_MARQUEE) {
+                    next_effect = COLOR;
                 }
-                store_effect(); // Save the running effect to NVS flash
+                light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, next_effect);
             }
         } else {
             long_press2 = 0; // No longer touching...  Reset the long press timer
@@ -943,36 +862,33 @@ static void tp_read_task(void *pvParameter) {
         touch_pad_read_raw_data(TOUCH3, &touch_value);
 //         printf(" T3:[%4d] ", touch_value);
         if (touch_value && touch_value < TOUCH_THRESHOLD) {
-        // Cycle brightness up until max then down until min
-            touched = true;
-            long_press3 += delay;
-            ESP_LOGI(TAG, "Adjusting brightness (%d) %s", led_brightness, led_brightness_up ? "up" : "down");
+        // Cycle brightness up until max then down until min (applies to the running effect)
+            uint8_t brightness = current.brightness;
+            ESP_LOGI(TAG, "Adjusting brightness (%d) %s", brightness, led_brightness_up ? "up" : "down");
             if (led_brightness_up) {
-                led_brightness += 10;
-                if (led_brightness > 245) {
-                    led_brightness = 255;
+                if (brightness > 235) {
+                    brightness = 255;
                     led_brightness_up = false;
+                } else {
+                    brightness += 10;
                 }
             } else {
-                led_brightness -= 10;
-                if (led_brightness < 10) {
-                    led_brightness = 10;
+                if (brightness < 20) {
+                    brightness = 10;
                     led_brightness_up = true;
+                } else {
+                    brightness -= 10;
                 }
             }
-        } else {
-            if (long_press3) {
-                store_brightness();
-            }
-            long_press3 = 0;
+            light_commands_send(&light_commands, LIGHT_COMMAND_BRIGHTNESS, brightness);
         }
         // Handle the long-press situation (reset the wifi preferences)
         if (long_press0 > LONG_PRESS_THRESHOLD && long_press0 < LONG_PRESS_THRESHOLD + (delay*2)) {
             ESP_LOGI(TAG, "Long press of power button detected.  Resetting wifi_manager...");
             long_press0 = LONG_PRESS_THRESHOLD + (delay*2) + 1; // Keep it stuck at threshold + delay*2 + 1 until touch state changes
             wifi_manager_disconnect_async(); // This disconnects the wifi and starts the AP back up (also erases the wifi_manager flash stuff)
-            strcpy(led_palette, "#FF0000");; // Set it to red to indicate something just happened
-            current_effect = ENUMERATE; // Set to enumerate mode to indicate what just happened
+            light_commands_send(&light_commands, LIGHT_COMMAND_COLOR, 0xff0000); // Set it to red to indicate something just happened
+            light_commands_send(&light_commands, LIGHT_COMMAND_EFFECT, ENUMERATE); // Set to enumerate mode to indicate what just happened
             showtime();
         } else if (touched) {
             showtime(); // Start/stop the LEDs
@@ -1053,8 +969,38 @@ void app_main() {
     /* initialize flash memory */
     nvs_flash_init();
 
-    // Read in settings from NVS
-    read_flash_settings();
+#if CONFIG_LED_BENCHMARK
+    dled_bench_run(); // Before the arena takes the memory
+#endif
+
+    // Every buffer kept until the next reboot comes from here, taken before the heap is cut in pieces
+    esp_err_t err = boot_arena_init(CONFIG_ARENA_INTERNAL_SIZE * 1024, CONFIG_ARENA_DMA_SIZE * 1024);
+    if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] boot_arena_init failed", err); } // The buffers come from the heap
+
+    // Read in settings from NVS (one record), over the defaults
+    light_settings_init(&light_settings, RAINBOW, sizeof(effects) / sizeof(effects[0]));
+    err = light_store_init(&light_store, broadway_nvs_namespace);
+    if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] light_store_init failed", err); }
+    light_store_load(&light_store, &light_settings); // Logs its own errors, the defaults are kept
+    esp_register_shutdown_handler(settings_shutdown);
+
+    // MQTT and the touch pads send their commands to the render task, which hands what changed to settings_task
+    err = light_commands_init(&light_commands, CONFIG_COMMAND_QUEUE_LENGTH);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "[0x%x] light_commands_init failed", err); // Nothing could change the lights
+        while(true) { }
+    }
+    settings_changed_group = xEventGroupCreate();
+    xTaskCreate(&settings_task, "settings", 3072, NULL, 2, &settings_task_handle);
+
+    // Render times, by effect
+    const char *effect_names[sizeof(effects) / sizeof(effects[0])];
+    for (uint8_t i = 0; i < sizeof(effects) / sizeof(effects[0]); i++) {
+        effect_names[i] = effects[i].name;
+    }
+    err = dled_stats_init(&render_stats, effect_names, sizeof(effects) / sizeof(effects[0]));
+    if (err != ESP_OK) { ESP_LOGE(TAG, "[0x%x] dled_stats_init failed", err); }
+    http_server_set_stats(&render_stats);
 
     /* start the HTTP Server task */
     xTaskCreate(&http_server, "http_server", 2048, NULL, 5, &task_http_server);
@@ -1081,7 +1027,11 @@ void app_main() {
     xTaskCreate(&tp_read_task, "touch_pad_read_task", 2048, NULL, 5, NULL);
 
     // Setup WS2811 pixel strip
-    initialize_leds(&rps, &strip);
+    initialize_leds(&leds, &strip, &led_output);
+    boot_arena_report(); // Tells if CONFIG_ARENA_INTERNAL_SIZE is too small
+
+    // Start the one task that renders all the effects
+    xTaskCreate(&render_task, "render", STACK_SIZE, NULL, LED_TASK_PRIORITY, &render_task_handle);
 
     // Start the light show immediately (so we don't NEED Internet before we start working)
     showtime();
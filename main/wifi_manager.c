@@ -51,6 +51,7 @@ Contains the freeRTOS task and all necessary support
 #include "json.h"
 #include "http_server.h"
 #include "wifi_manager.h"
+#include "boot_arena.h"
 
 
 
@@ -120,16 +121,16 @@ bool wifi_manager_flash_need_update(){
             flash_is_different = true;
         }
 
-        /* allocate buffer */
+        /* buffer large enough for every value */
         size_t sz = sizeof(wifi_settings);
-        uint8_t *buff = (uint8_t*)malloc(sizeof(uint8_t) * sz);
-        memset(buff, 0x00, sizeof(sz));
+        uint8_t buff[sizeof(wifi_settings)];
+        memset(buff, 0x00, sizeof(buff));
 
         /* ssid */
         sz = sizeof(wifi_manager_config_sta->sta.ssid);
         esp_err = nvs_get_blob(handle, "ssid", buff, &sz);
         if(esp_err != ESP_OK){
-            free(buff);
+            nvs_close(handle);
             return true;
         }
         if(bcmp(&wifi_manager_config_sta->sta.ssid, buff, sz)) flash_is_different = true;
@@ -138,7 +139,7 @@ bool wifi_manager_flash_need_update(){
         sz = sizeof(wifi_manager_config_sta->sta.password);
         esp_err = nvs_get_blob(handle, "password", buff, &sz);
         if(esp_err != ESP_OK){
-            free(buff);
+            nvs_close(handle);
             return true;
         }
         if(bcmp(&wifi_manager_config_sta->sta.password, buff, sz)) flash_is_different = true;
@@ -147,12 +148,11 @@ bool wifi_manager_flash_need_update(){
         sz = sizeof(wifi_settings);
         esp_err = nvs_get_blob(handle, "settings", buff, &sz);
         if(esp_err != ESP_OK){
-            free(buff);
+            nvs_close(handle);
             return true;
         }
         if(bcmp(&wifi_settings, buff, sz)) flash_is_different = true;
 
-        free(buff);
         nvs_close(handle);
         return flash_is_different;
     }
@@ -213,21 +213,21 @@ bool wifi_manager_fetch_wifi_sta_config(){
     if(nvs_open(wifi_manager_nvs_namespace, NVS_READONLY, &handle) == ESP_OK){
 
         if(wifi_manager_config_sta == NULL){
-            wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
+            wifi_manager_config_sta = (wifi_config_t*)boot_arena_alloc(sizeof(wifi_config_t), BOOT_ARENA_INTERNAL);
         }
         memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
         memset(&wifi_settings, 0x00, sizeof(struct wifi_settings_t));
 
-        /* allocate buffer */
+        /* buffer large enough for every value */
         size_t sz = sizeof(wifi_settings);
-        uint8_t *buff = (uint8_t*)malloc(sizeof(uint8_t) * sz);
-        memset(buff, 0x00, sizeof(sz));
+        uint8_t buff[sizeof(wifi_settings)];
+        memset(buff, 0x00, sizeof(buff));
 
         /* ssid */
         sz = sizeof(wifi_manager_config_sta->sta.ssid);
         esp_err = nvs_get_blob(handle, "ssid", buff, &sz);
         if(esp_err != ESP_OK){
-            free(buff);
+            nvs_close(handle);
             return false;
         }
         memcpy(wifi_manager_config_sta->sta.ssid, buff, sz);
@@ -236,7 +236,7 @@ bool wifi_manager_fetch_wifi_sta_config(){
         sz = sizeof(wifi_manager_config_sta->sta.password);
         esp_err = nvs_get_blob(handle, "password", buff, &sz);
         if(esp_err != ESP_OK){
-            free(buff);
+            nvs_close(handle);
             return false;
         }
         memcpy(wifi_manager_config_sta->sta.password, buff, sz);
@@ -245,12 +245,11 @@ bool wifi_manager_fetch_wifi_sta_config(){
         sz = sizeof(wifi_settings);
         esp_err = nvs_get_blob(handle, "settings", buff, &sz);
         if(esp_err != ESP_OK){
-            free(buff);
+            nvs_close(handle);
             return false;
         }
         memcpy(&wifi_settings, buff, sz);
 
-        free(buff);
         nvs_close(handle);
 
 #if WIFI_MANAGER_DEBUG
@@ -452,17 +451,7 @@ char* wifi_manager_get_ip_info_json(){
 
 void wifi_manager_destroy(){
 
-    /* heap buffers */
-    free(accessp_records);
-    accessp_records = NULL;
-    free(accessp_json);
-    accessp_json = NULL;
-    free(ip_info_json);
-    ip_info_json = NULL;
-    if(wifi_manager_config_sta){
-        free(wifi_manager_config_sta);
-        wifi_manager_config_sta = NULL;
-    }
+    /* the buffers come from the boot arena, they are kept for the next start of the task */
 
     /* RTOS objects */
     vSemaphoreDelete(wifi_manager_json_mutex);
@@ -478,12 +467,16 @@ void wifi_manager( void * pvParameters ){
 
     /* memory allocation of objects used by the task */
     wifi_manager_json_mutex = xSemaphoreCreateMutex();
-    accessp_records = (wifi_ap_record_t*)malloc(sizeof(wifi_ap_record_t) * MAX_AP_NUM);
-    accessp_json = (char*)malloc(MAX_AP_NUM * JSON_ONE_APP_SIZE + 4); //4 bytes for json encapsulation of "[\n" and "]\0"
+    if(accessp_records == NULL){
+        accessp_records = (wifi_ap_record_t*)boot_arena_alloc(sizeof(wifi_ap_record_t) * MAX_AP_NUM, BOOT_ARENA_INTERNAL);
+        accessp_json = (char*)boot_arena_alloc(MAX_AP_NUM * JSON_ONE_APP_SIZE + 4, BOOT_ARENA_INTERNAL); //4 bytes for json encapsulation of "[\n" and "]\0"
+        ip_info_json = (char*)boot_arena_alloc(sizeof(char) * JSON_IP_INFO_SIZE, BOOT_ARENA_INTERNAL);
+    }
     wifi_manager_clear_access_points_json();
-    ip_info_json = (char*)malloc(sizeof(char) * JSON_IP_INFO_SIZE);
     wifi_manager_clear_ip_info_json();
-    wifi_manager_config_sta = (wifi_config_t*)malloc(sizeof(wifi_config_t));
+    if(wifi_manager_config_sta == NULL){
+        wifi_manager_config_sta = (wifi_config_t*)boot_arena_alloc(sizeof(wifi_config_t), BOOT_ARENA_INTERNAL);
+    }
     memset(wifi_manager_config_sta, 0x00, sizeof(wifi_config_t));
     memset(&wifi_settings.sta_static_ip_config, 0x00, sizeof(tcpip_adapter_ip_info_t));
         IP4_ADDR(&wifi_settings.sta_static_ip_config.ip, 192, 168, 0, 10);
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""
+Reads the LED frame recordings written by the virtual output (main/dled_virtual.h).
+
+    dled_frames.py info  recording.bin
+    dled_frames.py png   recording.bin strip.png [--scale 4] [--first 0] [--count 500]
+    dled_frames.py diff  before.bin after.bin
+
+`png` draws one row per frame and one column per LED, in the colors the LEDs were
+sent (after brightness and gamma).  `diff` compares the LED data of two recordings,
+ignoring the times, and exits with 1 if they differ so it can be used in scripts.
+Only the Python standard library is used.
+"""
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = b'DLED'
+VERSION = 1
+FLAG_ITEMS = 0x01
+
+
+class Recording(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if len(self.data) < 16 or self.data[:4] != MAGIC:
+            raise ValueError('%s is not a LED recording' % path)
+        (self.version, self.flags, self.bytes_per_led, order, self.length) = \
+            struct.unpack_from('<BBB4sxI', self.data, 4)
+        if self.version != VERSION:
+            raise ValueError('%s: unknown version %d' % (path, self.version))
+        self.wire_order = bytearray(order)[:self.bytes_per_led]
+        self.frame_size = self.length * self.bytes_per_led
+
+    def frames(self):
+        """Yields (time_us, led_data, items) for every frame, items is None if not recorded"""
+        pos = 16
+        while pos + 8 + self.frame_size <= len(self.data):
+            (time_us,) = struct.unpack_from('<Q', self.data, pos)
+            pos += 8
+            led_data = self.data[pos:pos + self.frame_size]
+            pos += self.frame_size
+            items = None
+            if self.flags & FLAG_ITEMS:
+                (count,) = struct.unpack_from('<I', self.data, pos)
+                pos += 4
+                items = struct.unpack_from('<%dI' % count, self.data, pos)
+                pos += 4 * count
+            yield time_us, led_data, items
+
+    def rgb(self, led_data):
+        """The colors shown by the LEDs, the white LED is added to the three others"""
+        row = bytearray()
+        for i in range(self.length):
+            color = [0, 0, 0, 0]
+            for k, component in enumerate(self.wire_order):
+                color[component] = led_data[i * self.bytes_per_led + k]
+            row.extend(min(255, c + color[3]) for c in color[:3])
+        return row
+
+
+def write_png(path, width, rows, scale):
+    def chunk(kind, payload):
+        return struct.pack('>I', len(payload)) + kind + payload + \
+            struct.pack('>I', zlib.crc32(kind + payload) & 0xffffffff)
+
+    raw = bytearray()
+    for row in rows:
+        line = bytearray()
+        for x in range(width):
+            line.extend(row[x * 3:x * 3 + 3] * scale)
+        for _ in range(scale):
+            raw.append(0)  # no filter
+            raw.extend(line)
+    header = struct.pack('>IIBBBBB', width * scale, len(rows) * scale, 8, 2, 0, 0, 0)
+    with open(path, 'wb') as f:
+        f.write(b'\x89PNG\r\n\x1a\n')
+        f.write(chunk(b'IHDR', header))
+        f.write(chunk(b'IDAT', zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b'IEND', b''))
+
+
+def info(args):
+    rec = Recording(args.recording)
+    times = [t for t, _, _ in rec.frames()]
+    print('LEDs:          %d' % rec.length)
+    print('Bytes per LED: %d, wire order %s' % (rec.bytes_per_led, ''.join('RGBW'[c] for c in rec.wire_order)))
+    print('RMT items:     %s' % ('yes' if rec.flags & FLAG_ITEMS else 'no'))
+    print('Frames:        %d' % len(times))
+    if len(times) > 1:
+        gaps = [b - a for a, b in zip(times, times[1:])]
+        duration = (times[-1] - times[0]) / 1e6
+        print('Duration:      %.3f s, %.1f frames/s' % (duration, (len(times) - 1) / duration if duration else 0))
+        print('Frame gap:     min %d us, average %d us, max %d us' % (min(gaps), sum(gaps) // len(gaps), max(gaps)))
+    return 0
+
+
+def png(args):
+    rec = Recording(args.recording)
+    rows = []
+    for n, (_, led_data, _) in enumerate(rec.frames()):
+        if n < args.first:
+            continue
+        if args.count and len(rows) >= args.count:
+            break
+        rows.append(rec.rgb(led_data))
+    if not rows:
+        print('No frames to draw')
+        return 1
+    write_png(args.png, rec.length, rows, args.scale)
+    print('Wrote %d frames of %d LEDs to %s' % (len(rows), rec.length, args.png))
+    return 0
+
+
+def diff(args):
+    a = Recording(args.before)
+    b = Recording(args.after)
+    if (a.length, a.bytes_per_led, a.wire_order) != (b.length, b.bytes_per_led, b.wire_order):
+        print('The recordings are of different strips')
+        return 1
+    differences = 0
+    count = 0
+    for n, ((_, da, _), (_, db, _)) in enumerate(zip(a.frames(), b.frames())):
+        count += 1
+        if da != db:
+            if differences < 10:
+                first = next(i for i in range(len(da)) if da[i] != db[i])
+                print('Frame %d differs, first at LED %d' % (n, first // a.bytes_per_led))
+            differences += 1
+    frames_a = sum(1 for _ in a.frames())
+    frames_b = sum(1 for _ in b.frames())
+    if frames_a != frames_b:
+        print('Frame counts differ: %d and %d' % (frames_a, frames_b))
+        differences += 1
+    print('%d of %d frames differ' % (differences, count) if differences else 'Same %d frames' % count)
+    return 1 if differences else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='LED frame recordings of the virtual output')
+    commands = parser.add_subparsers(dest='command')
+    cmd = commands.add_parser('info', help='describe a recording')
+    cmd.add_argument('recording')
+    cmd.set_defaults(func=info)
+    cmd = commands.add_parser('png', help='draw a recording, one row per frame')
+    cmd.add_argument('recording')
+    cmd.add_argument('png')
+    cmd.add_argument('--scale', type=int, default=4, help='size of a LED in the picture, in pixels')
+    cmd.add_argument('--first', type=int, default=0, help='first frame drawn')
+    cmd.add_argument('--count', type=int, default=0, help='number of frames drawn, all if 0')
+    cmd.set_defaults(func=png)
+    cmd = commands.add_parser('diff', help='compare the LED data of two recordings')
+    cmd.add_argument('before')
+    cmd.add_argument('after')
+    cmd.set_defaults(func=diff)
+    args = parser.parse_args()
+    if not hasattr(args, 'func'):
+        parser.print_help()
+        return 2
+    try:
+        return args.func(args)
+    except (IOError, ValueError) as e:
+        print(e)
+        return 2
+
+
+if __name__ == '__main__':
+    sys.exit(main())